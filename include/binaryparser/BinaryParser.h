@@ -9,8 +9,16 @@
 //=============================================================================
 #pragma once
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <exception>
+#include <limits>
 #include <map>
+#include <memory>
+#include <stdexcept>
 #include <string>
 #include <type_traits>
 #include <utility>
@@ -38,6 +46,7 @@ namespace StorageNS {
 			specifiers[Type::DOUBLE] = "%f";
 
             delimiter = ", ";
+			header_units = false;
 		}
 
 		~FormatSpecifier() {}
@@ -53,7 +62,12 @@ namespace StorageNS {
 			UINT32_T,
 			UINT64_T,
 			FLOAT,
-			DOUBLE
+			DOUBLE,
+			// Fixed-length characters, see CharArrayParser.
+			CHAR,
+			// Half precision floats, see HalfFloatParser.
+			FLOAT16,
+			BFLOAT16
 		};
 
 		// Singleton pattern
@@ -88,9 +102,24 @@ namespace StorageNS {
 		{
 			return delimiter.data();
 		}
+
+		/**
+		* @brief   Providing appending units of scaled fields to headers, e.g.
+		*          "voltage [V]".
+		**/
+		void set_header_units(bool header_units)
+		{
+			this->header_units = header_units;
+		}
+
+		bool get_header_units()
+		{
+			return header_units;
+		}
 	private:
 		std::map<Type, std::string> specifiers;
 		std::string delimiter;
+		bool header_units;
 	};
 
 	// Function template to provide format specifier in BasicParser 
@@ -167,100 +196,1744 @@ namespace StorageNS {
 		return specifier.get_specifier(FormatSpecifier::Type::DOUBLE);
 	}
 
+	// Function template to provide type enumerator in BasicParser
+	template <typename T>
+	inline FormatSpecifier::Type field_type();
+
+	template <>
+	inline FormatSpecifier::Type field_type<int8_t>()
+	{
+		return FormatSpecifier::Type::INT8_T;
+	}
+
+	template <>
+	inline FormatSpecifier::Type field_type<int16_t>()
+	{
+		return FormatSpecifier::Type::INT16_T;
+	}
+
+	template <>
+	inline FormatSpecifier::Type field_type<int32_t>()
+	{
+		return FormatSpecifier::Type::INT32_T;
+	}
+
+	template <>
+	inline FormatSpecifier::Type field_type<int64_t>()
+	{
+		return FormatSpecifier::Type::INT64_T;
+	}
+
+	template <>
+	inline FormatSpecifier::Type field_type<uint8_t>()
+	{
+		return FormatSpecifier::Type::UINT8_T;
+	}
+
+	template <>
+	inline FormatSpecifier::Type field_type<uint16_t>()
+	{
+		return FormatSpecifier::Type::UINT16_T;
+	}
+
+	template <>
+	inline FormatSpecifier::Type field_type<uint32_t>()
+	{
+		return FormatSpecifier::Type::UINT32_T;
+	}
+
+	template <>
+	inline FormatSpecifier::Type field_type<uint64_t>()
+	{
+		return FormatSpecifier::Type::UINT64_T;
+	}
+
+	template <>
+	inline FormatSpecifier::Type field_type<float>()
+	{
+		return FormatSpecifier::Type::FLOAT;
+	}
+
+	template <>
+	inline FormatSpecifier::Type field_type<double>()
+	{
+		return FormatSpecifier::Type::DOUBLE;
+	}
+
 	/**
-	* This class is used to represent null buffer exception.
+	* @brief   Get basic type of a type name, e.g. "int32_t".
+	* @returns
+	*          false if it is not a basic type.
+	**/
+	bool basicType(const std::string &type_name, FormatSpecifier::Type &type);
+
+	/**
+	* @brief   Append characters to output as JSON string, quoted and escaped.
+	**/
+	void appendJsonString(std::string &output, const char *text, size_t size);
+
+	/**
+	* @brief   Format an epoch timestamp as ISO-8601, e.g.
+	*          "2024-05-01T12:34:56.123Z" or "2024-05-01T14:34:56.123+02:00". The
+	*          text up to seconds is rendered once per second, key and thread,
+	*          so timestamps of the same second cost only their fraction.
+	* @param   char *[out] - buffer of at least 64 characters, ended with '\0'.
+	*          int64_t[in] - ticks since 1970-01-01T00:00:00Z
+	*          uint32_t[in] - ticks per second, i.e. 1, 1000, 1000000 or 1000000000
+	*          bool[in] - true for local time zone, or false for UTC.
+	*          size_t[in] - key of rendered second, e.g. field offset, so that
+	*          fields of a record do not render each other's seconds again.
+	* @returns
+	*          count of characters written.
+	**/
+	int formatTimestamp(char *output, int64_t value, uint32_t ticks, bool local, size_t key = 0);
+
+	/**
+	* @brief   Parse an ISO-8601 date or time, e.g. "2024-05-01",
+	*          "2024-05-01T12:34:56.5Z" or "2024-05-01 12:34:56+02:00", into ticks
+	*          since epoch. Time without zone is in local time zone if local.
+	* @returns
+	*          false if text is not ISO-8601.
+	**/
+	bool parseTimestamp(const std::string &text, uint32_t ticks, bool local, int64_t &value);
+
+	// Function template to read a possibly unaligned basic value from buffer
+	template <typename T>
+	inline T read_value(const char *buffer)
+	{
+		T value;
+		std::memcpy(&value, buffer, sizeof(T));
+		return value;
+	}
+
+	// Functions to reverse byte order, written so that compilers emit a byte
+	// swap instruction, or byte shuffles if a loop of them is vectorized.
+	inline uint8_t swap_bytes(uint8_t value)
+	{
+		return value;
+	}
+
+	inline uint16_t swap_bytes(uint16_t value)
+	{
+		return static_cast<uint16_t>((value >> 8) | (value << 8));
+	}
+
+	inline uint32_t swap_bytes(uint32_t value)
+	{
+		return ((value & 0x000000ffU) << 24) | ((value & 0x0000ff00U) << 8)
+			| ((value & 0x00ff0000U) >> 8) | ((value & 0xff000000U) >> 24);
+	}
+
+	inline uint64_t swap_bytes(uint64_t value)
+	{
+		return (static_cast<uint64_t>(swap_bytes(static_cast<uint32_t>(value))) << 32)
+			| swap_bytes(static_cast<uint32_t>(value >> 32));
+	}
+
+	// Unsigned integer type of a size, whose bytes can be swapped
+	template <size_t N>
+	struct unsigned_of;
+
+	template <>
+	struct unsigned_of<1> { typedef uint8_t type; };
+
+	template <>
+	struct unsigned_of<2> { typedef uint16_t type; };
+
+	template <>
+	struct unsigned_of<4> { typedef uint32_t type; };
+
+	template <>
+	struct unsigned_of<8> { typedef uint64_t type; };
+
+	// Function template to read a possibly unaligned basic value stored in
+	// reversed byte order from buffer
+	template <typename T>
+	inline T read_swapped(const char *buffer)
+	{
+		typename unsigned_of<sizeof(T)>::type bits;
+		T value;
+
+		std::memcpy(&bits, buffer, sizeof(T));
+		bits = swap_bytes(bits);
+		std::memcpy(&value, &bits, sizeof(T));
+		return value;
+	}
+
+	/**
+	* @brief   Convert IEEE 754 half precision bits to float.
+	**/
+	inline float half_to_float(uint16_t half)
+	{
+		uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+		uint32_t exponent = (half >> 10) & 0x1f;
+		uint32_t mantissa = half & 0x3ff;
+		uint32_t bits;
+		float value;
+
+		if (exponent == 0x1f)
+		{
+			bits = sign | 0x7f800000U | (mantissa << 13);
+		}
+		else if (exponent != 0)
+		{
+			bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+		}
+		else
+		{
+			// Zero or subnormal, which is mantissa * 2^-24.
+			value = static_cast<float>(mantissa) * (1.0f / 16777216.0f);
+			return sign != 0 ? -value : value;
+		}
+
+		std::memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	/**
+	* @brief   Convert float to IEEE 754 half precision bits, rounded to nearest
+	*          even.
+	**/
+	inline uint16_t float_to_half(float value)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+
+		uint32_t sign = (bits >> 16) & 0x8000;
+		uint32_t magnitude = bits & 0x7fffffffU;
+
+		// Infinity or NaN, and values rounded beyond the largest half, 65504.
+		if (magnitude > 0x7f800000U)
+			return static_cast<uint16_t>(sign | 0x7e00);
+		if (magnitude >= 0x477ff000U)
+			return static_cast<uint16_t>(sign | 0x7c00);
+
+		// Subnormal below 2^-14, which is value * 2^24 rounded.
+		if (magnitude < 0x38800000U)
+		{
+			float absolute;
+			std::memcpy(&absolute, &magnitude, sizeof(absolute));
+			float scaled = absolute * 16777216.0f;
+			uint32_t rounded = static_cast<uint32_t>(scaled);
+			float rest = scaled - static_cast<float>(rounded);
+			if (rest > 0.5f || (rest == 0.5f && (rounded & 1) != 0))
+				++rounded;
+			return static_cast<uint16_t>(sign | rounded);
+		}
+
+		uint32_t half = (magnitude - 0x38000000U) >> 13;
+		uint32_t rest = magnitude & 0x1fff;
+		if (rest > 0x1000 || (rest == 0x1000 && (half & 1) != 0))
+			++half;
+
+		return static_cast<uint16_t>(sign | half);
+	}
+
+	/**
+	* @brief   Convert bfloat16 bits, i.e. the upper half of float bits, to float.
+	**/
+	inline float bfloat16_to_float(uint16_t bfloat16)
+	{
+		uint32_t bits = static_cast<uint32_t>(bfloat16) << 16;
+		float value;
+
+		std::memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	/**
+	* @brief   Convert float to bfloat16 bits, rounded to nearest even.
+	**/
+	inline uint16_t float_to_bfloat16(float value)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+
+		if ((bits & 0x7fffffffU) > 0x7f800000U)
+			return static_cast<uint16_t>((bits >> 16) | 0x40);
+
+		return static_cast<uint16_t>((bits + 0x7fffU + ((bits >> 16) & 1)) >> 16);
+	}
+
+	/**
+	* @brief   Convert half precision values to float, eight at a time with F16C
+	*          instructions if the build targets them, or else one at a time.
+	**/
+	void half_to_float(const uint16_t *input, size_t count, float *output);
+
+	/**
+	* @brief   Convert bfloat16 values to float in a loop of shifts, which
+	*          compilers vectorize.
+	**/
+	void bfloat16_to_float(const uint16_t *input, size_t count, float *output);
+
+	/**
+	* @brief   Check if this host stores values in little-endian byte order.
+	**/
+	inline bool is_little_endian()
+	{
+		const uint16_t kPROBE = 1;
+		uint8_t first;
+
+		std::memcpy(&first, &kPROBE, sizeof(first));
+		return first == 1;
+	}
+
+	/**
+	* This class maps integer codes of a field to labels, e.g. 2 to "RUNNING".
+	* Labels are rendered once, as text and as JSON string, so formatting a
+	* label is a copy. Codes are looked up in a dense table if their range is
+	* small, or else in a perfect hash table.
 	*/
-	class NullBufferException : std::exception {
+	class EnumTable {
 	public:
-		char const* what() const
+		struct Entry {
+			int64_t code;
+			std::string label;
+			// Label as JSON string, quoted and escaped.
+			std::string quoted;
+		};
+
+		EnumTable(): min_code(0), multiplier(0), shift(64) {}
+
+		/**
+		* @brief   Add a label of code. Should be called before build().
+		* @returns
+		*          false if code already has a label, which is kept, or true.
+		**/
+		bool add(int64_t code, const std::string &label);
+
+		/**
+		* @brief   Build lookup table of added labels.
+		**/
+		void build();
+
+		/**
+		* @brief   Find label of code.
+		* @returns
+		*          const Entry *, or nullptr if code has no label.
+		**/
+		const Entry *find(int64_t code) const
 		{
-			return "Buffer is null";
+			int32_t index;
+
+			if (slots.empty())
+			{
+				auto entry = std::lower_bound(entries.begin(), entries.end(), code,
+					[](const Entry &entry, int64_t code) { return entry.code < code; });
+				return entry != entries.end() && entry->code == code ? &*entry : nullptr;
+			}
+			if (multiplier == 0)
+			{
+				uint64_t slot = static_cast<uint64_t>(code) - static_cast<uint64_t>(min_code);
+				if (slot >= slots.size())
+					return nullptr;
+				index = slots[slot];
+			}
+			else
+			{
+				index = slots[(static_cast<uint64_t>(code) * multiplier) >> shift];
+			}
+
+			if (index < 0 || entries[index].code != code)
+				return nullptr;
+
+			return &entries[index];
 		}
+
+		/**
+		* @brief   Find code of label.
+		* @returns
+		*          true if found, or false if not.
+		**/
+		bool code(const std::string &label, int64_t &code) const;
+
+	private:
+		std::vector<Entry> entries;
+		std::vector<int32_t> slots;
+		int64_t min_code;
+		// Hash of code is (code * multiplier) >> shift, or 0 for dense table.
+		// Without slots, entries are sorted by code and searched.
+		uint64_t multiplier;
+		unsigned shift;
 	};
 
 	/**
-	* Binary Parser base class, which defines parse() and length() interfaces.
+	* This structure locates a basic type field inside a fixed-size binary record,
+	* so that the field can be read directly without formatting the whole record.
+	* A scaled field stores raw values, e.g. ADC counts, whose physical value is
+	* raw * scale + bias. Values, keys and formatting of a scaled field are of
+	* its physical value as double. An integral field may have labels of codes,
+	* which are formatted instead of codes, and compared as codes. A char field
+	* has no numeric value, its characters up to the first '\0' are formatted.
+	* A swapped field is stored in the byte order opposite to the host, and is
+	* swapped whenever it is read. A bitfield is an unsigned bit range inside an
+	* integral field, extracted with shift and mask. A timestamp field counts
+	* ticks since epoch, which are formatted as ISO-8601 but compared as ticks.
 	*/
-	class BinaryParser {
-	public:
-		virtual ~BinaryParser() {};
+	struct FieldInfo {
+		FieldInfo(): offset(0), type(FormatSpecifier::Type::INT8_T), length(0), scale(1), bias(0), swapped(false),
+			shift(0), width(0), ticks(0), local(false) {}
+		FieldInfo(const std::string &name, size_t offset, FormatSpecifier::Type type, size_t length = 0)
+			:name(name), offset(offset), type(type), length(length), scale(1), bias(0), swapped(false),
+			shift(0), width(0), ticks(0), local(false) {}
 
 		/**
-		* @brief   Parse binary buffer.
-		* @param   const char *[in]- binary buffer.
+		* @brief   Byte size of this field.
+		**/
+		size_t size() const
+		{
+			switch (type) {
+			case FormatSpecifier::Type::INT8_T:
+			case FormatSpecifier::Type::UINT8_T:
+				return 1;
+			case FormatSpecifier::Type::INT16_T:
+			case FormatSpecifier::Type::UINT16_T:
+			case FormatSpecifier::Type::FLOAT16:
+			case FormatSpecifier::Type::BFLOAT16:
+				return 2;
+			case FormatSpecifier::Type::INT32_T:
+			case FormatSpecifier::Type::UINT32_T:
+			case FormatSpecifier::Type::FLOAT:
+				return 4;
+			case FormatSpecifier::Type::CHAR:
+				return length;
+			default:
+				return 8;
+			}
+		}
+
+		/**
+		* @brief   Count of characters of this char field of a record, which ends
+		*          at the first '\0' or else at length of the field.
+		* @param   const char *[in]- record buffer, not the field buffer.
+		**/
+		size_t textLength(const char *record) const
+		{
+			const void *end = std::memchr(record + offset, '\0', length);
+
+			return end == nullptr ? length : static_cast<const char*>(end) - (record + offset);
+		}
+
+		/**
+		* @brief   Code of type and bit range of this field, which identifies this
+		*          field together with its offset, e.g. in sidecar files. It is the
+		*          type of fields other than bitfields.
+		**/
+		uint32_t layoutCode() const
+		{
+			return static_cast<uint32_t>(type) | (shift << 8) | (width << 16);
+		}
+
+		/**
+		* @brief   Read this bitfield from a record.
+		* @param   const char *[in]- record buffer, not the field buffer.
+		**/
+		uint64_t bits(const char *record) const
+		{
+			const char *buffer = record + offset;
+			uint64_t word;
+
+			switch (size()) {
+			case 1: word = read<uint8_t>(buffer); break;
+			case 2: word = read<uint16_t>(buffer); break;
+			case 4: word = read<uint32_t>(buffer); break;
+			default: word = read<uint64_t>(buffer); break;
+			}
+
+			return (word >> shift) & bitMask();
+		}
+
+		/**
+		* @brief   Check if this field is scaled to a physical value.
+		**/
+		bool isScaled() const
+		{
+			return scale != 1 || bias != 0;
+		}
+
+		/**
+		* @brief   Find label of this field of a record.
+		* @param   const char *[in]- record buffer, not the field buffer.
 		* @returns
-		*          std::string - expression in string.
+		*          const EnumTable::Entry *, or nullptr if field has no label.
 		**/
-	    virtual std::string parse(const char* buffer) = 0;
+		const EnumTable::Entry *label(const char *record) const
+		{
+			return labels ? labels->find(integer(record)) : nullptr;
+		}
+
+		/**
+		* @brief   Copy attributes of a field, i.e. scaling, unit, labels, byte
+		*          order and timestamp, which do not depend on location of the field.
+		**/
+		void setAttributes(const FieldInfo &field)
+		{
+			scale = field.scale;
+			bias = field.bias;
+			unit = field.unit;
+			labels = field.labels;
+			swapped = field.swapped;
+			ticks = field.ticks;
+			local = field.local;
+		}
+
+		/**
+		* @brief   Check if this field has a numeric value. A char field has not.
+		**/
+		bool isNumeric() const
+		{
+			return type != FormatSpecifier::Type::CHAR;
+		}
+
+		/**
+		* @brief   Check if this field is a floating-point type of any precision.
+		**/
+		bool isFloatingPoint() const
+		{
+			return type == FormatSpecifier::Type::FLOAT || type == FormatSpecifier::Type::DOUBLE
+				|| type == FormatSpecifier::Type::FLOAT16 || type == FormatSpecifier::Type::BFLOAT16;
+		}
+
+		/**
+		* @brief   Check if this field is an integral type. A scaled field is not.
+		**/
+		bool isIntegral() const
+		{
+			return !isFloatingPoint() && isNumeric() && !isScaled();
+		}
+
+		/**
+		* @brief   Read this field from a record as double, scaled if this is a
+		*          scaled field.
+		* @param   const char *[in]- record buffer, not the field buffer.
+		**/
+		double value(const char *record) const
+		{
+			return isScaled() ? raw(record) * scale + bias : raw(record);
+		}
+
+		/**
+		* @brief   Read this field of selected records as double, scaled if this is
+		*          a scaled field. The type is dispatched once for all records.
+		* @param   const char *[in]- records buffer
+		*          size_t[in] - length of a record
+		*          const uint32_t *[in] - indexes of selected records
+		*          size_t[in] - count of selected records
+		*          double *[out] - values of selected records
+		**/
+		void values(const char *records, size_t item_length, const uint32_t *selection, size_t count, double *output) const
+		{
+			if (width != 0)
+			{
+				switch (size()) {
+				case 1: gatherBits<uint8_t>(records, item_length, selection, count, output); break;
+				case 2: gatherBits<uint16_t>(records, item_length, selection, count, output); break;
+				case 4: gatherBits<uint32_t>(records, item_length, selection, count, output); break;
+				default: gatherBits<uint64_t>(records, item_length, selection, count, output); break;
+				}
+				return;
+			}
+
+			switch (type) {
+			case FormatSpecifier::Type::INT8_T: gather<int8_t>(records, item_length, selection, count, output); break;
+			case FormatSpecifier::Type::INT16_T: gather<int16_t>(records, item_length, selection, count, output); break;
+			case FormatSpecifier::Type::INT32_T: gather<int32_t>(records, item_length, selection, count, output); break;
+			case FormatSpecifier::Type::INT64_T: gather<int64_t>(records, item_length, selection, count, output); break;
+			case FormatSpecifier::Type::UINT8_T: gather<uint8_t>(records, item_length, selection, count, output); break;
+			case FormatSpecifier::Type::UINT16_T: gather<uint16_t>(records, item_length, selection, count, output); break;
+			case FormatSpecifier::Type::UINT32_T: gather<uint32_t>(records, item_length, selection, count, output); break;
+			case FormatSpecifier::Type::UINT64_T: gather<uint64_t>(records, item_length, selection, count, output); break;
+			case FormatSpecifier::Type::FLOAT: gather<float>(records, item_length, selection, count, output); break;
+			case FormatSpecifier::Type::FLOAT16:
+			case FormatSpecifier::Type::BFLOAT16: gatherHalf(records, item_length, selection, count, output); break;
+			case FormatSpecifier::Type::CHAR: std::fill(output, output + count, std::numeric_limits<double>::quiet_NaN()); break;
+			default: gather<double>(records, item_length, selection, count, output); break;
+			}
+		}
+
+		/**
+		* @brief   Read this field from a record as double without scaling, NaN if
+		*          this is a char field.
+		* @param   const char *[in]- record buffer, not the field buffer.
+		**/
+		double raw(const char *record) const
+		{
+			const char *buffer = record + offset;
+
+			if (width != 0)
+				return static_cast<double>(bits(record));
+
+			switch (type) {
+			case FormatSpecifier::Type::INT8_T: return read<int8_t>(buffer);
+			case FormatSpecifier::Type::INT16_T: return read<int16_t>(buffer);
+			case FormatSpecifier::Type::INT32_T: return read<int32_t>(buffer);
+			case FormatSpecifier::Type::INT64_T: return static_cast<double>(read<int64_t>(buffer));
+			case FormatSpecifier::Type::UINT8_T: return read<uint8_t>(buffer);
+			case FormatSpecifier::Type::UINT16_T: return read<uint16_t>(buffer);
+			case FormatSpecifier::Type::UINT32_T: return read<uint32_t>(buffer);
+			case FormatSpecifier::Type::UINT64_T: return static_cast<double>(read<uint64_t>(buffer));
+			case FormatSpecifier::Type::FLOAT: return read<float>(buffer);
+			case FormatSpecifier::Type::FLOAT16: return half_to_float(read<uint16_t>(buffer));
+			case FormatSpecifier::Type::BFLOAT16: return bfloat16_to_float(read<uint16_t>(buffer));
+			case FormatSpecifier::Type::CHAR: return std::numeric_limits<double>::quiet_NaN();
+			default: return read<double>(buffer);
+			}
+		}
+
+		/**
+		* @brief   Read this field from a record as int64_t, floating-point and
+		*          scaled values are truncated, 0 if this is a char field.
+		* @param   const char *[in]- record buffer, not the field buffer.
+		**/
+		int64_t integer(const char *record) const
+		{
+			const char *buffer = record + offset;
+
+			if (isScaled())
+				return static_cast<int64_t>(value(record));
+			if (width != 0)
+				return static_cast<int64_t>(bits(record));
+
+			switch (type) {
+			case FormatSpecifier::Type::INT8_T: return read<int8_t>(buffer);
+			case FormatSpecifier::Type::INT16_T: return read<int16_t>(buffer);
+			case FormatSpecifier::Type::INT32_T: return read<int32_t>(buffer);
+			case FormatSpecifier::Type::INT64_T: return read<int64_t>(buffer);
+			case FormatSpecifier::Type::UINT8_T: return read<uint8_t>(buffer);
+			case FormatSpecifier::Type::UINT16_T: return read<uint16_t>(buffer);
+			case FormatSpecifier::Type::UINT32_T: return read<uint32_t>(buffer);
+			case FormatSpecifier::Type::UINT64_T: return static_cast<int64_t>(read<uint64_t>(buffer));
+			case FormatSpecifier::Type::FLOAT: return static_cast<int64_t>(read<float>(buffer));
+			case FormatSpecifier::Type::FLOAT16:
+			case FormatSpecifier::Type::BFLOAT16: return static_cast<int64_t>(raw(record));
+			case FormatSpecifier::Type::CHAR: return 0;
+			default: return static_cast<int64_t>(read<double>(buffer));
+			}
+		}
+
+		/**
+		* @brief   Read this field from a record as unsigned key, whose unsigned order
+		*          is the same as the order of field values, so that keys of any type
+		*          can be radix sorted or compared bytewise. Key of a char field is
+		*          its first 8 characters, so only their order is kept.
+		* @param   const char *[in]- record buffer, not the field buffer.
+		**/
+		uint64_t sortKey(const char *record) const
+		{
+			const uint64_t kSIGN_BIT = 0x8000000000000000ULL;
+
+			if (isScaled())
+				return FieldInfo::sortKey(value(record));
+			if (width != 0)
+				return bits(record);
+
+			switch (type) {
+			case FormatSpecifier::Type::CHAR:
+			{
+				size_t count = std::min<size_t>(textLength(record), sizeof(uint64_t));
+				uint64_t key = 0;
+				for (size_t i = 0; i < sizeof(uint64_t); ++i)
+					key = (key << 8) | (i < count ? static_cast<unsigned char>(record[offset + i]) : 0);
+				return key;
+			}
+			case FormatSpecifier::Type::UINT8_T:
+			case FormatSpecifier::Type::UINT16_T:
+			case FormatSpecifier::Type::UINT32_T:
+			case FormatSpecifier::Type::UINT64_T:
+				return static_cast<uint64_t>(integer(record));
+			case FormatSpecifier::Type::FLOAT:
+			case FormatSpecifier::Type::DOUBLE:
+			case FormatSpecifier::Type::FLOAT16:
+			case FormatSpecifier::Type::BFLOAT16:
+				return FieldInfo::sortKey(value(record));
+			default:
+				return static_cast<uint64_t>(integer(record)) ^ kSIGN_BIT;
+			}
+		}
+
+		/**
+		* @brief   Unsigned key of a double value, see sortKey().
+		**/
+		static uint64_t sortKey(double value)
+		{
+			const uint64_t kSIGN_BIT = 0x8000000000000000ULL;
+			uint64_t bits;
+
+			std::memcpy(&bits, &value, sizeof(bits));
+			return (bits & kSIGN_BIT) ? ~bits : (bits | kSIGN_BIT);
+		}
+
+		/**
+		* @brief   Convert a value in text to the unsigned key of this field, see
+		*          sortKey(). Keys of a char field cannot compare whole values, so
+		*          std::invalid_argument is thrown.
+		* @param   const std::string &[in]- value in text, e.g. "1024" or "-1.5".
+		**/
+		uint64_t sortKeyOf(const std::string &text) const
+		{
+			char buffer[sizeof(uint64_t)];
+			FieldInfo field(name, 0, type);
+			int64_t code;
+
+			if (!isNumeric())
+				throw std::invalid_argument("char field has no comparable key");
+			if (isScaled())
+				return FieldInfo::sortKey(std::stod(text));
+			if (labels && labels->code(text, code))
+				return sortKeyOf(std::to_string(static_cast<long long>(code)));
+			if (ticks != 0 && parseTimestamp(text, ticks, local, code))
+				return sortKeyOf(std::to_string(static_cast<long long>(code)));
+			if (width != 0)
+				return std::stoull(text);
+
+			switch (type) {
+			case FormatSpecifier::Type::INT8_T: { int8_t value = static_cast<int8_t>(std::stoll(text)); std::memcpy(buffer, &value, sizeof(value)); break; }
+			case FormatSpecifier::Type::INT16_T: { int16_t value = static_cast<int16_t>(std::stoll(text)); std::memcpy(buffer, &value, sizeof(value)); break; }
+			case FormatSpecifier::Type::INT32_T: { int32_t value = static_cast<int32_t>(std::stoll(text)); std::memcpy(buffer, &value, sizeof(value)); break; }
+			case FormatSpecifier::Type::INT64_T: { int64_t value = std::stoll(text); std::memcpy(buffer, &value, sizeof(value)); break; }
+			case FormatSpecifier::Type::UINT8_T: { uint8_t value = static_cast<uint8_t>(std::stoull(text)); std::memcpy(buffer, &value, sizeof(value)); break; }
+			case FormatSpecifier::Type::UINT16_T: { uint16_t value = static_cast<uint16_t>(std::stoull(text)); std::memcpy(buffer, &value, sizeof(value)); break; }
+			case FormatSpecifier::Type::UINT32_T: { uint32_t value = static_cast<uint32_t>(std::stoull(text)); std::memcpy(buffer, &value, sizeof(value)); break; }
+			case FormatSpecifier::Type::UINT64_T: { uint64_t value = std::stoull(text); std::memcpy(buffer, &value, sizeof(value)); break; }
+			case FormatSpecifier::Type::FLOAT: { float value = std::stof(text); std::memcpy(buffer, &value, sizeof(value)); break; }
+			case FormatSpecifier::Type::FLOAT16: { uint16_t value = float_to_half(std::stof(text)); std::memcpy(buffer, &value, sizeof(value)); break; }
+			case FormatSpecifier::Type::BFLOAT16: { uint16_t value = float_to_bfloat16(std::stof(text)); std::memcpy(buffer, &value, sizeof(value)); break; }
+			default: { double value = std::stod(text); std::memcpy(buffer, &value, sizeof(value)); break; }
+			}
+
+			return field.sortKey(buffer);
+		}
+
+		/**
+		* @brief   Convert a bound in text to the key of the nearest value of this
+		*          field inside the bound, so that an integral field compares
+		*          exactly with any bound, e.g. a lower bound 90.5 is 91, and an
+		*          upper bound 40000 of an int16_t field is 32767. Keys of other
+		*          fields are of sortKeyOf().
+		* @param   const std::string &[in]- bound in text
+		*          bool[in] - true for an upper bound, or false for a lower bound
+		*          uint64_t &[out] - key of the nearest value inside bound
+		* @returns
+		*          false if no value of this field is inside bound, or true.
+		**/
+		bool boundKeyOf(const std::string &text, bool upper, uint64_t &key) const
+		{
+			int64_t code;
+
+			if (!isIntegral() || (labels && labels->code(text, code)) || (ticks != 0 && parseTimestamp(text, ticks, local, code)))
+			{
+				key = sortKeyOf(text);
+				return true;
+			}
+
+			// Limits of values, as the lowest signed and the highest unsigned.
+			bool is_signed = width == 0 && (type == FormatSpecifier::Type::INT8_T || type == FormatSpecifier::Type::INT16_T
+				|| type == FormatSpecifier::Type::INT32_T || type == FormatSpecifier::Type::INT64_T);
+			unsigned bit_count = width != 0 ? width : static_cast<unsigned>(size() * 8);
+			int64_t min = is_signed ? -static_cast<int64_t>((1ULL << (bit_count - 1)) - 1) - 1 : 0;
+			uint64_t max = is_signed ? (1ULL << (bit_count - 1)) - 1 : (bit_count == 64 ? ~0ULL : (1ULL << bit_count) - 1);
+
+			// Integer literals are converted exactly, others through long double.
+			bool below = false;
+			bool above = false;
+			bool negative = text.find('-') != std::string::npos;
+			int64_t low = 0;
+			uint64_t high = 0;
+			size_t end = 0;
+			try {
+				if (negative)
+					low = std::stoll(text, &end, 10);
+				else
+					high = std::stoull(text, &end, 10);
+			}
+			catch (const std::out_of_range &) {
+				below = negative;
+				above = !negative;
+				end = text.size();
+			}
+			catch (const std::invalid_argument &) {
+				end = 0;
+			}
+			if (end != text.size())
+			{
+				long double value = std::stold(text, &end);
+				if (end != text.size() || value != value)
+					throw std::invalid_argument("bound is not a number");
+
+				value = upper ? std::floor(value) : std::ceil(value);
+				negative = value < 0;
+				below = value < -9223372036854775808.0L;
+				above = value >= 18446744073709551616.0L;
+				if (negative && !below)
+					low = static_cast<int64_t>(value);
+				else if (!negative && !above)
+					high = static_cast<uint64_t>(value);
+			}
+
+			below = below || (negative && low < min);
+			above = above || (!negative && high > max);
+			if ((below && upper) || (above && !upper))
+				return false;
+
+			if (below)
+				key = sortKeyOf(std::to_string(static_cast<long long>(min)));
+			else if (above)
+				key = sortKeyOf(std::to_string(static_cast<unsigned long long>(max)));
+			else if (negative)
+				key = sortKeyOf(std::to_string(static_cast<long long>(low)));
+			else
+				key = sortKeyOf(std::to_string(static_cast<unsigned long long>(high)));
+
+			return true;
+		}
+
+		/**
+		* @brief   Format this field of a record into file with the format specifier
+		*          of its type.
+		* @param   FILE *[in] - file pointer
+		*          const char *[in]- record buffer, not the field buffer.
+		* @returns
+		*          count of characters written, or negative if fail.
+		**/
+		int fprintf(FILE *fp, const char *record) const
+		{
+			const char *buffer = record + offset;
+
+			if (ticks != 0)
+			{
+				char text[kTIMESTAMP_LENGTH];
+				int length = formatTimestamp(text, integer(record), ticks, local, offset);
+				return static_cast<int>(std::fwrite(text, 1, length, fp));
+			}
+			if (isScaled())
+				return std::fprintf(fp, format_specifier<double>(), value(record));
+			if (labels)
+			{
+				const EnumTable::Entry *entry = label(record);
+				if (entry != nullptr)
+					return static_cast<int>(std::fwrite(entry->label.data(), 1, entry->label.size(), fp));
+			}
+			if (!isNumeric())
+				return static_cast<int>(std::fwrite(buffer, 1, textLength(record), fp));
+			if (width != 0)
+				return std::fprintf(fp, format_specifier<uint64_t>(), bits(record));
+
+			switch (type) {
+			case FormatSpecifier::Type::INT8_T: return std::fprintf(fp, format_specifier<int8_t>(), read<int8_t>(buffer));
+			case FormatSpecifier::Type::INT16_T: return std::fprintf(fp, format_specifier<int16_t>(), read<int16_t>(buffer));
+			case FormatSpecifier::Type::INT32_T: return std::fprintf(fp, format_specifier<int32_t>(), read<int32_t>(buffer));
+			case FormatSpecifier::Type::INT64_T: return std::fprintf(fp, format_specifier<int64_t>(), read<int64_t>(buffer));
+			case FormatSpecifier::Type::UINT8_T: return std::fprintf(fp, format_specifier<uint8_t>(), read<uint8_t>(buffer));
+			case FormatSpecifier::Type::UINT16_T: return std::fprintf(fp, format_specifier<uint16_t>(), read<uint16_t>(buffer));
+			case FormatSpecifier::Type::UINT32_T: return std::fprintf(fp, format_specifier<uint32_t>(), read<uint32_t>(buffer));
+			case FormatSpecifier::Type::UINT64_T: return std::fprintf(fp, format_specifier<uint64_t>(), read<uint64_t>(buffer));
+			case FormatSpecifier::Type::FLOAT: return std::fprintf(fp, format_specifier<float>(), read<float>(buffer));
+			case FormatSpecifier::Type::FLOAT16:
+			case FormatSpecifier::Type::BFLOAT16: return std::fprintf(fp, format_specifier<float>(), raw(record));
+			default: return std::fprintf(fp, format_specifier<double>(), read<double>(buffer));
+			}
+		}
+
+		/**
+		* @brief   Format this field of a record into buffer with the format
+		*          specifier of its type, like std::snprintf().
+		* @param   char *[out] - buffer
+		*          size_t[in] - size of buffer
+		*          const char *[in]- record buffer, not the field buffer.
+		* @returns
+		*          count of characters needed, or negative if fail.
+		**/
+		int snprintf(char *output, size_t size, const char *record) const
+		{
+			const char *buffer = record + offset;
+
+			if (ticks != 0)
+			{
+				char text[kTIMESTAMP_LENGTH];
+				int length = formatTimestamp(text, integer(record), ticks, local, offset);
+				if (size != 0)
+				{
+					size_t copied = std::min(static_cast<size_t>(length), size - 1);
+					std::memcpy(output, text, copied);
+					output[copied] = '\0';
+				}
+				return length;
+			}
+			if (isScaled())
+				return std::snprintf(output, size, format_specifier<double>(), value(record));
+			if (labels)
+			{
+				const EnumTable::Entry *entry = label(record);
+				if (entry != nullptr)
+					return std::snprintf(output, size, "%s", entry->label.data());
+			}
+			if (!isNumeric())
+				return std::snprintf(output, size, "%.*s", static_cast<int>(textLength(record)), buffer);
+			if (width != 0)
+				return std::snprintf(output, size, format_specifier<uint64_t>(), bits(record));
+
+			switch (type) {
+			case FormatSpecifier::Type::INT8_T: return std::snprintf(output, size, format_specifier<int8_t>(), read<int8_t>(buffer));
+			case FormatSpecifier::Type::INT16_T: return std::snprintf(output, size, format_specifier<int16_t>(), read<int16_t>(buffer));
+			case FormatSpecifier::Type::INT32_T: return std::snprintf(output, size, format_specifier<int32_t>(), read<int32_t>(buffer));
+			case FormatSpecifier::Type::INT64_T: return std::snprintf(output, size, format_specifier<int64_t>(), read<int64_t>(buffer));
+			case FormatSpecifier::Type::UINT8_T: return std::snprintf(output, size, format_specifier<uint8_t>(), read<uint8_t>(buffer));
+			case FormatSpecifier::Type::UINT16_T: return std::snprintf(output, size, format_specifier<uint16_t>(), read<uint16_t>(buffer));
+			case FormatSpecifier::Type::UINT32_T: return std::snprintf(output, size, format_specifier<uint32_t>(), read<uint32_t>(buffer));
+			case FormatSpecifier::Type::UINT64_T: return std::snprintf(output, size, format_specifier<uint64_t>(), read<uint64_t>(buffer));
+			case FormatSpecifier::Type::FLOAT: return std::snprintf(output, size, format_specifier<float>(), read<float>(buffer));
+			case FormatSpecifier::Type::FLOAT16:
+			case FormatSpecifier::Type::BFLOAT16: return std::snprintf(output, size, format_specifier<float>(), raw(record));
+			default: return std::snprintf(output, size, format_specifier<double>(), read<double>(buffer));
+			}
+		}
+
+		/**
+		* @brief   Append this field of a record to output as JSON value. Labels,
+		*          timestamps and characters are JSON strings, and numbers are
+		*          printed without custom format specifiers, which may print text
+		*          other than a JSON number, e.g. "%x". JSON has no literal of NaN
+		*          or infinity, so they are null.
+		* @param   std::string &[out] - output
+		*          const char *[in]- record buffer, not the field buffer.
+		**/
+		void appendJson(std::string &output, const char *record) const
+		{
+			char text[kTIMESTAMP_LENGTH];
+			int length;
+
+			if (labels)
+			{
+				const EnumTable::Entry *entry = label(record);
+				if (entry != nullptr)
+				{
+					output += entry->quoted;
+					return;
+				}
+			}
+			if (ticks != 0)
+			{
+				length = formatTimestamp(text, integer(record), ticks, local, offset);
+				output += '"';
+				output.append(text, length);
+				output += '"';
+				return;
+			}
+			if (!isNumeric())
+			{
+				appendJsonString(output, record + offset, textLength(record));
+				return;
+			}
+
+			if (!isIntegral())
+			{
+				double number = value(record);
+				bool single = type == FormatSpecifier::Type::FLOAT || type == FormatSpecifier::Type::FLOAT16
+					|| type == FormatSpecifier::Type::BFLOAT16;
+				if (!std::isfinite(number))
+				{
+					output += "null";
+					return;
+				}
+				length = std::snprintf(text, sizeof(text), "%.*g", single && !isScaled() ? 9 : 17, number);
+			}
+			else if (width != 0 || type == FormatSpecifier::Type::UINT64_T)
+				length = std::snprintf(text, sizeof(text), "%llu", static_cast<unsigned long long>(integer(record)));
+			else
+				length = std::snprintf(text, sizeof(text), "%lld", static_cast<long long>(integer(record)));
+			if (length > 0)
+				output.append(text, length);
+		}
+
+		std::string name;
+		size_t offset;
+		FormatSpecifier::Type type;
+		// Count of characters of a char field.
+		size_t length;
+		double scale;
+		double bias;
+		std::string unit;
+		std::shared_ptr<const EnumTable> labels;
+		// Stored in reversed byte order, e.g. big-endian on a little-endian host.
+		bool swapped;
+		// Bit range of a bitfield, whose width is 0 if this is not a bitfield.
+		unsigned shift;
+		unsigned width;
+		// Ticks per second of a timestamp field, or 0 if this is not a timestamp.
+		uint32_t ticks;
+		// Timestamp is formatted in local time zone instead of UTC.
+		bool local;
+
+		// Buffer size of formatted timestamps, see formatTimestamp().
+		static const size_t kTIMESTAMP_LENGTH = 64;
+
+	private:
+		uint64_t bitMask() const
+		{
+			return width >= 64 ? ~0ULL : (1ULL << width) - 1;
+		}
+
+		template <typename T>
+		void gatherBits(const char *records, size_t item_length, const uint32_t *selection, size_t count, double *output) const
+		{
+			const char *buffer = records + offset;
+			const uint64_t mask = bitMask();
+
+			for (size_t i = 0; i < count; ++i)
+				output[i] = static_cast<double>((static_cast<uint64_t>(read<T>(buffer + selection[i] * item_length)) >> shift) & mask);
+			if (isScaled())
+			{
+				for (size_t i = 0; i < count; ++i)
+					output[i] = output[i] * scale + bias;
+			}
+		}
+
+		template <typename T>
+		T read(const char *buffer) const
+		{
+			return swapped ? read_swapped<T>(buffer) : read_value<T>(buffer);
+		}
+
+		template <typename T>
+		void gather(const char *records, size_t item_length, const uint32_t *selection, size_t count, double *output) const
+		{
+			const char *buffer = records + offset;
+
+			if (swapped)
+			{
+				gatherSwapped<T>(buffer, item_length, selection, count, output);
+			}
+			else if (isScaled())
+			{
+				for (size_t i = 0; i < count; ++i)
+					output[i] = static_cast<double>(read_value<T>(buffer + selection[i] * item_length)) * scale + bias;
+			}
+			else
+			{
+				for (size_t i = 0; i < count; ++i)
+					output[i] = static_cast<double>(read_value<T>(buffer + selection[i] * item_length));
+			}
+		}
+
+		// Half precision values are gathered in chunks, which are converted to
+		// float at once, see half_to_float().
+		void gatherHalf(const char *records, size_t item_length, const uint32_t *selection, size_t count, double *output) const
+		{
+			const char *buffer = records + offset;
+			const size_t kCHUNK_VALUES = 256;
+			uint16_t bits[kCHUNK_VALUES];
+			float values[kCHUNK_VALUES];
+
+			for (size_t begin = 0; begin < count; begin += kCHUNK_VALUES)
+			{
+				size_t chunk = std::min(kCHUNK_VALUES, count - begin);
+
+				for (size_t i = 0; i < chunk; ++i)
+					bits[i] = read<uint16_t>(buffer + selection[begin + i] * item_length);
+				if (type == FormatSpecifier::Type::FLOAT16)
+					half_to_float(bits, chunk, values);
+				else
+					bfloat16_to_float(bits, chunk, values);
+				for (size_t i = 0; i < chunk; ++i)
+					output[begin + i] = isScaled() ? values[i] * scale + bias : values[i];
+			}
+		}
+
+		// Raw values are gathered in chunks, whose bytes are swapped in one pass
+		// over contiguous values, before conversion.
+		template <typename T>
+		void gatherSwapped(const char *buffer, size_t item_length, const uint32_t *selection, size_t count, double *output) const
+		{
+			typedef typename unsigned_of<sizeof(T)>::type Bits;
+			const size_t kCHUNK_VALUES = 256;
+			Bits bits[kCHUNK_VALUES];
+
+			for (size_t begin = 0; begin < count; begin += kCHUNK_VALUES)
+			{
+				size_t chunk = std::min(kCHUNK_VALUES, count - begin);
+
+				for (size_t i = 0; i < chunk; ++i)
+					std::memcpy(&bits[i], buffer + selection[begin + i] * item_length, sizeof(T));
+				for (size_t i = 0; i < chunk; ++i)
+					bits[i] = swap_bytes(bits[i]);
+				for (size_t i = 0; i < chunk; ++i)
+				{
+					T value;
+					std::memcpy(&value, &bits[i], sizeof(T));
+					output[begin + i] = static_cast<double>(value);
+				}
+				if (isScaled())
+				{
+					for (size_t i = 0; i < chunk; ++i)
+						output[begin + i] = output[begin + i] * scale + bias;
+				}
+			}
+		}
+	};
+
+	/**
+	* This structure is a condition of presence of an optional member, tested
+	* on an integral field located earlier in the same struct, e.g. flags of a
+	* protocol version which has an extension block only if a bit is set.
+	*/
+	struct Presence {
+		enum class Op {
+			ALWAYS,
+			NONZERO,
+			MASK,
+			EQ,
+			NE,
+			LT,
+			LE,
+			GT,
+			GE
+		};
+
+		Presence(): op(Op::ALWAYS), value(0) {}
+
+		/**
+		* @brief   Check if a member is present in a struct.
+		* @param   const char *[in]- struct buffer, where field is located.
+		**/
+		bool holds(const char *buffer) const
+		{
+			if (op == Op::ALWAYS)
+				return true;
+
+			int64_t actual = field.integer(buffer);
+			switch (op) {
+			case Op::NONZERO: return actual != 0;
+			case Op::MASK: return (actual & value) != 0;
+			case Op::EQ: return actual == value;
+			case Op::NE: return actual != value;
+			case Op::LT: return actual < value;
+			case Op::LE: return actual <= value;
+			case Op::GT: return actual > value;
+			default: return actual >= value;
+			}
+		}
+
+		FieldInfo field;
+		Op op;
+		int64_t value;
+	};
+
+	/**
+	* This class is used to represent null buffer exception.
+	*/
+	class NullBufferException : std::exception {
+	public:
+		char const* what() const
+		{
+			return "Buffer is null";
+		}
+	};
+
+	/**
+	* Binary Parser base class, which defines parse() and length() interfaces.
+	*/
+	class BinaryParser {
+	public:
+		virtual ~BinaryParser() {};
+
+		/**
+		* @brief   Parse binary buffer.
+		* @param   const char *[in]- binary buffer.
+		* @returns
+		*          std::string - expression in string.
+		**/
+	    virtual std::string parse(const char* buffer) = 0;
+
+		/**
+		* @brief   Parse binary buffer and attach a name to parsed information *          in order to expressing in other place.
+		* @param   const std::string &[in] - name describing this buffer
+		* @param   const char *[in]- binary buffer.
+		* @returns std::vector<MemberInfo> sequences of parsed information with an order in accordance with binary buffer.
+		**/
+		virtual std::vector<MemberInfo> expr(const std::string& name, const char* buffer) = 0;
+
+         /**
+		* @brief   Parse binary buffer and save parsed data into file.
+		* @param   FILE *[in] - file pointer
+	    *          const char*[buffer] - buffer without type information
+		* @returns
+		*          -1 if fail, or 0 if success.
+		**/
+		virtual int fprintf(FILE *fp, const char* buffer) = 0;
+
+		/**
+		* @brief   Locate basic type fields parsed by this Binary Parser.
+		* @param   const std::string &[in] - name describing this buffer
+		*          size_t[in] - offset of this buffer inside the record
+		* @returns std::vector<FieldInfo> fields with an order in accordance with binary buffer.
+		**/
+		virtual std::vector<FieldInfo> fields(const std::string& name, size_t offset) = 0;
+
+		/**
+		* @brief   Character length parsed by this Binary Parser.
+		* @returns
+		*          Character length parsed by this Binary Parser, or 0 if it is
+		*          not fixed.
+		**/
+		virtual size_t length() = 0;
+
+		/**
+		* @brief   Check if every buffer parsed by this Binary Parser has the same
+		*          length(). Parsers of strings and counted arrays have not.
+		**/
+		virtual bool isFixedLength()
+		{
+			return true;
+		}
+
+		/**
+		* @brief   Character length of given buffer parsed by this Binary Parser,
+		*          which is length() if it is fixed.
+		* @param   const char *[in]- binary buffer.
+		*          size_t[in] - count of available bytes in buffer
+		* @returns
+		*          Character length, or 0 if buffer is not complete or invalid.
+		**/
+		virtual size_t lengthAt(const char *, size_t available)
+		{
+			return length() <= available ? length() : 0;
+		}
+
+		/**
+		* @brief   Alignment of buffers parsed by this Binary Parser as a member of
+		*          a naturally aligned C structure.
+		* @returns
+		*          Alignment in bytes, 1 if buffers need no alignment.
+		**/
+		virtual size_t alignment()
+		{
+			return 1;
+		}
+	};
+
+	/**
+	* Binary buffer Parser supporting basic data type, including int8_t, int16_t,
+	* int32_t, int64_t, uint8_t, uint16_t, uint32_t, uint64_t, float, double
+	*/
+	template <typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+	class BasicParser : public BinaryParser {
+	public:
+		/**
+		* @brief   Parse binary buffer.
+		* @param   const char *[in]- binary buffer.
+		* @returns
+		*          std::string - expression in string.
+		**/
+	    std::string parse(const char* buffer)
+		{
+			const int kBASIC_TYPE_EXPR_LENGTH = 64;
+			char expr[kBASIC_TYPE_EXPR_LENGTH] = "\0";
+
+			std::sprintf(expr, format_specifier<T>(), buffer);
+
+			return std::string(expr);
+		}
+
+		/**
+		* @brief   Parse binary buffer and attach a name to parsed information
+		*          in order to expressing in other place.
+		* @param   const std::string &[in] - name describing this buffer
+		* @param   const char *[in]- binary buffer.
+		* @returns std::vector<MemberInfo> sequences of parsed information with an order in accordance with binary buffer.
+		**/
+		std::vector<MemberInfo> expr(const std::string& name, const char* buffer) override
+		{
+			std::vector<MemberInfo> members;
+
+			if (buffer == nullptr)
+				return members;
+
+			const T* pt = reinterpret_cast<const T*>(buffer);
+
+			members.emplace_back(MemberInfo(name, StorageNS::to_string(*pt)));
+
+			return members;
+		}
+
+        /**
+		* @brief   Parse binary buffer and save parsed data into file.
+		* @param   FILE *[in] - file pointer
+	    *          const char*[buffer] - buffer without type information
+		* @returns
+		*          -1 if fail, or 0 if success.
+		**/
+		int fprintf(FILE *fp, const char* buffer)
+		{
+			const T* pt = reinterpret_cast<const T*>(buffer);
+			return std::fprintf(fp, format_specifier<T>(), *pt);
+		}
+
+		/**
+		* @brief   Character length parsed by this Binary Parser.
+		* @param   void
+		* @returns
+		*          Character length parsed by this Binary Parser.
+		**/
+		size_t length() override
+		{
+			return sizeof(T);
+		}
+
+		/**
+		* @brief   Locate basic type fields parsed by this Binary Parser.
+		* @param   const std::string &[in] - name describing this buffer
+		*          size_t[in] - offset of this buffer inside the record
+		* @returns std::vector<FieldInfo> fields with an order in accordance with binary buffer.
+		**/
+		std::vector<FieldInfo> fields(const std::string& name, size_t offset) override
+		{
+			return std::vector<FieldInfo>(1, FieldInfo(name, offset, field_type<T>()));
+		}
+
+		size_t alignment() override
+		{
+			return alignof(T);
+		}
+	};
+
+	/**
+	* Binary buffer Parser supporting array type. While element type of the array
+	* should be same basic data type as BasicParser. DO NOT support any custom
+	* C-struct type.
+	*/
+	template <typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+	class ArrayParser : public BinaryParser {
+	public:
+		ArrayParser(size_t size) : _size(size) {};
+
+		/**
+		* @brief   Parse binary buffer and attach a name to parsed information.
+		* @param   const char *[in]- binary buffer.
+		* @returns
+		*          std::string - expression in string.
+		**/
+		std::string parse(const char* buffer) override
+		{
+			if (buffer == nullptr)
+				throw NullBufferException();
+
+            const int kARRAY_MAX_SIZE = 256;
+			const int kBASIC_TYPE_EXPR_LENGTH = 64;
+            const int kARRAY_EXPR_LENGTH = kBASIC_TYPE_EXPR_LENGTH * kARRAY_MAX_SIZE;
+			char expr[kARRAY_EXPR_LENGTH];
+
+            std::string array_format_specifier;
+			for (size_t i = 0, offset = 0; i < _size; ++i) {
+				array_format_specifier += format_specifier<T>();
+			}
+
+            std::sprintf(expr, array_format_specifier.data(), buffer);
+
+			return std::string(expr);
+		}
+
+		/**
+		* @brief   Parse binary buffer and attach a name to parsed information
+		*          in order to expressing in other place.
+		* @param   const std::string &[in] - name describing this buffer
+		* @param   const char *[in]- binary buffer.
+		* @returns std::vector<MemberInfo> sequences of parsed information with an order in accordance with binary buffer.
+		**/
+		std::vector<MemberInfo> expr(const std::string& name, const char* buffer) override
+		{
+			std::vector<MemberInfo> members;
+
+			if (buffer == nullptr)
+				return members;
+
+			for (size_t i = 0, offset = 0; i < _size; ++i) {
+				const T* pt = reinterpret_cast<const T*>(buffer + offset);
+				members.emplace_back(MemberInfo(name + "[" + to_string(i) + "]", to_string(*pt)));
+				offset += sizeof(T);
+			}
+
+			return members;
+		}
+
+        /**
+		* @brief   Parse binary buffer and save parsed data into file.
+		* @param   FILE *[in] - file pointer
+	    *          const char*[buffer] - buffer without type information
+		* @returns
+		*          -1 if fail, or 0 if success.
+		**/
+		int fprintf(FILE *fp, const char* buffer)
+		{
+			if (buffer == nullptr)
+				throw NullBufferException();
+
+			int result = 0;
+			int offset = 0;
+			FormatSpecifier& specifier = FormatSpecifier::instance();
+			const T* pt;
+
+			for (int i = 0; i < _size; ++i)
+			{
+				pt = reinterpret_cast<const T*>(buffer + offset);
+				std::fprintf(fp, format_specifier<T>(), *pt);
+				offset += sizeof(T);
+				if (i != _size - 1)
+				{
+					std::fprintf(fp, "%s", specifier.get_delimiter());
+				}
+			}
+
+			return result;
+		}
+
+		/**
+		* @brief   Character length parsed by this Binary Parser.
+		* @param   void
+		* @returns
+		*          Character length parsed by this Binary Parser.
+		**/
+		size_t length() override
+		{
+			return _size * sizeof(T);
+		}
+
+		/**
+		* @brief   Locate basic type fields parsed by this Binary Parser.
+		* @param   const std::string &[in] - name describing this buffer
+		*          size_t[in] - offset of this buffer inside the record
+		* @returns std::vector<FieldInfo> fields with an order in accordance with binary buffer.
+		**/
+		std::vector<FieldInfo> fields(const std::string& name, size_t offset) override
+		{
+			std::vector<FieldInfo> members;
+
+			for (size_t i = 0; i < _size; ++i) {
+				members.emplace_back(FieldInfo(name + "[" + to_string(i) + "]", offset, field_type<T>()));
+				offset += sizeof(T);
+			}
+
+			return members;
+		}
+
+		size_t alignment() override
+		{
+			return alignof(T);
+		}
+	private:
+		size_t _size;
+	};
+
+	/**
+	* Binary buffer Parser supporting fixed-length characters, i.e. char[N], which
+	* are padded with '\0' if shorter than N. Unlike StringParser, the length is
+	* N for every buffer, so fields following it keep their offsets.
+	*/
+	class CharArrayParser : public BinaryParser {
+	public:
+		CharArrayParser(size_t size) : _field("", 0, FormatSpecifier::Type::CHAR, size) {}
+
+		/**
+		* @brief   Parse binary buffer.
+		* @param   const char *[in]- binary buffer.
+		* @returns
+		*          std::string - characters up to the first '\0'.
+		**/
+		std::string parse(const char* buffer) override
+		{
+			if (buffer == nullptr)
+				throw NullBufferException();
+
+			return std::string(buffer, _field.textLength(buffer));
+		}
+
+		/**
+		* @brief   Parse binary buffer and attach a name to parsed information
+		*          in order to expressing in other place.
+		* @param   const std::string &[in] - name describing this buffer
+		* @param   const char *[in]- binary buffer.
+		* @returns std::vector<MemberInfo> sequences of parsed information with an order in accordance with binary buffer.
+		**/
+		std::vector<MemberInfo> expr(const std::string& name, const char* buffer) override
+		{
+			std::vector<MemberInfo> members;
+
+			if (buffer == nullptr)
+				return members;
+
+			members.emplace_back(MemberInfo(name, parse(buffer)));
+
+			return members;
+		}
+
+        /**
+		* @brief   Parse binary buffer and save parsed data into file. Characters
+		*          are written as is.
+		* @param   FILE *[in] - file pointer
+	    *          const char*[buffer] - buffer without type information
+		* @returns
+		*          count of characters written.
+		**/
+		int fprintf(FILE *fp, const char* buffer) override
+		{
+			if (buffer == nullptr)
+				throw NullBufferException();
+
+			return _field.fprintf(fp, buffer);
+		}
+
+		/**
+		* @brief   Locate the char field parsed by this Binary Parser.
+		* @param   const std::string &[in] - name describing this buffer
+		*          size_t[in] - offset of this buffer inside the record
+		* @returns std::vector<FieldInfo> fields with an order in accordance with binary buffer.
+		**/
+		std::vector<FieldInfo> fields(const std::string& name, size_t offset) override
+		{
+			return std::vector<FieldInfo>(1, FieldInfo(name, offset, FormatSpecifier::Type::CHAR, _field.length));
+		}
+
+		size_t length() override
+		{
+			return _field.length;
+		}
+	private:
+		FieldInfo _field;
+	};
+
+	/**
+	* Binary buffer Parser supporting half precision floats, i.e. float16 of IEEE
+	* 754 and bfloat16, either scalar or array. Values are formatted as float, and
+	* arrays are converted at once, see half_to_float().
+	*/
+	class HalfFloatParser : public BinaryParser {
+	public:
+		/**
+		* @param   FormatSpecifier::Type[in]- FLOAT16 or BFLOAT16.
+		*          size_t[in]- count of elements.
+		*          bool[in]- true if elements are named as array elements.
+		**/
+		HalfFloatParser(FormatSpecifier::Type type, size_t size, bool is_array)
+			: _field("", 0, type), _size(size), _is_array(is_array) {}
+
+		/**
+		* @brief   Parse binary buffer.
+		* @param   const char *[in]- binary buffer.
+		* @returns
+		*          std::string - expression in string.
+		**/
+		std::string parse(const char* buffer) override;
+
+		/**
+		* @brief   Parse binary buffer and attach a name to parsed information
+		*          in order to expressing in other place.
+		* @param   const std::string &[in] - name describing this buffer
+		* @param   const char *[in]- binary buffer.
+		* @returns std::vector<MemberInfo> sequences of parsed information with an order in accordance with binary buffer.
+		**/
+		std::vector<MemberInfo> expr(const std::string& name, const char* buffer) override;
+
+        /**
+		* @brief   Parse binary buffer and save parsed data into file.
+		* @param   FILE *[in] - file pointer
+	    *          const char*[buffer] - buffer without type information
+		* @returns
+		*          -1 if fail, or 0 if success.
+		**/
+		int fprintf(FILE *fp, const char* buffer) override;
+
+		/**
+		* @brief   Locate half precision fields parsed by this Binary Parser.
+		* @param   const std::string &[in] - name describing this buffer
+		*          size_t[in] - offset of this buffer inside the record
+		* @returns std::vector<FieldInfo> fields with an order in accordance with binary buffer.
+		**/
+		std::vector<FieldInfo> fields(const std::string& name, size_t offset) override;
+
+		size_t length() override
+		{
+			return _size * sizeof(uint16_t);
+		}
+
+		size_t alignment() override
+		{
+			return alignof(uint16_t);
+		}
+	private:
+		/**
+		* @brief   Convert elements [begin, begin + count) of buffer to float.
+		**/
+		void convert(const char *buffer, size_t begin, size_t count, float *output) const;
+
+		FieldInfo _field;
+		size_t _size;
+		bool _is_array;
+	};
+
+	/**
+	* Binary buffer Parser supporting string type, and the string buffer should be 
+	* ended with '\0'. The length of a string depends on its buffer, see lengthAt().
+	*/
+	class StringParser : public BinaryParser {
+	public:
+		/**
+		* @brief   Parse binary buffer and attach a name to parsed information.
+		* @param   const char *[in]- binary buffer.
+		*          const std::string &[in] - name describing this buffer
+		* @returns
+		*          std::string - expression in string.
+		**/
+		std::string parse(const char* buffer) override;
+
+		/**
+		* @brief   Parse binary buffer and attach a name to parsed information
+		*          in order to expressing in other place.
+		* @param   const std::string &[in] - name describing this buffer
+		* @param   const char *[in]- binary buffer.
+		* @returns std::vector<MemberInfo> sequences of parsed information with an order in accordance with binary buffer.
+		**/
+		std::vector<MemberInfo> expr(const std::string& name, const char* buffer) override;
+
+        /**
+		* @brief   Parse binary buffer and save parsed data into file.
+		* @param   FILE *[in] - file pointer
+	    *          const char*[buffer] - buffer without type information
+		* @returns
+		*          -1 if fail, or 0 if success.
+		**/
+		int fprintf(FILE *fp, const char* buffer) override
+		{
+			return std::fprintf(fp, "%s", buffer);
+		}
+
+		/**
+		* @brief   Locate basic type fields parsed by this Binary Parser. A string
+		*          has no fixed layout, so no field is located.
+		**/
+		std::vector<FieldInfo> fields(const std::string&, size_t) override
+		{
+			return std::vector<FieldInfo>();
+		}
+
+		/**
+		* @brief   A string has no fixed length.
+		* @returns
+		*          0.
+		**/
+		size_t length() override
+		{
+			return 0;
+		}
+
+		bool isFixedLength() override
+		{
+			return false;
+		}
+
+		/**
+		* @brief   Character length of a string including its '\0'.
+		**/
+		size_t lengthAt(const char *buffer, size_t available) override;
+	};
+
+	/**
+	* Binary buffer Parser supporting string prefixed with its length, e.g. a
+	* uint16_t of character count followed by characters without '\0'.
+	*/
+	class PrefixedStringParser : public BinaryParser {
+	public:
+		PrefixedStringParser(const FieldInfo &prefix): _prefix(prefix) {}
+
+		std::string parse(const char* buffer) override;
+
+		std::vector<MemberInfo> expr(const std::string& name, const char* buffer) override;
+
+		int fprintf(FILE *fp, const char* buffer) override;
+
+		std::vector<FieldInfo> fields(const std::string&, size_t) override
+		{
+			return std::vector<FieldInfo>();
+		}
+
+		size_t length() override
+		{
+			return 0;
+		}
+
+		bool isFixedLength() override
+		{
+			return false;
+		}
+
+		size_t lengthAt(const char *buffer, size_t available) override;
+	private:
+		FieldInfo _prefix;
+	};
+
+	/**
+	* Binary buffer Parser supporting array of basic type prefixed with its
+	* element count. Elements are formatted as one value separated by ';', as
+	* count of columns would differ between records otherwise.
+	*/
+	class CountedArrayParser : public BinaryParser {
+	public:
+		CountedArrayParser(const FieldInfo &prefix, const FieldInfo &element)
+			: _prefix(prefix), _element(element) {}
+
+		std::string parse(const char* buffer) override;
 
-		/**
-		* @brief   Parse binary buffer and attach a name to parsed information *          in order to expressing in other place.
-		* @param   const std::string &[in] - name descriping this buffer
-		* @param   const char *[in]- binary buffer.
-		* @returns std::vector<MemberInfo> sequences of parsed information with an order in accordance with binary buffer.
-		**/
-		virtual std::vector<MemberInfo> expr(const std::string& name, const char* buffer) = 0;
+		std::vector<MemberInfo> expr(const std::string& name, const char* buffer) override;
 
-         /**
-		* @brief   Parse binary buffer and save parsed data into file.
-		* @param   FILE *[in] - file pointer
-	    *          const char*[buffer] - buffer without type information
-		* @returns
-		*          -1 if fail, or 0 if success.
-		**/
-		virtual int fprintf(FILE *fp, const char* buffer) = 0;
+		int fprintf(FILE *fp, const char* buffer) override;
 
-		/**
-		* @brief   Character length parsed by this Binary Parser.
-		* @returns
-		*          Character length parsed by this Binary Parser.
-		**/
-		virtual size_t length() = 0;
+		std::vector<FieldInfo> fields(const std::string&, size_t) override
+		{
+			return std::vector<FieldInfo>();
+		}
+
+		size_t length() override
+		{
+			return 0;
+		}
+
+		bool isFixedLength() override
+		{
+			return false;
+		}
+
+		size_t lengthAt(const char *buffer, size_t available) override;
+	private:
+		FieldInfo _prefix;
+		FieldInfo _element;
 	};
 
 	/**
-	* Binary buffer Parser supporting basic data type, including int8_t, int16_t,
-	* int32_t, int64_t, uint8_t, uint16_t, uint32_t, uint64_t, float, double
+	* Binary buffer Parser applying attributes of a field, e.g. scaling or labels,
+	* see FieldInfo, to a basic type or array type parser. Values are formatted
+	* with the attributes, i.e. as physical values or labels. The wrapped parser
+	* is not owned by this parser.
 	*/
-	template <typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
-	class BasicParser : public BinaryParser {
+	class AttributedParser : public BinaryParser {
 	public:
+		AttributedParser(BinaryParser *parser, const FieldInfo &attributes);
+
 		/**
 		* @brief   Parse binary buffer.
 		* @param   const char *[in]- binary buffer.
 		* @returns
 		*          std::string - expression in string.
 		**/
-	    std::string parse(const char* buffer)
-		{
-			const int kBASIC_TYPE_EXPR_LENGTH = 64;
-			char expr[kBASIC_TYPE_EXPR_LENGTH] = "\0";
-
-			std::sprintf(expr, format_specifier<T>(), buffer);
-
-			return std::string(expr);
-		}
+		std::string parse(const char* buffer) override;
 
 		/**
 		* @brief   Parse binary buffer and attach a name to parsed information
-		*          in order to expressing in other place.
-		* @param   const std::string &[in] - name descriping this buffer
+		*          in order to expressing in other place. Names carry unit if
+		*          FormatSpecifier is set to do so.
+		* @param   const std::string &[in] - name describing this buffer
 		* @param   const char *[in]- binary buffer.
 		* @returns std::vector<MemberInfo> sequences of parsed information with an order in accordance with binary buffer.
 		**/
-		std::vector<MemberInfo> expr(const std::string& name, const char* buffer) override
-		{
-			std::vector<MemberInfo> members;
-
-			if (buffer == nullptr)
-				return members;
-
-			const T* pt = reinterpret_cast<const T*>(buffer);
-
-			members.emplace_back(MemberInfo(name, StorageNS::to_string(*pt)));
-
-			return members;
-		}
+		std::vector<MemberInfo> expr(const std::string& name, const char* buffer) override;
 
         /**
 		* @brief   Parse binary buffer and save parsed data into file.
@@ -269,140 +1942,100 @@ namespace StorageNS {
 		* @returns
 		*          -1 if fail, or 0 if success.
 		**/
-		int fprintf(FILE *fp, const char* buffer)
-		{
-			const T* pt = reinterpret_cast<const T*>(buffer);
-			return std::fprintf(fp, format_specifier<T>(), *pt);
-		}
+		int fprintf(FILE *fp, const char* buffer) override;
+
+		/**
+		* @brief   Locate fields with attributes parsed by this Binary Parser.
+		* @param   const std::string &[in] - name describing this buffer
+		*          size_t[in] - offset of this buffer inside the record
+		* @returns std::vector<FieldInfo> fields with an order in accordance with binary buffer.
+		**/
+		std::vector<FieldInfo> fields(const std::string& name, size_t offset) override;
 
 		/**
 		* @brief   Character length parsed by this Binary Parser.
-		* @param   void
 		* @returns
 		*          Character length parsed by this Binary Parser.
 		**/
-		size_t length() override
-		{
-			return sizeof(T);
-		}
+		size_t length() override;
+
+		/**
+		* @brief   Alignment of the wrapped parser.
+		**/
+		size_t alignment() override;
+	private:
+		BinaryParser *_parser;
+		std::vector<FieldInfo> _elements;
 	};
 
 	/**
-	* Binary buffer Parser supporting array type. While element type of the array
-	* should be same basic data type as BasicParser. DO NOT support any custom
-	* C-struct type.
+	* Binary buffer Parser splitting an integral field into bitfields, e.g. flags
+	* and small codes of a status word. Every bitfield is formatted as a value of
+	* its own, which is extracted with shift and mask, see FieldInfo.
 	*/
-	template <typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
-	class ArrayParser : public BinaryParser {
+	class BitfieldParser : public BinaryParser {
 	public:
-		ArrayParser(size_t size) : _size(size) {};
-
 		/**
-		* @brief   Parse binary buffer and attach a name to parsed information.
-		* @param   const char *[in]- binary buffer.
-		* @returns
-		*          std::string - expression in string.
+		* @param   BinaryParser *[in]- parser of the integral field, which is not
+		*          owned by this parser.
 		**/
-		std::string parse(const char* buffer) override
-		{
-			if (buffer == nullptr)
-				throw NullBufferException();
-
-            const int kARRAY_MAX_SIZE = 256;
-			const int kBASIC_TYPE_EXPR_LENGTH = 64;
-            const int kARRAY_EXPR_LENGTH = kBASIC_TYPE_EXPR_LENGTH * kARRAY_MAX_SIZE;
-			char expr[kARRAY_EXPR_LENGTH];
-
-            std::string array_format_specifier;
-			for (size_t i = 0, offset = 0; i < _size; ++i) {
-				array_format_specifier += format_specifier<T>();
-			}
+		BitfieldParser(BinaryParser *parser): _parser(parser) {}
 
-            std::sprintf(expr, array_format_specifier.data(), buffer);
+		/**
+		* @brief   Add a bitfield, located at offset 0 and named relative to the
+		*          integral field.
+		* @param   const FieldInfo &[in] - bitfield
+		**/
+		void addBitfield(const FieldInfo &bitfield);
 
-			return std::string(expr);
-		}
+		std::string parse(const char* buffer) override;
 
 		/**
 		* @brief   Parse binary buffer and attach a name to parsed information
-		*          in order to expressing in other place.
-		* @param   const std::string &[in] - name descriping this buffer
+		*          in order to expressing in other place, e.g. "status.mode".
+		* @param   const std::string &[in] - name describing this buffer
 		* @param   const char *[in]- binary buffer.
 		* @returns std::vector<MemberInfo> sequences of parsed information with an order in accordance with binary buffer.
 		**/
-		std::vector<MemberInfo> expr(const std::string& name, const char* buffer) override
-		{
-			std::vector<MemberInfo> members;
-
-			if (buffer == nullptr)
-				return members;
+		std::vector<MemberInfo> expr(const std::string& name, const char* buffer) override;
 
-			for (size_t i = 0, offset = 0; i < _size; ++i) {
-				const T* pt = reinterpret_cast<const T*>(buffer + offset);
-				members.emplace_back(MemberInfo(name + "[" + to_string(i) + "]", to_string(*pt)));
-				offset += sizeof(T);
-			}
+		int fprintf(FILE *fp, const char* buffer) override;
 
-			return members;
-		}
+		std::vector<FieldInfo> fields(const std::string& name, size_t offset) override;
 
-        /**
-		* @brief   Parse binary buffer and save parsed data into file.
-		* @param   FILE *[in] - file pointer
-	    *          const char*[buffer] - buffer without type information
-		* @returns
-		*          -1 if fail, or 0 if success.
-		**/
-		int fprintf(FILE *fp, const char* buffer)
+		size_t length() override
 		{
-			if (buffer == nullptr)
-				throw NullBufferException();
-
-			int result = 0;
-			int offset = 0;
-			FormatSpecifier& specifier = FormatSpecifier::instance();
-			const T* pt;
-
-			for (int i = 0; i < _size; ++i)
-			{
-				pt = reinterpret_cast<const T*>(buffer + offset);
-				std::fprintf(fp, format_specifier<T>(), *pt);
-				offset += sizeof(T);
-				if (i != _size - 1)
-				{
-					std::fprintf(fp, "%s", specifier.get_delimiter());
-				}
-			}
-
-			return result;
+			return _parser->length();
 		}
 
-		/**
-		* @brief   Character length parsed by this Binary Parser.
-		* @param   void
-		* @returns
-		*          Character length parsed by this Binary Parser.
-		**/
-		size_t length() override
+		size_t alignment() override
 		{
-			return _size * sizeof(T);
+			return _parser->alignment();
 		}
 	private:
-		size_t _size;
+		BinaryParser *_parser;
+		std::vector<FieldInfo> _bitfields;
 	};
 
 	/**
-	* Binary buffer Parser supporting string type, and the string buffer should be 
-	* ended with '\0'.
+	* Binary buffer Parser supporting array of a fixed-length struct type, e.g.
+	* "Point[16]", whose elements are named "points[0].x" and so on. Elements are
+	* laid out at a stride of the struct length. Fields of the struct are located
+	* once, so elements are formatted field by field at their stride instead of
+	* recursing into the struct parser.
 	*/
-	class StringParser : public BinaryParser {
+	class StructArrayParser : public BinaryParser {
 	public:
-		StringParser(): _length(0) {}
+		/**
+		* @param   BinaryParser *[in]- parser of the fixed-length struct, which is
+		*          not owned by this parser.
+		*          size_t[in]- count of elements.
+		**/
+		StructArrayParser(BinaryParser *element, size_t size);
 
 		/**
-		* @brief   Parse binary buffer and attach a name to parsed information.
+		* @brief   Parse binary buffer.
 		* @param   const char *[in]- binary buffer.
-		*          const std::string &[in] - name descriping this buffer
 		* @returns
 		*          std::string - expression in string.
 		**/
@@ -411,7 +2044,7 @@ namespace StorageNS {
 		/**
 		* @brief   Parse binary buffer and attach a name to parsed information
 		*          in order to expressing in other place.
-		* @param   const std::string &[in] - name descriping this buffer
+		* @param   const std::string &[in] - name describing this buffer
 		* @param   const char *[in]- binary buffer.
 		* @returns std::vector<MemberInfo> sequences of parsed information with an order in accordance with binary buffer.
 		**/
@@ -424,20 +2057,33 @@ namespace StorageNS {
 		* @returns
 		*          -1 if fail, or 0 if success.
 		**/
-		int fprintf(FILE *fp, const char* buffer)
-		{
-			return std::fprintf(fp, "%s", buffer);
-		}
+		int fprintf(FILE *fp, const char* buffer) override;
 
 		/**
-		* @brief   Character length parsed by this Binary Parser.
-		* @param   void
-		* @returns
-		*          Character length parsed by this Binary Parser.
+		* @brief   Locate basic type fields of all elements.
+		* @param   const std::string &[in] - name describing this buffer
+		*          size_t[in] - offset of this buffer inside the record
+		* @returns std::vector<FieldInfo> fields with an order in accordance with binary buffer.
 		**/
-		size_t length() override;
+		std::vector<FieldInfo> fields(const std::string& name, size_t offset) override;
+
+		size_t length() override
+		{
+			return _size * _stride;
+		}
+
+		size_t alignment() override
+		{
+			return _element->alignment();
+		}
 	private:
-		size_t _length;
+		BinaryParser *_element;
+		size_t _size;
+		size_t _stride;
+		// Fields of the struct at offsets inside an element.
+		std::vector<FieldInfo> _members;
+		// Every column of the struct is a located field, see fprintf().
+		bool _flat;
 	};
 
 	/**
@@ -464,6 +2110,14 @@ namespace StorageNS {
 		*/
 		bool isStructType(const std::string &type);
 
+		/**
+		* @brief   Check if a given type string indicated padding bytes, e.g. "pad[3]".
+		* @param   const std::string &[in], type description string
+		* @return
+		*          true if given type indicating padding, or false if not
+		*/
+		bool isPaddingType(const std::string &type);
+
 		/**
 		* @brief   Get parser from parser factory with type string
 		* @param   const std::string &[in], type associating parser which has been
@@ -487,10 +2141,20 @@ namespace StorageNS {
 		* @param   const std::string &[in], description type string.
 		*/
 		BinaryParser *getArrayParser(const std::string &type);
+
+		/**
+		* @brief   Take ownership of a parser which is specific to a field, e.g. a
+		*          AttributedParser, so it is released with this factory.
+		* @param   BinaryParser *[in], binary parser
+		* @returns
+		*          BinaryParser*, the given parser
+		*/
+		BinaryParser *adoptParser(BinaryParser *parser);
 	private:
 		BinaryParser* generateArrayParser(const std::string &element_type, int size);
 
 		std::map<std::string, BinaryParser*> parsers;
+		std::vector<BinaryParser*> adopted;
 	};
 
 	/**
@@ -499,7 +2163,8 @@ namespace StorageNS {
 	*/
 	class SequencedParser : public BinaryParser {
 	public:
-		SequencedParser(): _length(0) {}
+		SequencedParser(): _length(0), _fixed(true), _has_record_length(false),
+			_natural(false), _alignment(1), _pending(0) {}
 
 		/**
 		* @brief   Parse binary buffer and attach a name to parsed information.
@@ -512,7 +2177,7 @@ namespace StorageNS {
 		/**
 		* @brief   Parse binary buffer and attach a name to parsed information
 		*          in order to expressing in other place.
-		* @param   const std::string &[in] - name descriping this buffer
+		* @param   const std::string &[in] - name describing this buffer
 		* @param   const char *[in]- binary buffer.
 		* @returns std::vector<MemberInfo> sequences of parsed information with an order in accordance with binary buffer.
 		**/
@@ -528,24 +2193,170 @@ namespace StorageNS {
 		**/
 		int fprintf(FILE* fp, const char* buffer);
 
+		/**
+		* @brief   Locate basic type fields parsed by this Binary Parser. Fields
+		*          following a member of variable length cannot be located.
+		* @param   const std::string &[in] - name describing this buffer
+		*          size_t[in] - offset of this buffer inside the record
+		* @returns std::vector<FieldInfo> fields with an order in accordance with binary buffer.
+		**/
+		std::vector<FieldInfo> fields(const std::string& name, size_t offset) override;
+		std::vector<FieldInfo> fields();
+
+		/**
+		* @brief   Locate a basic type field with its full expression name, e.g.
+		*          "position.x" or "samples[3]".
+		* @param   const std::string &[in] - full name of the field
+		*          FieldInfo &[out] - located field
+		* @returns
+		*          true if found, or false if not.
+		**/
+		bool findField(const std::string &name, FieldInfo &field);
+
+		/**
+		* @brief   Locate a column of array elements with a wildcard index, e.g.
+		*          "points[*].x" or "samples[*]", as its first element and the
+		*          stride between elements, so it is read in one strided sweep.
+		* @param   const std::string &[in] - name with one "[*]"
+		*          FieldInfo &[out] - first element
+		*          size_t &[out] - byte stride between elements
+		*          size_t &[out] - count of elements
+		* @returns
+		*          true if found at a constant stride, or false if not.
+		**/
+		bool findColumn(const std::string &name, FieldInfo &field, size_t &stride, size_t &count);
+
 		/**
 		* @brief   Character length parsed by this Binary Parser.
 		* @param   void
 		* @returns
-		*          Character length parsed by this Binary Parser.
+		*          Character length parsed by this Binary Parser, or 0 if records
+		*          have variable length.
 		**/
 		size_t length() override;
 
+		/**
+		* @brief   Check if all parsers have fixed length and records have no
+		*          record length prefix.
+		**/
+		bool isFixedLength() override;
+
+		/**
+		* @brief   Character length of a record, following its record length
+		*          prefix, or else summing lengths of its members.
+		* @param   const char *[in]- binary buffer.
+		*          size_t[in] - count of available bytes in buffer
+		* @returns
+		*          Character length, or 0 if record is not complete or invalid.
+		**/
+		size_t lengthAt(const char *buffer, size_t available) override;
+
+		/**
+		* @brief   Character length of a zeroed record, whose variable members are
+		*          empty and optional members absent, e.g. to name its columns
+		*          without reading a record.
+		* @returns
+		*          Character length, at least length() of fixed length records.
+		**/
+		size_t emptyLength();
+
+		/**
+		* @brief   Prefix every record with its length in bytes, not including the
+		*          prefix. Bytes following parsed members in a record are skipped.
+		* @param   const FieldInfo &[in] - integral prefix, at offset 0
+		**/
+		void setRecordLength(const FieldInfo &prefix);
+
+		/**
+		* @brief   Lay out members added afterwards as a C compiler does, i.e. each
+		*          member at a multiple of its alignment and length rounded up to
+		*          the largest member alignment. Members are packed by default.
+		*          Alignment applies to members at fixed offsets only.
+		* @param   bool[in] - true for natural alignment, or false for packed
+		**/
+		void setNaturalAlignment(bool natural);
+
+		/**
+		* @brief   Skip bytes before the next member, or at the end of a record if
+		*          no member follows. Skipped bytes are not parsed.
+		* @param   size_t[in] - count of bytes
+		**/
+		void addPadding(size_t size);
+
+		/**
+		* @brief   Largest alignment of members if naturally aligned, or 1 if
+		*          packed.
+		**/
+		size_t alignment() override;
+
 		/**
 		* @brief   Add Binary Parser to this sequenced binary parser. This Parser will 
 		*          parse binary buffer calling parser in cached binary parser one by one
 		*          to support custom data type parsing.
-		* @param   const std::string &[in]- name descriping parser parameter.
+		* @param   const std::string &[in]- name describing parser parameter.
 		*          BinaryParser *[name] - binary parser pointer
 		**/
 		void addParser(const std::string &name, BinaryParser* parser);
+
+		/**
+		* @brief   Add an optional member, which is present only if a condition on
+		*          an earlier field holds. An absent member takes no bytes, nor
+		*          does padding before it, and is formatted as empty cells. Members from an optional member on
+		*          are not located by fields(), as records have variable length.
+		* @param   const std::string &[in]- name describing parser parameter.
+		*          BinaryParser *[name] - binary parser pointer, of fixed length
+		*          const Presence &[in] - condition of presence
+		**/
+		void addParser(const std::string &name, BinaryParser* parser, const Presence &presence);
 	private:
+		/**
+		* @brief   Offset of the first member inside a record.
+		**/
+		size_t prefixLength() const
+		{
+			return _has_record_length ? _record_length.size() : 0;
+		}
+
+		/**
+		* @brief   Character length of a member of a complete record.
+		**/
+		size_t memberLength(BinaryParser *parser, const char *buffer) const
+		{
+			return _fixed ? parser->length() : parser->lengthAt(buffer, static_cast<size_t>(-1));
+		}
+
+		/**
+		* @brief   Check if a member is present in a struct.
+		**/
+		bool isPresent(size_t index, const char *buffer) const
+		{
+			return _presence[index].holds(buffer);
+		}
+
+		/**
+		* @brief   Length of members and padding, rounded up to alignment.
+		**/
+		size_t alignedLength() const
+		{
+			return _natural && _fixed ? (_length + _alignment - 1) / _alignment * _alignment : _length;
+		}
+
 		std::vector<std::pair<std::string, BinaryParser*>> parsers;
+		// Bytes skipped before every member.
+		std::vector<size_t> _padding;
+		// Condition of presence, and count of columns if absent, of every member.
+		std::vector<Presence> _presence;
+		std::vector<size_t> _columns;
+		// Buffer to name columns of absent members.
+		std::vector<char> _zeros;
 		size_t _length;
+		// Members have fixed length.
+		bool _fixed;
+		bool _has_record_length;
+		FieldInfo _record_length;
+		bool _natural;
+		size_t _alignment;
+		// Bytes skipped before the next member.
+		size_t _pending;
 	};
 }
@@ -11,6 +11,7 @@
 #include <string>
 
 #include "BinaryParser.h"
+#include "MessageDispatcher.h"
 
 #include "ArduinoJson.hpp"
 
@@ -43,7 +44,8 @@ namespace StorageNS {
 	public:
 		/**
 		* @brief   Construct this class with a valid JSON string. If the string is not valid,
-		*          the member function isValid() will return false then.
+		*          or its layout is malformed, the member function isValid() will return
+		*          false then.
 		*/
 		JsonConfigurator(const std::string &json_string);
 
@@ -61,6 +63,34 @@ namespace StorageNS {
 		*          bool, true if it is valid, or false if not.
 		*/
 		bool isValid() override;
+
+		/**
+		* @brief   Get derived fields declared in "DerivedFields" array of objects
+		*          with "name", "expression" and optional "type", in form of
+		*          "name:type=expression;...", see parseDerivedFields().
+		* @returns
+		*          std::string, empty if no derived field is declared.
+		*/
+		std::string derivedFields();
+
+		/**
+		* @brief   Check if configuration declares a stream of several message
+		*          types in "Messages" instead of records of "TypeDescription".
+		*/
+		bool hasMessages();
+
+		/**
+		* @brief   Generate message types declared in "Messages", e.g.
+		*          {"tag": "uint16_t", "types": {"1": "Position", "2": "Status"}},
+		*          whose layouts are JSON objects of the names as keys. Every
+		*          record leads with the tag, which is part of its layout, so
+		*          every layout should start with a member of the tag type.
+		* @param   MessageDispatcher &[out] - dispatcher of message types
+		* @returns
+		*          -1 if tag or a message type is invalid, or a code is given
+		*          twice, e.g. by "1" and "01", or 0 if success.
+		*/
+		int generateMessages(MessageDispatcher &dispatcher);
 	private:
 		/**
 		* @brief   Generate binary parser with a type parameter which indicates array type or custom type.
@@ -72,6 +102,74 @@ namespace StorageNS {
 		**/
 		BinaryParser *generateParser(const char *name, const char *type, const char*concreteType);
 
+		/**
+		* @brief   Generate binary parser of a field description, including strings
+		*          and arrays prefixed with their length, and apply its attributes.
+		* @param   ArduinoJson::JsonObject[in], field description
+		* @returns
+		*          BinaryParser instance.
+		**/
+		BinaryParser *fieldParser(ArduinoJson::JsonObject obj);
+
+		/**
+		* @brief   Generate binary parser of an integral field description which
+		*          declares "bitfields", each of "name", "bits" and attributes.
+		* @param   ArduinoJson::JsonObject[in], field description
+		* @returns
+		*          BinaryParser instance, or nullptr if type is not integral. A
+		*          bitfield of malformed bits invalidates this configurator.
+		**/
+		BinaryParser *bitfieldParser(ArduinoJson::JsonObject obj);
+
+		/**
+		* @brief   Byte order of a field description, its "endian" or else "Endian"
+		*          of configuration, e.g. "big".
+		* @param   ArduinoJson::JsonObject[in], field description
+		* @returns
+		*          const char *, or nullptr if none is declared.
+		**/
+		const char *byteOrder(ArduinoJson::JsonObject obj);
+
+		/**
+		* @brief   Read per-field attributes of a field description, i.e. "scale",
+		*          "offset", "unit", "enum", byte order and "timestamp" with its
+		*          "timezone", or else "Timezone" of configuration. An "enum" key
+		*          other than a whole decimal code invalidates this configurator.
+		* @param   ArduinoJson::JsonObject[in], field description
+		*          FieldInfo &[out], field holding read attributes
+		* @returns
+		*          true if any attribute is declared, or false if not.
+		**/
+		bool fieldAttributes(ArduinoJson::JsonObject obj, FieldInfo &attributes);
+
+		/**
+		* @brief   Apply per-field attributes of a field description to its parser, i.e.
+		*          "scale", "offset", "unit", "enum", byte order and timestamp of a
+		*          basic or array type field.
+		* @param   ArduinoJson::JsonObject[in], field description
+		*          BinaryParser *[in], parser generated for field type
+		* @returns
+		*          BinaryParser *, the given parser if no attribute applies.
+		**/
+		BinaryParser *attributeParser(ArduinoJson::JsonObject obj, BinaryParser *parser);
+
+		/**
+		* @brief   Check if members of a struct are naturally aligned, following
+		*          "Alignment" of configuration, or packed by default.
+		* @param   const char *[in], name of the struct as JSON object's key
+		* @returns
+		*          true if naturally aligned, or false if packed.
+		*/
+		bool naturalAlignment(const char *key);
+
+		/**
+		* @brief   Add members and padding of a struct to parser, with alignment
+		*          of the struct. A malformed member invalidates this configurator.
+		* @param   const char *[in], name of the struct as JSON object's key
+		*          SequencedParser &[out], parser of the struct
+		*/
+		void composeMembers(const char *key, SequencedParser &parsers);
+
 		/**
 		* @brief   Compose parser with custom C-struct type. This is done with type information from other
 		*          JSON object, so key is used to locate the associated JSON object.
@@ -91,11 +189,13 @@ namespace StorageNS {
 		BinaryParser *composeStructParser(const char *key);
 
 		/**
-		* @brief   Compose array parser. This is done with type information from other
-		*          JSON object, so key is used to locate the associated JSON object.
+		* @brief   Compose array parser of a basic type, or of a fixed-length struct
+		*          type, e.g. "Point[16]", which is composed from the JSON object
+		*          of the struct name as key.
 		* @param   const char *[in], a string with name as other JSON object's key
 		* @returns
-		*          BinaryParser *.
+		*          BinaryParser *, or nullptr if element type is undeclared or
+		*          count is malformed.
 		*/
 		BinaryParser *composeArrayParser(const char *key);
 
@@ -0,0 +1,142 @@
+//=============================================================================
+/**
+* @file    FieldExpression.h
+* @version v0.1
+* @brief   Arithmetic expressions over basic type fields of binary records, e.g.
+*          "sqrt(vx*vx + vy*vy)", used to declare derived fields. An expression
+*          is compiled once into stack machine code, which is run over a batch
+*          of records one instruction at a time, so every instruction is a tight
+*          loop over a column of values. Aggregates over array elements, e.g.
+*          "mean(points[*].x)", sweep the elements at their stride.
+*/
+//=============================================================================
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "BinaryParser.h"
+
+namespace StorageNS {
+	class ExpressionCompiler;
+
+	class FieldExpression {
+	public:
+		FieldExpression(): depth(0) {}
+
+		/**
+		* @brief   Compile expression of numbers, fields, + - * / and parentheses,
+		*          and functions sqrt, abs, exp, log, log10, sin, cos, tan, asin,
+		*          acos, atan, floor, ceil, round, pow, atan2, min, max, hypot, and
+		*          aggregates sum, mean, min, max of a column of array elements,
+		*          e.g. "max(samples[*])", see SequencedParser::findColumn().
+		* @param   const std::string &[in] - expression
+		*          SequencedParser &[in] - parser locating fields
+		* @returns
+		*          -1 if expression is invalid or field is not found, or 0 if success.
+		**/
+		int compile(const std::string &expression, SequencedParser &parsers);
+
+		/**
+		* @brief   Evaluate expression for selected records of a batch.
+		* @param   const char *[in] - first record of batch
+		*          size_t[in] - record length
+		*          const uint32_t *[in] - indexes of selected records in batch
+		*          size_t[in] - count of selected records
+		*          double *[out] - values of selected records
+		*          std::vector<double> &[in] - scratch stack, reused between calls
+		**/
+		void evaluate(const char *records, size_t item_length, const uint32_t *selection, size_t count,
+			double *output, std::vector<double> &stack) const;
+
+		/**
+		* @brief   Evaluate expression for a record.
+		**/
+		double evaluate(const char *record, std::vector<double> &stack) const;
+
+	private:
+		enum class OpCode {
+			FIELD,
+			CONSTANT,
+			ADD,
+			SUBTRACT,
+			MULTIPLY,
+			DIVIDE,
+			NEGATE,
+			CALL1,
+			CALL2,
+			AGGREGATE
+		};
+
+		struct Instruction {
+			OpCode op;
+			size_t operand;
+		};
+
+		enum class Aggregate {
+			SUM,
+			MEAN,
+			MIN,
+			MAX
+		};
+
+		// Elements of an array column, the first one at field and the others
+		// following at stride.
+		struct Column {
+			FieldInfo field;
+			size_t stride;
+			size_t count;
+			Aggregate aggregate;
+		};
+
+		friend class ExpressionCompiler;
+
+		std::vector<Instruction> code;
+		std::vector<FieldInfo> fields;
+		std::vector<Column> columns;
+		std::vector<double> constants;
+		size_t depth;
+	};
+
+	/**
+	* Derived field computed by an expression, formatted as a basic type field.
+	*/
+	struct DerivedField {
+		DerivedField(): type(FormatSpecifier::Type::DOUBLE), format(std::string(), 0, FormatSpecifier::Type::DOUBLE) {}
+
+		/**
+		* @brief   Format a value of this field. Integral values are rounded and
+		*          saturated at limits of type, and NaN of them is left empty.
+		* @returns
+		*          count of characters needed, or negative if fail.
+		**/
+		int snprintf(char *output, size_t size, double value) const;
+
+		/**
+		* @brief   Store a value as this field at offset 0 of a buffer, integral
+		*          values are rounded and saturated at limits of type.
+		* @param   double[in] - value, not NaN for an integral field
+		*          char *[out] - buffer of at least 8 characters
+		**/
+		void store(double value, char *buffer) const;
+
+		int fprintf(FILE *fp, double value) const;
+
+		std::string name;
+		FormatSpecifier::Type type;
+		FieldExpression expression;
+		// Basic type field at offset 0, formatting stored values.
+		FieldInfo format;
+	};
+
+	/**
+	* @brief   Compile derived fields declared as "name=expression" or
+	*          "name:type=expression", separated by semicolons, e.g.
+	*          "speed=sqrt(vx*vx+vy*vy); power:float=v*i". Type is double if
+	*          not declared.
+	* @returns
+	*          -1 if a declaration is invalid, or 0 if success.
+	**/
+	int parseDerivedFields(const std::string &declarations, SequencedParser &parsers, std::vector<DerivedField> &derived);
+}
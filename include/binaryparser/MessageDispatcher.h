@@ -0,0 +1,110 @@
+//=============================================================================
+/**
+* @file    MessageDispatcher.h
+* @version v0.1
+* @brief   Streams multiplexing several message types, each record starting with
+*          a tag, e.g. msg_id, which selects the layout of the record. The tag
+*          is looked up in a jump table, so dispatching a record costs one read
+*          and one indexed load.
+*/
+//=============================================================================
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "BinaryParser.h"
+
+namespace StorageNS {
+	class MessageDispatcher {
+	public:
+		/**
+		* A message type, whose layout covers the whole record, tag included.
+		*/
+		struct Message {
+			int64_t code;
+			std::string name;
+			SequencedParser parsers;
+		};
+
+		MessageDispatcher(): min_code(0) {}
+
+		/**
+		* @brief   Set the integral tag leading every record.
+		* @param   const FieldInfo &[in] - tag, at offset 0
+		**/
+		void setTag(const FieldInfo &tag);
+
+		/**
+		* @brief   Add a message type of tag code. Should be called before build().
+		* @returns
+		*          false if a message type of same code is added, or true.
+		**/
+		bool addMessage(int64_t code, const std::string &name, const SequencedParser &parsers);
+
+		/**
+		* @brief   Build jump table of added message types.
+		**/
+		void build();
+
+		/**
+		* @brief   Find message type of a record.
+		* @param   const char *[in]- record buffer, at least of tag size.
+		* @returns
+		*          index of message type, or -1 if tag code is unknown.
+		**/
+		int find(const char *record) const
+		{
+			int64_t code = tag.integer(record);
+
+			if (!sparse.empty())
+			{
+				auto slot = sparse.find(code);
+				return slot == sparse.end() ? -1 : slot->second;
+			}
+
+			uint64_t slot = static_cast<uint64_t>(code) - static_cast<uint64_t>(min_code);
+			return slot < slots.size() ? slots[slot] : -1;
+		}
+
+		/**
+		* @brief   Character length of a record following its message type.
+		* @param   const char *[in]- binary buffer.
+		*          size_t[in] - count of available bytes in buffer
+		* @returns
+		*          Character length, or 0 if record is not complete or its tag
+		*          code is unknown.
+		**/
+		size_t lengthAt(const char *buffer, size_t available);
+
+		/**
+		* @brief   Check if every message type has fixed length.
+		**/
+		bool isFixedLength();
+
+		const FieldInfo &tagField() const
+		{
+			return tag;
+		}
+
+		size_t messageCount() const
+		{
+			return messages.size();
+		}
+
+		Message &message(size_t index)
+		{
+			return messages[index];
+		}
+
+	private:
+		FieldInfo tag;
+		std::vector<Message> messages;
+		// Index of message type of code min_code + i, or -1 if none.
+		std::vector<int32_t> slots;
+		int64_t min_code;
+		// Codes spread too widely for a dense table.
+		std::unordered_map<int64_t, int32_t> sparse;
+	};
+}
@@ -0,0 +1,192 @@
+//=============================================================================
+/**
+* @file    Directory.h
+* @version v0.1
+* @brief   Portable listing of regular files in a directory, checking of file
+*          identity and resolving of relative paths.
+*/
+//=============================================================================
+#pragma once
+
+#ifdef WIN32
+#include <Windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace StorageNS {
+	struct FileStatus {
+		std::string name;
+		uint64_t size;
+		int64_t modified;
+	};
+
+	/**
+	* @brief   Check if given path is an existing directory.
+	**/
+	inline bool isDirectory(const std::string &path)
+	{
+#ifdef WIN32
+		DWORD attributes = GetFileAttributesA(path.data());
+		return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+#else
+		struct stat st;
+		return stat(path.data(), &st) == 0 && S_ISDIR(st.st_mode);
+#endif
+	}
+
+	/**
+	* @brief   Check if two paths name the same existing file, e.g. through a
+	*          relative path or a link.
+	**/
+	inline bool isSameFile(const std::string &path, const std::string &other)
+	{
+#ifdef WIN32
+		BY_HANDLE_FILE_INFORMATION infos[2];
+		const std::string *paths[2] = { &path, &other };
+
+		for (int i = 0; i < 2; ++i)
+		{
+			HANDLE file = CreateFileA(paths[i]->data(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+				NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
+			if (file == INVALID_HANDLE_VALUE)
+				return false;
+			BOOL got = GetFileInformationByHandle(file, &infos[i]);
+			CloseHandle(file);
+			if (!got)
+				return false;
+		}
+
+		return infos[0].dwVolumeSerialNumber == infos[1].dwVolumeSerialNumber
+			&& infos[0].nFileIndexHigh == infos[1].nFileIndexHigh
+			&& infos[0].nFileIndexLow == infos[1].nFileIndexLow;
+#else
+		struct stat st;
+		struct stat other_st;
+		return stat(path.data(), &st) == 0 && stat(other.data(), &other_st) == 0
+			&& st.st_dev == other_st.st_dev && st.st_ino == other_st.st_ino;
+#endif
+	}
+
+	/**
+	* @brief   Get size and modification time of an existing regular file.
+	* @returns
+	*          true if success, or false if it is not a regular file.
+	**/
+	inline bool statFile(const std::string &path, FileStatus &file)
+	{
+		file.name = path;
+
+#ifdef WIN32
+		WIN32_FILE_ATTRIBUTE_DATA data;
+		if (!GetFileAttributesExA(path.data(), GetFileExInfoStandard, &data)
+			|| (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0)
+			return false;
+
+		file.size = (static_cast<uint64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+		file.modified = static_cast<int64_t>((static_cast<uint64_t>(data.ftLastWriteTime.dwHighDateTime) << 32)
+			| data.ftLastWriteTime.dwLowDateTime);
+#else
+		struct stat st;
+		if (stat(path.data(), &st) != 0 || !S_ISREG(st.st_mode))
+			return false;
+
+		file.size = static_cast<uint64_t>(st.st_size);
+		file.modified = static_cast<int64_t>(st.st_mtime);
+#endif
+
+		return true;
+	}
+
+	/**
+	* @brief   List regular files in a directory, not recursively.
+	* @param   const std::string &[in] - directory path
+	*          std::vector<FileStatus> &[out] - names, sizes and modification
+	*          times of files, in no particular order
+	* @returns
+	*          true if success, or false if directory cannot be read.
+	**/
+	inline bool listDirectory(const std::string &directory, std::vector<FileStatus> &files)
+	{
+		files.clear();
+
+#ifdef WIN32
+		WIN32_FIND_DATAA data;
+		HANDLE find = FindFirstFileA((directory + "\\*").data(), &data);
+		if (find == INVALID_HANDLE_VALUE)
+			return false;
+
+		do {
+			if ((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0)
+				continue;
+
+			FileStatus file;
+			file.name = data.cFileName;
+			file.size = (static_cast<uint64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+			file.modified = static_cast<int64_t>((static_cast<uint64_t>(data.ftLastWriteTime.dwHighDateTime) << 32)
+				| data.ftLastWriteTime.dwLowDateTime);
+			files.push_back(file);
+		} while (FindNextFileA(find, &data));
+		FindClose(find);
+#else
+		DIR *dir = opendir(directory.data());
+		if (dir == NULL)
+			return false;
+
+		for (struct dirent *entry = readdir(dir); entry != NULL; entry = readdir(dir))
+		{
+			struct stat st;
+			std::string path = directory + "/" + entry->d_name;
+			if (stat(path.data(), &st) != 0 || !S_ISREG(st.st_mode))
+				continue;
+
+			FileStatus file;
+			file.name = entry->d_name;
+			file.size = static_cast<uint64_t>(st.st_size);
+			file.modified = static_cast<int64_t>(st.st_mtime);
+			files.push_back(file);
+		}
+		closedir(dir);
+#endif
+
+		return true;
+	}
+
+	/**
+	* @brief   Resolve a path against current working directory, e.g. before the
+	*          path is passed to another process of a different directory.
+	* @returns
+	*          absolute path, the given one if already absolute, or an empty
+	*          string if working directory cannot be read.
+	**/
+	inline std::string absolutePath(const std::string &path)
+	{
+#ifdef WIN32
+		char resolved[MAX_PATH];
+		DWORD length = GetFullPathNameA(path.data(), MAX_PATH, resolved, NULL);
+		if (length == 0 || length >= MAX_PATH)
+			return std::string();
+
+		return std::string(resolved, length);
+#else
+		if (!path.empty() && path[0] == '/')
+			return path;
+
+		char directory[4096];
+		if (getcwd(directory, sizeof(directory)) == NULL)
+			return std::string();
+
+		std::string resolved = directory;
+		if (resolved.empty() || resolved[resolved.size() - 1] != '/')
+			resolved += "/";
+
+		return resolved + path;
+#endif
+	}
+}
@@ -0,0 +1,156 @@
+//=============================================================================
+/**
+* @file    MappedFile.h
+* @version v0.1
+* @brief   Read-only memory mapped file, so that binary records can be scanned
+*          directly from page cache without copying them into stream buffers.
+*/
+//=============================================================================
+#pragma once
+
+#ifdef WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cstddef>
+#include <string>
+
+namespace StorageNS {
+	/**
+	* This class maps a whole file read-only into memory. The mapping is released
+	* when destruction.
+	*/
+	class MappedFile {
+	public:
+		MappedFile()
+			:_data(nullptr), _size(0), _open(false)
+#ifdef WIN32
+			, file(INVALID_HANDLE_VALUE), mapping(NULL)
+#endif
+		{}
+
+		~MappedFile()
+		{
+			close();
+		}
+
+		/**
+		* @brief   Map given file into memory. An empty file is opened without mapping.
+		* @param   const std::string &[in] - file path, which may be absolute or relative.
+		* @returns
+		*          true if success, or false if not.
+		**/
+		bool open(const std::string &path)
+		{
+			close();
+
+#ifdef WIN32
+			file = CreateFileA(path.data(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+				NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+			if (file == INVALID_HANDLE_VALUE)
+				return false;
+
+			LARGE_INTEGER file_size;
+			if (!GetFileSizeEx(file, &file_size)) {
+				close();
+				return false;
+			}
+			_size = static_cast<size_t>(file_size.QuadPart);
+
+			if (_size != 0) {
+				mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+				if (mapping == NULL) {
+					close();
+					return false;
+				}
+				_data = static_cast<const char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+				if (_data == nullptr) {
+					close();
+					return false;
+				}
+			}
+#else
+			int fd = ::open(path.data(), O_RDONLY);
+			if (fd == -1)
+				return false;
+
+			struct stat st;
+			if (fstat(fd, &st) == -1) {
+				::close(fd);
+				return false;
+			}
+			_size = static_cast<size_t>(st.st_size);
+
+			if (_size != 0) {
+				void *address = mmap(NULL, _size, PROT_READ, MAP_SHARED, fd, 0);
+				if (address == MAP_FAILED) {
+					::close(fd);
+					_size = 0;
+					return false;
+				}
+				_data = static_cast<const char *>(address);
+				madvise(address, _size, MADV_SEQUENTIAL);
+			}
+			::close(fd);
+#endif
+			_open = true;
+
+			return true;
+		}
+
+		/**
+		* @brief   Release the mapping if it is mapped.
+		**/
+		void close()
+		{
+#ifdef WIN32
+			if (_data != nullptr)
+				UnmapViewOfFile(_data);
+			if (mapping != NULL)
+				CloseHandle(mapping);
+			if (file != INVALID_HANDLE_VALUE)
+				CloseHandle(file);
+			mapping = NULL;
+			file = INVALID_HANDLE_VALUE;
+#else
+			if (_data != nullptr)
+				munmap(const_cast<char *>(_data), _size);
+#endif
+			_data = nullptr;
+			_size = 0;
+			_open = false;
+		}
+
+		bool isOpen() const
+		{
+			return _open;
+		}
+
+		const char *data() const
+		{
+			return _data;
+		}
+
+		size_t size() const
+		{
+			return _size;
+		}
+
+	private:
+		MappedFile(const MappedFile &);
+		MappedFile &operator=(const MappedFile &);
+
+		const char *_data;
+		size_t _size;
+		bool _open;
+#ifdef WIN32
+		HANDLE file;
+		HANDLE mapping;
+#endif
+	};
+}
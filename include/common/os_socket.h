@@ -4,6 +4,7 @@
 #pragma comment(lib,"Ws2_32.lib")
 #include <winsock2.h>
 #include <ws2tcpip.h>
+#include <afunix.h>
 
 typedef SOCKET socket_t;
 
@@ -18,12 +19,16 @@ static inline int socket_destroy()
 	return WSACleanup();
 }
 
+#define MSG_NOSIGNAL 0
+
 #elif defined(_POSIX_C_SOURCE)
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/tcp.h>
 #include <arpa/inet.h>
+#include <sys/select.h>
+#include <sys/un.h>
 
 typedef int socket_t;
 #define INVALID_SOCKET -1
@@ -24,6 +24,7 @@ namespace StorageNS {
 		{
 			data = std::move(other.data);
 			length = other.length;
+			return *this;
 		}
 
 		std::unique_ptr<char[]> data;
@@ -45,5 +46,27 @@ namespace StorageNS {
 		*         buffer_t - encapsulated buffer with size contained.
 		*/
 		virtual buffer_t receive(int size) = 0;
+
+		/**
+		* @brief  Check if data is received in whole messages, e.g. datagrams,
+		*         rather than as a byte stream.
+		*/
+		virtual bool isMessageOriented() const
+		{
+			return false;
+		}
+
+		/**
+		* @brief  Receive one whole message, e.g. a datagram, of at most given
+		*         size. Receivers of a byte stream have no messages.
+		* @param  max_size [in] - the largest size of message to receive
+		* @return
+		*         buffer_t - encapsulated buffer with size of the message, or 0
+		*         if no message is received or it is larger than max_size.
+		*/
+		virtual buffer_t receiveMessage(int)
+		{
+			return buffer_t();
+		}
 	};
 }
\ No newline at end of file
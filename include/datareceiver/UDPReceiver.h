@@ -24,6 +24,16 @@ namespace StorageNS {
 		*         buffer_t - encapsulated buffer with size contained.
 		*/
 		buffer_t receive(int size) override;
+
+		bool isMessageOriented() const override
+		{
+			return true;
+		}
+
+		/**
+		* @brief  Receive one whole datagram of at most given size.
+		*/
+		buffer_t receiveMessage(int max_size) override;
 	private:
 		udplink_t link;
 
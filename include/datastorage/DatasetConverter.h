@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "StorageConverter.h"
+#include "StorageCatalog.h"
+#include <cstdio>
+
+namespace StorageNS {
+	/**
+	* This converter converts a directory of binary files as one table, see
+	* StorageCatalog. Files outside of range (when range field is the catalog
+	* time field) or not matching filter on time field are pruned by manifest.
+	* Remaining files are converted in parallel into part files, which are then
+	* appended to target CSV file in order of time.
+	*/
+	class DatasetStorageConverter: public StorageConverter {
+	public:
+		DatasetStorageConverter(): csv_file(nullptr) {}
+		~DatasetStorageConverter();
+
+		/**
+		* @brief  Set the catalog time field, timestamp by default.
+		*/
+		void setTimeField(const std::string &field);
+
+		/**
+		* @brief  Update catalog of source directory and convert selected files.
+		*         After preparing, totalItem() is the count of selected files.
+		*/
+		int prepare() override;
+
+		/**
+		* @brief  Append next converted file to target CSV file.
+		*/
+		int convertAndStore() override;
+
+		int storeHeaders() override;
+
+		/**
+		* @brief  Names of files left out by prepare() for having their own
+		*         schema which differs from the catalog schema.
+		*/
+		const std::vector<std::string> &skippedFiles() const
+		{
+			return skipped;
+		}
+
+	private:
+		std::FILE *csv_file;
+		StorageCatalog catalog;
+		std::vector<std::string> parts;
+		std::vector<std::string> skipped;
+		std::vector<DerivedField> derived;
+	};
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "StorageConverter.h"
+#include "MappedFile.h"
+#include <cstdio>
+
+namespace StorageNS {
+	/**
+	* This converter picks a target number of representative records per field
+	* from the binary file, and stores only the union of the picked records to
+	* target CSV file. Selection keeps the visual shape of every field, so spikes
+	* survive decimation. Fields are selected in parallel, each worker streams over
+	* the mapped file and keeps only the picked record numbers in memory.
+	*/
+	class DecimateStorageConverter: public StorageConverter {
+	public:
+		enum class Method {
+			MIN_MAX,  // minimum and maximum record of every pixel bucket
+			LTTB      // largest triangle three buckets
+		};
+
+		DecimateStorageConverter()
+			:csv_file(nullptr), method(Method::LTTB), target_count(1000), record_count(0), has_x_field(false) {}
+		~DecimateStorageConverter();
+
+		void setMethod(Method method);
+
+		/**
+		* @brief  Set target count of picked records per field.
+		*/
+		void setTargetCount(size_t count);
+
+		/**
+		* @brief  Set fields to decimate. All basic type fields are decimated
+		*         if not set.
+		*/
+		void setFields(const std::vector<std::string> &fields);
+
+		/**
+		* @brief  Set field used as horizontal axis by LTTB, e.g. a timestamp.
+		*         Record number is used if not set.
+		*/
+		void setXField(const std::string &field);
+
+		/**
+		* @brief  Processing files to prepare for decimation, and select records
+		*         of all fields. After preparing, totalItem() is the count of
+		*         selected records instead of records in binary file.
+		*/
+		int prepare() override;
+
+		/**
+		* @brief  Convert next selected record to text decoded item and store
+		*         this item to target CSV file.
+		*/
+		int convertAndStore() override;
+
+		int storeHeaders() override;
+
+	private:
+		/**
+		* @brief  Select record numbers of one field with configured method.
+		*/
+		std::vector<size_t> select(const FieldInfo &field);
+		std::vector<size_t> selectMinMax(const FieldInfo &field);
+		std::vector<size_t> selectLTTB(const FieldInfo &field);
+
+		double xOf(size_t item);
+		double yOf(const FieldInfo &field, size_t item);
+
+		std::FILE *csv_file;
+		std::unique_ptr<JsonConfigurator> configurator;
+		SequencedParser parsers;
+		MappedFile source_file;
+
+		Method method;
+		size_t target_count;
+		size_t record_count;
+		std::vector<std::string> field_names;
+		std::vector<FieldInfo> fields;
+		std::string x_name;
+		FieldInfo x_field;
+		bool has_x_field;
+		std::vector<size_t> selected;
+	};
+}
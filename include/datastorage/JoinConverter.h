@@ -0,0 +1,106 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "StorageConverter.h"
+#include "MappedFile.h"
+#include <cstdio>
+
+namespace StorageNS {
+	/**
+	* This converter aligns two binary files with different templates by their
+	* timestamp fields. Every left record is stored with the latest right record
+	* at or before its time, or with empty cells if there is no such record. Both
+	* files should be sorted by timestamp, so they are joined in one streaming
+	* merge pass over the mapped files. Timestamps of different units, e.g. "ns"
+	* and "ms", are compared in the finer one. Items are stored as CSV, or as a
+	* JSON array of objects.
+	*/
+	class JoinStorageConverter: public StorageConverter {
+	public:
+		JoinStorageConverter()
+			:csv_file(nullptr), right_item(0), right_total(0), right_length(0), right_columns(0),
+			left_scale(1), right_scale(1), right_prefix("right."), json(false) {}
+		~JoinStorageConverter();
+
+		/**
+		* @brief  Set right binary source file path, which may be absolute or relative.
+		*/
+		void setRightSource(const std::string &source_file);
+
+		/**
+		* @brief  Set right template file path, which may be absolute or relative.
+		*/
+		void setRightTemplate(const std::string &template_file);
+
+		/**
+		* @brief  Set timestamp fields of left and right records.
+		*/
+		void setTimestampFields(const std::string &left_field, const std::string &right_field);
+
+		/**
+		* @brief  Set prefix of right column headers, "right." by default.
+		*/
+		void setRightPrefix(const std::string &prefix);
+
+		/**
+		* @brief  Store items as a JSON array of objects, keyed by field names,
+		*         instead of CSV. Fields of a missing right record are null.
+		*/
+		void setJson(bool json);
+
+		/**
+		* @brief  Processing both files to prepare for joining.
+		*/
+		int prepare() override;
+
+		/**
+		* @brief  Join next left record with its latest right record and store
+		*         the combined item to target file.
+		*/
+		int convertAndStore() override;
+
+		int storeHeaders() override;
+
+	private:
+		/**
+		* @brief  Check if right record is at or before left record.
+		*/
+		bool notAfter(const char *right_record, const char *left_record);
+
+		/**
+		* @brief  Store a left record and its right record, or nullptr if there
+		*         is none, as a JSON object.
+		*/
+		void storeJson(const char *record, const char *right_record);
+
+		std::FILE *csv_file;
+		std::unique_ptr<JsonConfigurator> configurator;
+		std::unique_ptr<JsonConfigurator> right_configurator;
+		SequencedParser parsers;
+		SequencedParser right_parsers;
+		MappedFile source_file;
+		MappedFile right_file;
+
+		std::string right_source;
+		std::string right_template;
+		std::string timestamp_name;
+		std::string right_timestamp_name;
+		FieldInfo timestamp;
+		FieldInfo right_timestamp;
+		size_t right_item;
+		size_t right_total;
+		size_t right_length;
+		size_t right_columns;
+		// Ticks of finer timestamp unit per tick of left and right timestamps.
+		int64_t left_scale;
+		int64_t right_scale;
+		std::string right_prefix;
+		bool json;
+		// Fields of JSON objects.
+		std::vector<FieldInfo> fields;
+		std::vector<FieldInfo> right_fields;
+	};
+}
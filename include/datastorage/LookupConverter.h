@@ -0,0 +1,56 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "StorageConverter.h"
+#include "MappedFile.h"
+#include <cstdio>
+
+namespace StorageNS {
+	/**
+	* This converter looks up records with key in range set by setRange() through
+	* B+tree sidecar of source file, see StorageBTree, and stores them to target
+	* CSV file in key order. Records are read by random access from the mapped
+	* binary file, so source file need not be sorted by key.
+	*/
+	class LookupStorageConverter: public StorageConverter {
+	public:
+		LookupStorageConverter(): csv_file(nullptr), limit(0) {}
+		~LookupStorageConverter();
+
+		/**
+		* @brief  Set B+tree sidecar path. Default path of range field is used if
+		*         not set, see BTreeWriter::sidecarPath().
+		*/
+		void setBTree(const std::string &btree_file);
+
+		/**
+		* @brief  Set maximum count of stored records, 0 means no limit.
+		*/
+		void setLimit(size_t limit);
+
+		/**
+		* @brief  Look up record numbers in B+tree sidecar. After preparing,
+		*         totalItem() is the count of found records.
+		*/
+		int prepare() override;
+
+		int convertAndStore() override;
+
+		int storeHeaders() override;
+
+	private:
+		std::FILE *csv_file;
+		std::unique_ptr<JsonConfigurator> configurator;
+		SequencedParser parsers;
+		MappedFile source_file;
+
+		std::string btree_path;
+		size_t limit;
+		std::vector<uint64_t> results;
+		std::vector<DerivedField> derived;
+		std::vector<double> stack;
+	};
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "StorageConverter.h"
+#include "MessageDispatcher.h"
+#include "MappedFile.h"
+#include <cstdio>
+
+namespace StorageNS {
+	/**
+	* This converter converts a binary file multiplexing several message types,
+	* declared in "Messages" of template, see JsonConfigurator::generateMessages().
+	* Records are dispatched by their tag in one pass and each message type is
+	* stored into its own CSV file, named <target>.<message>.csv, e.g.
+	* feed.Position.csv for target feed.csv. Records of an unknown tag end the
+	* conversion, as the length of them is unknown.
+	*/
+	class MessageStorageConverter: public StorageConverter {
+	public:
+		MessageStorageConverter(): indexed_size(0) {}
+		~MessageStorageConverter();
+
+		/**
+		* @brief  Index records of binary file and their message types.
+		*         Range, filter and derived fields are not supported.
+		*/
+		int prepare() override;
+
+		/**
+		* @brief  Convert next record and store it into the CSV file of its
+		*         message type.
+		*/
+		int convertAndStore() override;
+
+		/**
+		* @brief  Headers are stored when the first record of a message type
+		*         is converted, as names of members are taken from it.
+		*/
+		int storeHeaders() override;
+
+		/**
+		* @brief  CSV file path of a message type.
+		*/
+		std::string targetOf(const std::string &message) const;
+
+		/**
+		* @brief  Count of bytes at the end of binary file which are not
+		*         converted, following an unknown tag or an incomplete record.
+		*/
+		size_t unconvertedSize() const
+		{
+			return source_file.size() - indexed_size;
+		}
+
+		/**
+		* @brief  Offset of the first byte which is not converted.
+		*/
+		size_t indexedSize() const
+		{
+			return indexed_size;
+		}
+
+	private:
+		/**
+		* @brief  Index offsets and message types of complete records.
+		*/
+		void indexRecords();
+
+		/**
+		* @brief  Open CSV file of a message type and store headers of it.
+		* @returns nullptr if file cannot be created.
+		*/
+		std::FILE *openTarget(size_t message, const char *record);
+
+		std::unique_ptr<JsonConfigurator> configurator;
+		MessageDispatcher dispatcher;
+		MappedFile source_file;
+		std::vector<uint64_t> offsets;
+		std::vector<int32_t> types;
+		// Length of the leading part of binary file made of complete records.
+		size_t indexed_size;
+		// CSV file of each message type, or nullptr if none is stored yet.
+		std::vector<std::FILE *> csv_files;
+	};
+}
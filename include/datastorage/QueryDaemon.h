@@ -0,0 +1,189 @@
+//=============================================================================
+/**
+* @file    QueryDaemon.h
+* @version v0.1
+* @brief   Long-running query service over a Unix domain socket. Compiled
+*          schemas and mapped binary files are kept between queries, so a small
+*          query costs no process startup, schema parsing or cold mapping.
+*
+*          A request is one line of tab separated "name=value" options:
+*            source=<file.dat>  schema=<type.json>  select=a,b  where=<expression>
+*            limit=N  format=csv|json
+*          The response is "OK" followed by the streamed query result in chunks,
+*          each a line of its size in hex followed by its bytes, and ended with
+*          a chunk of size 0, or else one line "ERROR <message>". A connection
+*          may send any count of requests one after another.
+*/
+//=============================================================================
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "os_socket.h"
+#include "StorageQuery.h"
+
+namespace StorageNS {
+	/**
+	* This class serves query requests of concurrent clients. An accepting
+	* thread waits for requests of all connected clients, and queues a client
+	* whose request arrives. A worker of a pool serves one request of a queued
+	* client, then gives the client back, so idle connections hold no worker.
+	* Tables of the most recently queried files are kept open.
+	*/
+	class QueryDaemon {
+	public:
+		QueryDaemon(): listener(INVALID_SOCKET), wake_sender(INVALID_SOCKET), wake_receiver(INVALID_SOCKET),
+			thread_count(0), template_("type.json"), running(false), connection_count(0), table_clock(0) {}
+		~QueryDaemon();
+
+		/**
+		* @brief  Set path of Unix domain socket. An existing socket is replaced,
+		*         while serving fails if another kind of file exists.
+		*/
+		void setSocketPath(const std::string &socket_path);
+
+		/**
+		* @brief  Set count of workers, hardware concurrency by default.
+		*/
+		void setThreadCount(size_t thread_count);
+
+		/**
+		* @brief  Set template file path of requests without schema option.
+		*/
+		void setTemplate(const std::string &template_file);
+
+		/**
+		* @brief  Listen on socket and serve clients until stop() is called.
+		* @returns
+		*         -1 if socket cannot be listened, or 0 if stopped.
+		*/
+		int serve();
+
+		void stop();
+
+	private:
+		/**
+		* A connected client and bytes of its requests received so far.
+		*/
+		struct Connection {
+			socket_t socket;
+			std::string pending;
+		};
+
+		struct CachedTable {
+			std::shared_ptr<QueryTable> table;
+			uint64_t used;
+		};
+
+		/**
+		* @brief  Get opened table of a binary file, which is opened again if the
+		*         file size has changed, e.g. records are appended. The least
+		*         recently used table is closed if too many are open.
+		*/
+		std::shared_ptr<QueryTable> table(const std::string &source_file, const std::string &template_file);
+
+		void work();
+
+		/**
+		* @brief  Receive and serve one request of a client.
+		* @returns
+		*         false if client has gone or sent an invalid request.
+		*/
+		bool serveConnection(Connection &connection);
+
+		/**
+		* @brief  Close listener and wake sockets, and remove socket file.
+		*/
+		void closeSockets();
+
+		/**
+		* @brief  Run one request line and send response to client.
+		* @returns
+		*         false if client has gone.
+		*/
+		bool serveRequest(socket_t client, const std::string &request);
+
+		std::string socket_path;
+		socket_t listener;
+		// Workers wake the accepting thread through a connection to listener.
+		socket_t wake_sender;
+		socket_t wake_receiver;
+		size_t thread_count;
+		std::string template_;
+		std::atomic<bool> running;
+
+		std::mutex client_mutex;
+		std::condition_variable client_ready;
+		// Clients with a request to serve.
+		std::deque<std::unique_ptr<Connection>> ready;
+		// Clients given back by workers, waiting for their next requests.
+		std::vector<std::unique_ptr<Connection>> returned;
+		std::atomic<size_t> connection_count;
+
+		std::mutex table_mutex;
+		std::map<std::pair<std::string, std::string>, CachedTable> tables;
+		uint64_t table_clock;
+	};
+
+	/**
+	* This class sends requests to a QueryDaemon, see request format above.
+	*/
+	class QueryClient {
+	public:
+		QueryClient(): connection(INVALID_SOCKET) {}
+		~QueryClient();
+
+		/**
+		* @returns
+		*         -1 if fail, or 0 if success.
+		*/
+		int connect(const std::string &socket_path);
+
+		/**
+		* @brief  Build a request line from options, e.g. {"where", "a > 1"}.
+		* @returns
+		*         empty string if an option contains tab or line break.
+		*/
+		static std::string request(const std::map<std::string, std::string> &options);
+
+		/**
+		* @brief  Send a request line and write response to sink.
+		* @returns
+		*         -1 if fail or daemon reports error, or 0 if success.
+		*/
+		int query(const std::string &request, QuerySink &sink);
+
+		/**
+		* @brief  Error message of daemon of the last failed query.
+		*/
+		const std::string &lastError() const
+		{
+			return error;
+		}
+
+		void disconnect();
+
+	private:
+		/**
+		* @brief  Receive a line of response, without its line break.
+		*/
+		bool receiveLine(std::string &line);
+
+		/**
+		* @brief  Receive a chunk of response and write it to sink.
+		*/
+		bool receiveChunk(size_t size, QuerySink &sink);
+
+		socket_t connection;
+		std::string error;
+		// Received bytes of response not consumed yet.
+		std::string inbox;
+	};
+}
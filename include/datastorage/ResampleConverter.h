@@ -0,0 +1,80 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "StorageConverter.h"
+#include "MappedFile.h"
+#include <cstdio>
+
+namespace StorageNS {
+	/**
+	* This converter rolls binary records up into fixed time buckets keyed by a
+	* timestamp field, and stores min/max/avg/last of every selected field plus the
+	* record count as one CSV row per bucket. Fields are read directly from the
+	* mapped binary file, so raw records are never formatted to text.
+	*/
+	class ResampleStorageConverter: public StorageConverter {
+	public:
+		ResampleStorageConverter(): csv_file(nullptr), interval(1) {}
+		~ResampleStorageConverter();
+
+		/**
+		* @brief  Set the field which buckets are keyed by. Records are expected
+		*         in ascending order of this field.
+		*/
+		void setTimestampField(const std::string &field);
+
+		/**
+		* @brief  Set bucket width in units of timestamp field, e.g. 1000 for 1 s
+		*         buckets over a millisecond timestamp.
+		*/
+		void setInterval(double interval);
+
+		/**
+		* @brief  Set fields to roll up. All basic type fields except timestamp
+		*         field are rolled up if not set.
+		*/
+		void setFields(const std::vector<std::string> &fields);
+
+		/**
+		* @brief  Processing files to prepare for resampling, including parser
+		*         generation, field locating and source file mapping.
+		*/
+		int prepare() override;
+
+		/**
+		* @brief  Roll up records of the next bucket and store one row of this
+		*         bucket to target CSV file.
+		*/
+		int convertAndStore() override;
+
+		int storeHeaders() override;
+
+	private:
+		struct Rollup {
+			double min;
+			double max;
+			double sum;
+			double last;
+		};
+
+		/**
+		* @brief  Calculate the bucket number of given record.
+		*/
+		int64_t bucketOf(const char *record);
+
+		std::FILE *csv_file;
+		std::unique_ptr<JsonConfigurator> configurator;
+		SequencedParser parsers;
+		MappedFile source_file;
+
+		std::string timestamp_name;
+		std::vector<std::string> field_names;
+		FieldInfo timestamp;
+		std::vector<FieldInfo> fields;
+		std::vector<Rollup> rollups;
+		double interval;
+	};
+}
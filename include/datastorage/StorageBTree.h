@@ -0,0 +1,202 @@
+//=============================================================================
+/**
+* @file    StorageBTree.h
+* @version v0.1
+* @brief   B+tree sidecar of binary file, mapping key of a field to record number.
+*          The tree is stored in fixed-size pages, so it can be read through a
+*          file mapping. It is built either by bulk loading from an existing
+*          binary file, or incrementally while records are appended.
+*/
+//=============================================================================
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "BinaryParser.h"
+#include "MappedFile.h"
+
+namespace StorageNS {
+	/**
+	* Header of B+tree sidecar, stored at page 0.
+	*/
+	struct BTreeHeader {
+		char magic[4];
+		uint32_t version;
+		uint32_t page_size;
+		uint32_t key_offset;
+		// Layout code of key field, see FieldInfo::layoutCode().
+		uint32_t key_type;
+		uint32_t reserved;
+		uint64_t item_length;
+		uint64_t root;
+		uint64_t height;
+		uint64_t page_count;
+		uint64_t entry_count;
+	};
+
+	/**
+	* Header of every tree page, followed by entries. Leaves and inner pages of a
+	* level are linked by next page number, 0 means no next page.
+	*/
+	struct BTreePageHeader {
+		uint16_t type;
+		uint16_t count;
+		uint32_t reserved;
+		uint64_t next;
+	};
+
+	/**
+	* Leaf entries are ordered by key and then record number, key is the sort key
+	* of field, see FieldInfo::sortKey().
+	*/
+	struct BTreeLeafEntry {
+		uint64_t key;
+		uint64_t item;
+	};
+
+	/**
+	* Inner entry points to a child whose entries are not less than (key, item),
+	* while (key, item) of the first entry of a page is ignored.
+	*/
+	struct BTreeInnerEntry {
+		uint64_t key;
+		uint64_t item;
+		uint64_t child;
+	};
+
+	/**
+	* This class builds B+tree sidecar by bulk loading, or maintains it by
+	* inserting entries. Touched pages are cached and written back by flush().
+	*/
+	class BTreeWriter {
+	public:
+		BTreeWriter() {}
+		~BTreeWriter();
+
+		/**
+		* @brief  Default B+tree sidecar path of a binary file indexed by field.
+		*/
+		static std::string sidecarPath(const std::string &source_file, const std::string &field_name)
+		{
+			return source_file + "." + field_name + ".btree";
+		}
+
+		/**
+		* @brief  Build B+tree sidecar of an existing binary file with full pages.
+		*         Keys of all records are extracted and sorted in memory, taking
+		*         16 bytes per record.
+		* @returns
+		*         -1 if fail, or 0 if success.
+		*/
+		static int bulkLoad(const std::string &source_file, const FieldInfo &field,
+			size_t item_length, const std::string &btree_file);
+
+		/**
+		* @brief  Create an empty B+tree sidecar, truncating existing one.
+		* @returns
+		*         -1 if fail, or 0 if success.
+		*/
+		int create(const std::string &btree_file, const FieldInfo &field, size_t item_length);
+
+		/**
+		* @brief  Open an existing B+tree sidecar built with same field and record
+		*         length for inserting.
+		* @returns
+		*         -1 if fail or not matched, or 0 if success.
+		*/
+		int open(const std::string &btree_file, const FieldInfo &field, size_t item_length);
+
+		bool isOpen();
+
+		/**
+		* @brief  Insert key of a record.
+		* @returns
+		*         -1 if fail, or 0 if success.
+		*/
+		int insert(uint64_t key, uint64_t item);
+
+		/**
+		* @brief  Write cached dirty pages and header back to sidecar.
+		*/
+		int flush();
+
+		void close();
+
+	private:
+		struct CachedPage {
+			std::vector<char> data;
+			bool dirty;
+		};
+
+		struct Split {
+			uint64_t key;
+			uint64_t item;
+			uint64_t page;
+		};
+
+		/**
+		* @brief  Get a page from cache, loading it from sidecar if not cached.
+		*/
+		char *page(uint64_t number, bool dirty);
+
+		/**
+		* @brief  Allocate a new zeroed page at the end of sidecar.
+		*/
+		uint64_t allocate();
+
+		/**
+		* @brief  Insert entry into subtree of given page.
+		* @returns
+		*         true if the page is split, with new right page in split.
+		*/
+		bool insertInto(uint64_t number, uint64_t key, uint64_t item, Split &split);
+
+		std::fstream stream;
+		BTreeHeader header;
+		std::unordered_map<uint64_t, CachedPage> pages;
+	};
+
+	/**
+	* This class looks up key ranges in a mapped B+tree sidecar.
+	*/
+	class BTreeIndex {
+	public:
+		BTreeIndex(): header(nullptr) {}
+
+		/**
+		* @brief  Map B+tree sidecar built with same field and record length.
+		* @returns
+		*         -1 if fail or not matched, or 0 if success.
+		*/
+		int open(const std::string &btree_file, const FieldInfo &field, size_t item_length);
+
+		/**
+		* @brief  Get record numbers with key in [begin_key, end_key], in order of
+		*         key and then record number.
+		* @param  uint64_t[in] - lower key, inclusive
+		*         uint64_t[in] - upper key, inclusive
+		*         size_t[in] - maximum count of record numbers
+		*/
+		std::vector<uint64_t> lookup(uint64_t begin_key, uint64_t end_key, size_t limit);
+
+		/**
+		* @brief  Count of entries in this tree.
+		*/
+		uint64_t size() const
+		{
+			return header->entry_count;
+		}
+
+	private:
+		const char *page(uint64_t number) const
+		{
+			return btree_file.data() + number * header->page_size;
+		}
+
+		MappedFile btree_file;
+		const BTreeHeader *header;
+	};
+}
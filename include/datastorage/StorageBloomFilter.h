@@ -0,0 +1,123 @@
+//=============================================================================
+/**
+* @file    StorageBloomFilter.h
+* @version v0.1
+* @brief   Bloom filter sidecar of binary file. The sidecar keeps a Bloom filter
+*          of selected key fields for every block of records, so that point
+*          lookups, e.g. "txn_id == 42", read only blocks which may contain the
+*          key. The sidecar is a flat array read through a file mapping.
+*/
+//=============================================================================
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "BinaryParser.h"
+#include "MappedFile.h"
+#include "StoragePredicate.h"
+
+namespace StorageNS {
+	/**
+	* Header of Bloom filter sidecar, followed by BloomFilterField array and then
+	* filter words. Filters of a field are stored block by block.
+	*/
+	struct BloomFilterHeader {
+		char magic[4];
+		uint32_t version;
+		uint64_t block_records;
+		uint64_t item_length;
+		uint64_t block_count;
+		uint32_t field_count;
+		uint32_t reserved;
+		// Size and modification time of binary file when sidecar was built.
+		uint64_t source_size;
+		int64_t source_modified;
+	};
+
+	struct BloomFilterField {
+		uint32_t offset;
+		// Layout code of field, see FieldInfo::layoutCode().
+		uint32_t type;
+		uint32_t hash_count;
+		uint32_t block_words;
+		uint64_t first_word;
+	};
+
+	/**
+	* Configuration of Bloom filter of a field.
+	*/
+	struct BloomFilterConfig {
+		BloomFilterConfig(): bits_per_key(10) {}
+		BloomFilterConfig(const FieldInfo &field, double bits_per_key)
+			:field(field), bits_per_key(bits_per_key) {}
+
+		/**
+		* @brief  Bits per key needed by given false positive rate, e.g. 0.01.
+		*/
+		static double bitsPerKey(double false_positive_rate);
+
+		FieldInfo field;
+		double bits_per_key;
+	};
+
+	class BlockBloomFilter {
+	public:
+		BlockBloomFilter(): header(nullptr), fields(nullptr), words(nullptr) {}
+
+		/**
+		* @brief  Default Bloom filter sidecar path of a binary file.
+		*/
+		static std::string sidecarPath(const std::string &source_file)
+		{
+			return source_file + ".bloom";
+		}
+
+		/**
+		* @brief  Build Bloom filter sidecar of given fields for an existing binary
+		*         file. Blocks are processed in parallel, and filters of a block
+		*         are written once it is done, so only filters of the blocks in
+		*         progress are kept in memory.
+		* @returns
+		*         -1 if fail, or 0 if success.
+		*/
+		static int build(const std::string &source_file, const std::vector<BloomFilterConfig> &configs,
+			size_t item_length, size_t block_records, const std::string &bloom_file);
+
+		/**
+		* @brief  Map Bloom filter sidecar built with same record length from binary
+		*         file as it is now. A sidecar of a file changed since, e.g. appended
+		*         by store, is not matched.
+		* @returns
+		*         -1 if fail or not matched, or 0 if success.
+		*/
+		int open(const std::string &bloom_file, const std::string &source_file, size_t item_length);
+
+		bool isOpen() const
+		{
+			return header != nullptr;
+		}
+
+		size_t blockRecords() const
+		{
+			return static_cast<size_t>(header->block_records);
+		}
+
+		/**
+		* @brief  Check if a block may hold records matching all equality predicates
+		*         on filtered fields. Other predicates always may match.
+		*/
+		bool mayMatch(size_t block, const std::vector<Predicate> &predicates) const;
+
+	private:
+		/**
+		* @brief  Index of field in Bloom filter sidecar, or -1 if it is not filtered.
+		*/
+		int fieldIndex(const FieldInfo &field) const;
+
+		MappedFile bloom_file;
+		const BloomFilterHeader *header;
+		const BloomFilterField *fields;
+		const uint64_t *words;
+	};
+}
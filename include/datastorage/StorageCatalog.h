@@ -0,0 +1,134 @@
+//=============================================================================
+/**
+* @file    StorageCatalog.h
+* @version v0.1
+* @brief   Catalog of a directory of binary files, e.g. rotated captures. A
+*          manifest file in the directory records schema hash, record count and
+*          time range of every file, so that files outside of a queried time
+*          range are pruned without opening them. The manifest is updated for
+*          new, changed and removed files whenever the catalog is opened.
+*/
+//=============================================================================
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "BinaryParserConfigurator.h"
+#include "StoragePredicate.h"
+
+namespace StorageNS {
+	struct CatalogEntry {
+		std::string name;
+		uint64_t size;
+		int64_t modified;
+		uint64_t schema_hash;
+		uint64_t record_count;
+		// Smallest and largest sort key of time field, see FieldInfo::sortKey().
+		uint64_t first_key;
+		uint64_t last_key;
+	};
+
+	/**
+	* This class maintains the manifest of a directory. The schema of a file is
+	* "<name>.json" beside "<name>.dat" if it exists, or the catalog template.
+	*/
+	class StorageCatalog {
+	public:
+		StorageCatalog(): time_name("timestamp"), suffix(".dat"), schema_hash(0) {}
+
+		/**
+		* @brief  Manifest file path of a directory.
+		*/
+		static std::string manifestPath(const std::string &directory)
+		{
+			return directory + "/manifest.dsc";
+		}
+
+		/**
+		* @brief  Hash of record layout, which does not depend on formatting of
+		*         schema file.
+		*/
+		static uint64_t schemaHash(SequencedParser &parsers);
+
+		/**
+		* @brief  Set the field whose range is recorded, timestamp by default.
+		*/
+		void setTimeField(const std::string &field);
+
+		/**
+		* @brief  Set file name suffix of binary files, ".dat" by default.
+		*/
+		void setSuffix(const std::string &suffix);
+
+		/**
+		* @brief  Load manifest of directory, and update it with binary files in
+		*         directory. Changed and new files are scanned in parallel.
+		* @returns
+		*         -1 if fail, or 0 if success.
+		*/
+		int open(const std::string &directory, const std::string &template_file);
+
+		/**
+		* @brief  Get paths of files with the catalog schema, whose time range
+		*         overlaps [begin_key, end_key] and may match predicates on time
+		*         field, in order of time.
+		*/
+		std::vector<std::string> select(uint64_t begin_key, uint64_t end_key,
+			const std::vector<Predicate> &predicates) const;
+
+		/**
+		* @brief  Get names of files whose own schema differs from the catalog
+		*         schema or is invalid, which select() leaves out.
+		*/
+		std::vector<std::string> mismatched() const;
+
+		const std::vector<CatalogEntry> &entries() const
+		{
+			return entries_;
+		}
+
+		/**
+		* @brief  Derived fields declared in the catalog template, see
+		*         JsonConfigurator::derivedFields().
+		*/
+		std::string derivedFields()
+		{
+			return configurator->derivedFields();
+		}
+
+		/**
+		* @brief  Parsers of the catalog template.
+		*/
+		SequencedParser &parsers()
+		{
+			return parsers_;
+		}
+
+		const FieldInfo &timeField() const
+		{
+			return time_field;
+		}
+
+	private:
+		int load();
+		int save();
+
+		/**
+		* @brief  Scan a binary file for record count and time range.
+		*/
+		void scan(CatalogEntry &entry);
+
+		std::string directory;
+		std::string template_;
+		std::string time_name;
+		std::string suffix;
+
+		std::unique_ptr<JsonConfigurator> configurator;
+		SequencedParser parsers_;
+		FieldInfo time_field;
+		uint64_t schema_hash;
+		std::vector<CatalogEntry> entries_;
+	};
+}
@@ -5,12 +5,16 @@
 #include <string>
 
 #include "BinaryParserConfigurator.h"
+#include "FieldExpression.h"
+#include "StoragePredicate.h"
+#include "StorageZoneMap.h"
+#include "StorageBloomFilter.h"
 #include <cstdio>
 
 namespace StorageNS {
 	class StorageConverter {
 	public:
-		StorageConverter():total_item(0), current_item(0) {}
+		StorageConverter():total_item(0), current_item(0), has_range(false) {}
 		virtual ~StorageConverter() {};
 
 		/**
@@ -28,6 +32,29 @@ namespace StorageNS {
 		*/
 		void setTemplate(const std::string &template_file);
 
+		/**
+		* @brief  Restrict conversion to records with field value in [begin, end].
+		*         An empty begin or end leaves that side unbounded. Source file
+		*         should be sorted by this field. If index sidecar of source file
+		*         exists, only located blocks are read.
+		*/
+		void setRange(const std::string &field, const std::string &begin, const std::string &end);
+
+		/**
+		* @brief  Restrict conversion to records matching a conjunction of
+		*         comparisons, e.g. "temperature > 90 && mode == 2", see
+		*         parsePredicates(). If zone map or Bloom filter sidecar of source
+		*         file exists, blocks which cannot match are skipped.
+		*/
+		void setFilter(const std::string &expression);
+
+		/**
+		* @brief  Append derived fields to stored records, declared as
+		*         "name=expression;...", see parseDerivedFields(). Fields declared
+		*         in template are appended as well.
+		*/
+		void setDerivedFields(const std::string &declarations);
+
 		/**
 		* @brief  Get total item counts in binary file.
 		*/
@@ -57,6 +84,49 @@ namespace StorageNS {
 		virtual int storeHeaders() = 0;
 
 	protected:
+		/**
+		* @brief  Parse configured filter into predicates, and locate range field
+		*         and its keys if range is configured.
+		* @returns -1 if range or filter is invalid, or 0 if success.
+		*/
+		int compileFilter(SequencedParser &parsers);
+
+		/**
+		* @brief  Convert configured range to inclusive keys of a field, see
+		*         FieldInfo::boundKeyOf(). A range holding no value of the field
+		*         has begin_key greater than end_key.
+		* @returns -1 if a bound is invalid, or 0 if success.
+		*/
+		int compileRange(const FieldInfo &field, uint64_t &begin_key, uint64_t &end_key) const;
+
+		/**
+		* @brief  Locate records to convert with configured range and filter. This
+		*         sets current_item to the first record to read and total_item to
+		*         the end of records to read.
+		* @returns -1 if range or filter is invalid, or 0 if success.
+		*/
+		int locateRecords(SequencedParser &parsers);
+
+		/**
+		* @brief  Check if a record located by locateRecords() is inside range and
+		*         matches filter.
+		*/
+		bool accepts(const char *record);
+
+		/**
+		* @brief  Get the first record at or after given record which is not in a
+		*         block skipped by zone map or Bloom filter.
+		*/
+		size_t nextCandidate(size_t item);
+
+		/**
+		* @brief  Create an empty part file of target, whose name is not taken
+		*         yet, so that existing files and parts of another conversion to
+		*         the same target are not overwritten.
+		* @returns path of part file, or empty if it cannot be created.
+		*/
+		std::string createPartFile(size_t index) const;
+
 		std::string source;
 		std::string target;
 		std::string template_;
@@ -64,10 +134,28 @@ namespace StorageNS {
 		size_t total_item;
 		size_t current_item;
 		size_t item_length;
+
+		bool has_range;
+		std::string range_name;
+		std::string range_begin;
+		std::string range_end;
+		FieldInfo range_field;
+		uint64_t range_begin_key;
+		uint64_t range_end_key;
+
+		std::string derivation;
+
+		std::string filter;
+		std::vector<Predicate> predicates;
+		ZoneMap zone_map;
+		BlockBloomFilter bloom_filter;
 	};
 
 	class CsvStorageConverter: public StorageConverter {
 	public:
+		CsvStorageConverter(): csv_file(nullptr), batch_begin(0), batch_count(0), selected(0) {}
+		~CsvStorageConverter();
+
 		/**
 		* @brief  Processing files to prepare for converting and storage.
 		*         Including configuration of target CSV file, JSON decoding
@@ -84,9 +172,29 @@ namespace StorageNS {
 
 		int storeHeaders() override;
 	private:
+		/**
+		* @brief  Read a batch of records from current_item, select records
+		*         accepted by range and filter, and evaluate derived fields of
+		*         them in one pass per field, see FieldExpression::evaluate().
+		* @returns -1 if records cannot be read, or 0 if success.
+		*/
+		int loadBatch();
+
 		std::FILE *csv_file;
 		std::unique_ptr<JsonConfigurator> configurator;
 		SequencedParser parsers;
 		std::ifstream source_stream;
+		std::vector<DerivedField> derived;
+		std::vector<double> stack;
+
+		// Records of batch_begin + i, selected ones, the next selected one to
+		// meet, and values of derived field d of selected record k at
+		// d * selection.size() + k.
+		std::vector<char> batch;
+		size_t batch_begin;
+		size_t batch_count;
+		std::vector<uint32_t> selection;
+		size_t selected;
+		std::vector<double> derived_values;
 	};
 }
\ No newline at end of file
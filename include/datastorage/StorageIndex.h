@@ -0,0 +1,131 @@
+//=============================================================================
+/**
+* @file    StorageIndex.h
+* @version v0.1
+* @brief   Sparse index sidecar of binary file. The sidecar keeps the key of the
+*          first record of every N records, so that a key range of a binary file
+*          sorted by key can be located with binary search instead of a full scan.
+*/
+//=============================================================================
+#pragma once
+
+#include <fstream>
+#include <string>
+
+#include "BinaryParser.h"
+#include "MappedFile.h"
+
+namespace StorageNS {
+	/**
+	* Header of index sidecar, followed by IndexEntry array.
+	*/
+	struct IndexHeader {
+		char magic[4];
+		uint32_t version;
+		uint64_t interval;
+		uint64_t item_length;
+		uint32_t key_offset;
+		// Layout code of key field, see FieldInfo::layoutCode().
+		uint32_t key_type;
+	};
+
+	/**
+	* Key of the first record of a block of N records, see FieldInfo::sortKey().
+	*/
+	struct IndexEntry {
+		uint64_t key;
+		uint64_t item;
+	};
+
+	/**
+	* This class appends index entries while records are appended to binary file.
+	*/
+	class IndexWriter {
+	public:
+		IndexWriter(): interval(0), item(0) {}
+
+		/**
+		* @brief  Create index sidecar with key field of records.
+		* @param  const std::string &[in] - index sidecar path
+		*         const FieldInfo &[in] - key field
+		*         size_t[in] - count of records per index entry
+		*         size_t[in] - record length
+		* @returns
+		*         -1 if fail, or 0 if success.
+		*/
+		int open(const std::string &index_file, const FieldInfo &field, size_t interval, size_t item_length);
+
+		bool isOpen();
+
+		/**
+		* @brief  Notify that a record has been appended to binary file.
+		*/
+		void append(const char *record)
+		{
+			if (item % interval == 0)
+				write(record);
+			++item;
+		}
+
+		void flush();
+
+	private:
+		void write(const char *record);
+
+		std::ofstream stream;
+		FieldInfo field;
+		size_t interval;
+		uint64_t item;
+	};
+
+	/**
+	* This class looks up key ranges in a mapped index sidecar.
+	*/
+	class StorageIndex {
+	public:
+		StorageIndex(): entries(nullptr), entry_count(0) {}
+
+		/**
+		* @brief  Default index sidecar path of a binary file.
+		*/
+		static std::string sidecarPath(const std::string &source_file)
+		{
+			return source_file + ".idx";
+		}
+
+		/**
+		* @brief  Build index sidecar for an existing binary file.
+		* @returns
+		*         -1 if fail, or 0 if success.
+		*/
+		static int build(const std::string &source_file, const FieldInfo &field,
+			size_t item_length, size_t interval, const std::string &index_file);
+
+		/**
+		* @brief  Map index sidecar, which should be built with same key field and
+		*         record length from binary file as it is now. Entries are checked
+		*         to be sorted, and a sample of them against records of binary
+		*         file, so that a sidecar of a file rewritten since is not matched.
+		*         Records appended after the last entry are not checked.
+		* @returns
+		*         -1 if fail or not matched, or 0 if success.
+		*/
+		int open(const std::string &index_file, const std::string &source_file,
+			const FieldInfo &field, size_t item_length);
+
+		/**
+		* @brief  Locate records which may have key in [begin_key, end_key] of a
+		*         binary file sorted by key.
+		* @param  uint64_t[in] - lower key, inclusive
+		*         uint64_t[in] - upper key, inclusive
+		*         size_t &[in, out] - first record to scan
+		*         size_t &[in, out] - end of records to scan, exclusive
+		*/
+		void range(uint64_t begin_key, uint64_t end_key, size_t &begin_item, size_t &end_item);
+
+	private:
+		MappedFile index_file;
+		const IndexEntry *entries;
+		size_t entry_count;
+	};
+}
@@ -0,0 +1,83 @@
+//=============================================================================
+/**
+* @file    StoragePredicate.h
+* @version v0.1
+* @brief   Comparison predicates on basic type fields of binary records, e.g.
+*          "temperature > 90". Values are compared with sort keys of fields, see
+*          FieldInfo::sortKey(), so a predicate can also be checked against key
+*          ranges of sidecar files.
+*/
+//=============================================================================
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "BinaryParser.h"
+
+namespace StorageNS {
+	struct Predicate {
+		enum class Operator {
+			LESS,
+			LESS_EQUAL,
+			GREATER,
+			GREATER_EQUAL,
+			EQUAL,
+			NOT_EQUAL
+		};
+
+		/**
+		* @brief  Check if a record matches this predicate.
+		*/
+		bool match(const char *record) const
+		{
+			return matchKey(field.sortKey(record));
+		}
+
+		/**
+		* @brief  Check if a key matches this predicate.
+		*/
+		bool matchKey(uint64_t value) const
+		{
+			switch (op) {
+			case Operator::LESS: return value < key;
+			case Operator::LESS_EQUAL: return value <= key;
+			case Operator::GREATER: return value > key;
+			case Operator::GREATER_EQUAL: return value >= key;
+			case Operator::EQUAL: return value == key;
+			default: return value != key;
+			}
+		}
+
+		/**
+		* @brief  Check if any key in [min, max] may match this predicate.
+		*/
+		bool mayMatch(uint64_t min, uint64_t max) const
+		{
+			switch (op) {
+			case Operator::LESS: return min < key;
+			case Operator::LESS_EQUAL: return min <= key;
+			case Operator::GREATER: return max > key;
+			case Operator::GREATER_EQUAL: return max >= key;
+			case Operator::EQUAL: return min <= key && key <= max;
+			default: return !(min == key && max == key);
+			}
+		}
+
+		FieldInfo field;
+		Operator op;
+		uint64_t key;
+	};
+
+	/**
+	* @brief   Parse a conjunction of comparisons, e.g. "a > 1 && b <= 2.5", where
+	*          "and" is accepted as well as "&&", and operators are <, <=, >, >=,
+	*          ==, = and !=.
+	* @param   const std::string &[in] - expression
+	*          SequencedParser &[in] - parser locating fields
+	*          std::vector<Predicate> &[out] - parsed predicates
+	* @returns
+	*          -1 if expression is invalid or field is not found, or 0 if success.
+	**/
+	int parsePredicates(const std::string &expression, SequencedParser &parsers, std::vector<Predicate> &predicates);
+}
@@ -0,0 +1,325 @@
+//=============================================================================
+/**
+* @file    StorageQuery.h
+* @version v0.1
+* @brief   Ad-hoc query of binary file, running as a pipeline of operators
+*          scan -> filter -> limit -> project -> format. Operators pass batches
+*          of records of the mapped file, selected records of a batch are kept in
+*          a selection vector, so records are never copied and every operator
+*          works on a whole batch in a tight loop.
+*/
+//=============================================================================
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "BinaryParserConfigurator.h"
+#include "FieldExpression.h"
+#include "MappedFile.h"
+#include "StoragePredicate.h"
+#include "StorageZoneMap.h"
+#include "StorageBloomFilter.h"
+#include <cstdio>
+
+namespace StorageNS {
+	/**
+	* Batch of consecutive records, with indexes of selected records in batch.
+	*/
+	struct RecordBatch {
+		const char *records;
+		size_t first_item;
+		std::vector<uint32_t> selection;
+	};
+
+	class QueryOperator {
+	public:
+		virtual ~QueryOperator() {}
+
+		/**
+		* @brief  Produce next batch with at least one selected record.
+		* @returns
+		*         false if there is no more batch.
+		*/
+		virtual bool next(RecordBatch &batch) = 0;
+	};
+
+	/**
+	* This operator reads batches of records from mapped file, skipping blocks
+	* excluded by zone map or Bloom filter if given.
+	*/
+	class ScanOperator: public QueryOperator {
+	public:
+		ScanOperator(const char *data, size_t record_count, size_t item_length, size_t batch_records)
+			:data(data), record_count(record_count), item_length(item_length),
+			batch_records(batch_records), current_item(0), zone_map(nullptr),
+			bloom_filter(nullptr), predicates(nullptr) {}
+
+		/**
+		* @brief  Skip blocks which cannot match predicates, sidecars which are
+		*         not open are ignored.
+		*/
+		void setSkipping(const ZoneMap *zone_map, const BlockBloomFilter *bloom_filter,
+			const std::vector<Predicate> *predicates);
+
+		bool next(RecordBatch &batch) override;
+
+	private:
+		bool skipped(size_t item) const;
+
+		const char *data;
+		size_t record_count;
+		size_t item_length;
+		size_t batch_records;
+		size_t current_item;
+		const ZoneMap *zone_map;
+		const BlockBloomFilter *bloom_filter;
+		const std::vector<Predicate> *predicates;
+	};
+
+	/**
+	* This operator keeps records matching all predicates, checking a predicate
+	* on the whole selection before the next predicate.
+	*/
+	class FilterOperator: public QueryOperator {
+	public:
+		FilterOperator(QueryOperator &child, size_t item_length, const std::vector<Predicate> &predicates)
+			:child(child), item_length(item_length), predicates(predicates) {}
+
+		bool next(RecordBatch &batch) override;
+
+	private:
+		QueryOperator &child;
+		size_t item_length;
+		const std::vector<Predicate> &predicates;
+	};
+
+	/**
+	* This operator stops the pipeline after given count of records, so that
+	* upstream operators do not read further batches.
+	*/
+	class LimitOperator: public QueryOperator {
+	public:
+		LimitOperator(QueryOperator &child, size_t limit)
+			:child(child), remaining(limit) {}
+
+		bool next(RecordBatch &batch) override;
+
+	private:
+		QueryOperator &child;
+		size_t remaining;
+	};
+
+	/**
+	* Output column, which is a field of record or a derived field.
+	*/
+	struct QueryColumn {
+		QueryColumn(): derived(-1) {}
+
+		FieldInfo field;
+		// Index of derived field, or -1 for field of record.
+		int derived;
+	};
+
+	/**
+	* This operator binds output columns to batches. Derived and scaled columns
+	* are evaluated for the whole selection of a batch, and the formatter writes
+	* projected columns of selected records.
+	*/
+	class ProjectOperator: public QueryOperator {
+	public:
+		ProjectOperator(QueryOperator &child, size_t item_length, const std::vector<QueryColumn> &columns,
+			const std::vector<DerivedField> &derived)
+			:child(child), item_length(item_length), columns_(columns), derived(derived), values(columns.size()) {}
+
+		bool next(RecordBatch &batch) override;
+
+		const std::vector<QueryColumn> &columns() const
+		{
+			return columns_;
+		}
+
+		/**
+		* @brief  Values of a derived or scaled column for selected records of
+		*         last batch, which are evaluated a column at a time.
+		*/
+		const double *columnValues(size_t column) const
+		{
+			return values[column].data();
+		}
+
+	private:
+		QueryOperator &child;
+		size_t item_length;
+		std::vector<QueryColumn> columns_;
+		const std::vector<DerivedField> &derived;
+		std::vector<std::vector<double>> values;
+		std::vector<double> stack;
+	};
+
+	/**
+	* Destination of formatted query result.
+	*/
+	class QuerySink {
+	public:
+		virtual ~QuerySink() {}
+
+		/**
+		* @returns
+		*         false if fail, e.g. the reader has gone, which stops the query.
+		*/
+		virtual bool write(const char *data, size_t size) = 0;
+	};
+
+	class FileQuerySink: public QuerySink {
+	public:
+		FileQuerySink(std::FILE *fp): fp(fp) {}
+
+		bool write(const char *data, size_t size) override
+		{
+			return std::fwrite(data, 1, size, fp) == size;
+		}
+
+	private:
+		std::FILE *fp;
+	};
+
+	/**
+	* Binary file with its compiled schema and sidecars, which can be shared by
+	* concurrent queries once opened.
+	*/
+	struct QueryTable {
+		QueryTable(): item_length(0) {}
+
+		/**
+		* @brief  Compile schema, map binary file and its zone map and Bloom filter
+		*         sidecars if they exist.
+		* @returns
+		*         -1 if fail, or 0 if success.
+		*/
+		int open(const std::string &source_file, const std::string &template_file);
+
+		std::unique_ptr<JsonConfigurator> configurator;
+		SequencedParser parsers;
+		// Derived fields declared in schema.
+		std::string derivation;
+		MappedFile source_file;
+		ZoneMap zone_map;
+		BlockBloomFilter bloom_filter;
+		size_t item_length;
+	};
+
+	/**
+	* This class runs a query over a binary file and writes result to target
+	* file or standard output.
+	*/
+	class StorageQuery {
+	public:
+		enum class Format {
+			CSV,
+			JSON
+		};
+
+		StorageQuery(): limit(0), format(Format::CSV) {}
+
+		/**
+		* @brief  Set binary source file path, which may be absolute or relative.
+		*/
+		void setBinarySource(const std::string &source_file);
+
+		/**
+		* @brief  Set target file path. Result is written to standard output if
+		*         not set.
+		*/
+		void setTargetFile(const std::string &target_file);
+
+		/**
+		* @brief  Set template file path, which may be absolute or relative.
+		*/
+		void setTemplate(const std::string &template_file);
+
+		/**
+		* @brief  Set fields to output. All basic type fields are output if not set.
+		*/
+		void setSelect(const std::vector<std::string> &fields);
+
+		/**
+		* @brief  Set filter expression, see parsePredicates().
+		*/
+		void setFilter(const std::string &expression);
+
+		/**
+		* @brief  Declare derived fields as "name=expression;...", which can be
+		*         selected like fields of record, see parseDerivedFields().
+		*         Fields declared in schema are available as well.
+		*/
+		void setDerivedFields(const std::string &declarations);
+
+		/**
+		* @brief  Set maximum count of output records, 0 means no limit.
+		*/
+		void setLimit(size_t limit);
+
+		void setFormat(Format format);
+
+		/**
+		* @brief  Run query over binary source file, or over a directory of files
+		*         as one table, see StorageCatalog.
+		* @returns
+		*         -1 if fail, or count of output records if success.
+		*/
+		long long run();
+
+		/**
+		* @brief  Run query over an opened table, ignoring source, target and
+		*         template files. The table is only read, so it may be shared.
+		* @returns
+		*         -1 if fail, or count of output records if success.
+		*/
+		long long run(QueryTable &table, QuerySink &sink);
+
+	private:
+		/**
+		* @brief  Run query over files of a catalog, which are scanned in
+		*         parallel and output in order of time.
+		*/
+		long long runDataset(QuerySink &sink);
+
+		/**
+		* @brief  Compile derived fields, locate output columns and parse filter.
+		* @returns
+		*         -1 if fail, or 0 if success.
+		*/
+		int compile(SequencedParser &parsers, const std::string &schema_derivation, std::vector<QueryColumn> &columns,
+			std::vector<DerivedField> &derived, std::vector<Predicate> &predicates);
+
+		/**
+		* @brief  Run pipeline over a table and format records into output, which
+		*         is written to sink whenever it grows large if sink is given.
+		* @returns
+		*         -1 if writing fails, or count of output records.
+		*/
+		long long scan(QueryTable &table, const std::vector<QueryColumn> &columns, const std::vector<DerivedField> &derived,
+			const std::vector<Predicate> &predicates, size_t limit, std::string &output, QuerySink *sink, bool &first);
+
+		/**
+		* @brief  Keep the first records of formatted output.
+		*/
+		void keepRecords(std::string &output, size_t count);
+
+		void formatHeader(std::string &output, const std::vector<QueryColumn> &columns);
+		void formatBatch(std::string &output, const RecordBatch &batch, size_t item_length,
+			const ProjectOperator &project, const std::vector<DerivedField> &derived, bool &first);
+		void formatFooter(std::string &output);
+
+		std::string source;
+		std::string target;
+		std::string template_;
+		std::vector<std::string> select_names;
+		std::string filter;
+		std::string derivation;
+		size_t limit;
+		Format format;
+	};
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "BinaryParserConfigurator.h"
+#include "MappedFile.h"
+
+namespace StorageNS {
+	/**
+	* This class sorts fixed-size records of a binary file by a key field into
+	* another binary file. Records are moved as raw bytes and never formatted.
+	* Runs fitting in memory limit are radix sorted on the key and spilled into
+	* run files, which are merged with a loser tree afterwards.
+	*/
+	class StorageSorter {
+	public:
+		StorageSorter(): memory_limit(256 * 1024 * 1024), item_length(0) {}
+
+		/**
+		* @brief  Set binary source file path, which may be absolute or relative.
+		*/
+		void setBinarySource(const std::string &source_file);
+
+		/**
+		* @brief  Set sorted binary target file path, which may be absolute or relative.
+		*/
+		void setTargetFile(const std::string &target_file);
+
+		/**
+		* @brief  Set template file path, which may be absolute or relative.
+		*/
+		void setTemplate(const std::string &template_file);
+
+		/**
+		* @brief  Set the field which records are sorted by.
+		*/
+		void setKeyField(const std::string &field);
+
+		/**
+		* @brief  Set memory limit in bytes used by sorting, 256 MB by default.
+		*/
+		void setMemoryLimit(size_t bytes);
+
+		/**
+		* @brief  Set path prefix of spilled run files, target file path by default.
+		*/
+		void setRunPrefix(const std::string &prefix);
+
+		/**
+		* @brief  Sort source file into target file. Records with equal keys keep
+		*         their order in source file. Source file is read while target
+		*         file is written, so sorting in place is rejected.
+		* @returns
+		*          -1 if fail, or target is source file, or 0 if success.
+		*/
+		int sort();
+
+	private:
+		/**
+		* @brief  Radix sort records [begin, end) of source file and write them
+		*         in sorted order to given file.
+		*/
+		int sortRun(size_t begin, size_t end, const std::string &file);
+
+		/**
+		* @brief  Merge sorted run files into target file.
+		*/
+		int mergeRuns(const std::vector<std::string> &runs);
+
+		std::string source;
+		std::string target;
+		std::string template_;
+		std::string key_name;
+		std::string run_prefix;
+		size_t memory_limit;
+
+		std::unique_ptr<JsonConfigurator> configurator;
+		SequencedParser parsers;
+		MappedFile source_file;
+		FieldInfo key_field;
+		size_t item_length;
+	};
+}
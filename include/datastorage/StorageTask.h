@@ -2,6 +2,8 @@
 #include "Timer.h"
 #include "DataReceiver.h"
 #include "BinaryParserConfigurator.h"
+#include "StorageIndex.h"
+#include "StorageBTree.h"
 
 #include <fstream>
 
@@ -10,20 +12,69 @@ namespace StorageNS {
 	{
 	public:
 		StorageTask(DataReceiver &receiver)
-			:receiver(receiver), valid_data_length(0)
+			:receiver(receiver), has_messages(false), max_message_length(0), pending_message(-1),
+			stream_failed(false), valid_data_length(0), index_interval(0), stored_item(0)
 		{}
 
 		~StorageTask() {}
 
+		/**
+		* @brief  Maintain index sidecar of binary file keyed by given field while
+		*         storing, see StorageIndex. Should be called before config().
+		* @param  const std::string &[in] - key field, e.g. timestamp
+		*         size_t[in] - count of records per index entry
+		*/
+		void setIndex(const std::string &field, size_t interval);
+
+		/**
+		* @brief  Maintain B+tree sidecar of binary file keyed by given field while
+		*         storing, see StorageBTree. Should be called before config().
+		*/
+		void setBTree(const std::string &field);
+
+		/**
+		* @brief  Configure stored records. If configuration declares several
+		*         message types, see JsonConfigurator::generateMessages(), each
+		*         received record is dispatched by its tag and stored interleaved
+		*         as is. A datagram of an unknown tag or of wrong length is
+		*         dropped, while an unknown tag on a byte stream stops storing,
+		*         as the stream cannot be resynchronized. Message types should
+		*         have fixed length, and index or B+tree is not supported.
+		*/
 		int config(const char *config_file_path, const char *binary_file_path);
 
 		void run() override;
 
 	private:
+		/**
+		* @brief  Receive and store a record of one of message types.
+		*/
+		void runMessage();
+
+		/**
+		* @brief  Receive and store a record of one of message types from a
+		*         byte stream, whose tag is received first.
+		*/
+		void runStreamMessage();
+
 		DataReceiver &receiver;
 		std::unique_ptr<JsonConfigurator> configurator;
 		SequencedParser parsers;
+		MessageDispatcher dispatcher;
+		bool has_messages;
+		int max_message_length;
+		// Message type whose tag is received while its rest is not yet.
+		int pending_message;
+		buffer_t pending_tag;
+		bool stream_failed;
 		int valid_data_length;
 		std::ofstream binary_stream;
+		std::string index_name;
+		size_t index_interval;
+		IndexWriter index_writer;
+		FieldInfo btree_field;
+		std::string btree_name;
+		BTreeWriter btree_writer;
+		uint64_t stored_item;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,114 @@
+//=============================================================================
+/**
+* @file    StorageZoneMap.h
+* @version v0.1
+* @brief   Zone map sidecar of binary file. The sidecar keeps minimum and maximum
+*          keys of selected fields for every block of records, so that scans with
+*          predicates can skip blocks which cannot match. The sidecar is a flat
+*          array read through a file mapping.
+*/
+//=============================================================================
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "BinaryParser.h"
+#include "MappedFile.h"
+#include "StoragePredicate.h"
+
+namespace StorageNS {
+	/**
+	* Header of zone map sidecar, followed by ZoneMapField array and then Zone
+	* array of block_count * field_count, ordered by block.
+	*/
+	struct ZoneMapHeader {
+		char magic[4];
+		uint32_t version;
+		uint64_t block_records;
+		uint64_t item_length;
+		uint64_t block_count;
+		uint32_t field_count;
+		uint32_t reserved;
+		// Size and modification time of binary file when zone map was built.
+		uint64_t source_size;
+		int64_t source_modified;
+	};
+
+	struct ZoneMapField {
+		uint32_t offset;
+		// Layout code of field, see FieldInfo::layoutCode().
+		uint32_t type;
+	};
+
+	/**
+	* Minimum and maximum keys of a field in a block, see FieldInfo::sortKey().
+	*/
+	struct Zone {
+		uint64_t min;
+		uint64_t max;
+	};
+
+	class ZoneMap {
+	public:
+		ZoneMap(): header(nullptr), fields(nullptr), zones(nullptr) {}
+
+		/**
+		* @brief  Default zone map sidecar path of a binary file.
+		*/
+		static std::string sidecarPath(const std::string &source_file)
+		{
+			return source_file + ".zmap";
+		}
+
+		/**
+		* @brief  Build zone map sidecar of given fields for an existing binary file.
+		*         Blocks are processed in parallel.
+		* @returns
+		*         -1 if fail, or 0 if success.
+		*/
+		static int build(const std::string &source_file, const std::vector<FieldInfo> &fields,
+			size_t item_length, size_t block_records, const std::string &zone_map_file);
+
+		/**
+		* @brief  Map zone map sidecar built with same record length from binary file
+		*         as it is now. A sidecar of a file changed since, e.g. appended by
+		*         store, is not matched.
+		* @returns
+		*         -1 if fail or not matched, or 0 if success.
+		*/
+		int open(const std::string &zone_map_file, const std::string &source_file, size_t item_length);
+
+		bool isOpen() const
+		{
+			return header != nullptr;
+		}
+
+		size_t blockRecords() const
+		{
+			return static_cast<size_t>(header->block_records);
+		}
+
+		size_t blockCount() const
+		{
+			return static_cast<size_t>(header->block_count);
+		}
+
+		/**
+		* @brief  Check if all records of a block may match all predicates. Predicates
+		*         on fields not kept in zone map always may match.
+		*/
+		bool mayMatch(size_t block, const std::vector<Predicate> &predicates) const;
+
+	private:
+		/**
+		* @brief  Index of field in zone map, or -1 if it is not kept.
+		*/
+		int fieldIndex(const FieldInfo &field) const;
+
+		MappedFile zone_map_file;
+		const ZoneMapHeader *header;
+		const ZoneMapField *fields;
+		const Zone *zones;
+	};
+}
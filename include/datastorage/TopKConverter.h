@@ -0,0 +1,80 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "StorageConverter.h"
+#include "MappedFile.h"
+#include <cstdio>
+
+namespace StorageNS {
+	/**
+	* This converter finds records with the K largest (or smallest) values of a
+	* field, optionally K records per distinct value of a key field, and stores
+	* whole records or selected fields of them to target CSV file. Blocks of the
+	* mapped binary file are scanned in parallel, every worker keeps bounded heaps
+	* which are merged at the end.
+	*/
+	class TopKStorageConverter: public StorageConverter {
+	public:
+		TopKStorageConverter(): csv_file(nullptr), count(10), ascending(false) {}
+		~TopKStorageConverter();
+
+		/**
+		* @brief  Set the field which records are ranked by.
+		*/
+		void setField(const std::string &field);
+
+		/**
+		* @brief  Set K, the count of kept records (per key if key field is set).
+		*/
+		void setCount(size_t count);
+
+		/**
+		* @brief  Set the key field. Records are ranked within every distinct
+		*         value of this field if set.
+		*/
+		void setKeyField(const std::string &field);
+
+		/**
+		* @brief  Set fields to store. Whole records are stored if not set.
+		*/
+		void setSelect(const std::vector<std::string> &fields);
+
+		/**
+		* @brief  Keep the smallest values instead of the largest ones.
+		*/
+		void setAscending(bool ascending);
+
+		/**
+		* @brief  Processing files and ranking all records. After preparing,
+		*         totalItem() is the count of kept records.
+		*/
+		int prepare() override;
+
+		/**
+		* @brief  Store next kept record to target CSV file, in order of key and
+		*         then rank.
+		*/
+		int convertAndStore() override;
+
+		int storeHeaders() override;
+
+	private:
+		std::FILE *csv_file;
+		std::unique_ptr<JsonConfigurator> configurator;
+		SequencedParser parsers;
+		MappedFile source_file;
+
+		std::string field_name;
+		std::string key_name;
+		std::vector<std::string> select_names;
+		FieldInfo field;
+		FieldInfo key_field;
+		std::vector<FieldInfo> select_fields;
+		size_t count;
+		bool ascending;
+		std::vector<size_t> results;
+	};
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "StorageConverter.h"
+#include "MappedFile.h"
+#include <cstdio>
+
+namespace StorageNS {
+	/**
+	* This converter converts a binary file of variable-length records, i.e.
+	* records with strings, counted arrays or a record length prefix. Offsets of
+	* records are indexed in one pass, then ranges of records are converted in
+	* parallel into part files, which are appended to target CSV file in order.
+	* Range and filter fields should be located before the first variable-length
+	* member of records, see SequencedParser::fields().
+	*/
+	class VariableStorageConverter: public StorageConverter {
+	public:
+		VariableStorageConverter(): csv_file(nullptr) {}
+		~VariableStorageConverter();
+
+		/**
+		* @brief  Index records of binary file and convert them into part files.
+		*         After preparing, totalItem() is the count of part files.
+		*/
+		int prepare() override;
+
+		/**
+		* @brief  Append next converted part file to target CSV file.
+		*/
+		int convertAndStore() override;
+
+		int storeHeaders() override;
+
+		/**
+		* @brief  Count of records indexed by prepare().
+		*/
+		size_t recordCount() const
+		{
+			return offsets.empty() ? 0 : offsets.size() - 1;
+		}
+
+		/**
+		* @brief  Count of bytes at the end of binary file which are not
+		*         converted, following an incomplete or malformed record.
+		*/
+		size_t unconvertedSize() const
+		{
+			return source_file.size() - indexedSize();
+		}
+
+		/**
+		* @brief  Offset of the first byte which is not converted.
+		*/
+		size_t indexedSize() const
+		{
+			return offsets.empty() ? 0 : static_cast<size_t>(offsets.back());
+		}
+
+	private:
+		/**
+		* @brief  Index offsets of complete records, up to the first incomplete
+		*         or malformed record, see unconvertedSize().
+		*/
+		void indexRecords();
+
+		/**
+		* @brief  Convert records in [begin, end) into a part file.
+		* @returns -1 if part file cannot be created, or 0 if success.
+		*/
+		int convertPart(size_t begin, size_t end, const std::string &part);
+
+		std::FILE *csv_file;
+		std::unique_ptr<JsonConfigurator> configurator;
+		SequencedParser parsers;
+		MappedFile source_file;
+		// Record i is in [offsets[i], offsets[i + 1]).
+		std::vector<uint64_t> offsets;
+		std::vector<std::string> parts;
+		std::vector<DerivedField> derived;
+	};
+}
@@ -1,11 +1,35 @@
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
 #include <iostream>
+#include <map>
+#include <sstream>
 #include <string>
+#include <vector>
 
 #include "DataReceiver.h"
 #include "TCPReceiver.h"
 #include "UDPReceiver.h"
 #include "StorageTask.h"
 #include "StorageConverter.h"
+#include "ResampleConverter.h"
+#include "DecimateConverter.h"
+#include "TopKConverter.h"
+#include "JoinConverter.h"
+#include "DatasetConverter.h"
+#include "LookupConverter.h"
+#include "VariableConverter.h"
+#include "MessageConverter.h"
+#include "StorageSorter.h"
+#include "StorageIndex.h"
+#include "StorageZoneMap.h"
+#include "StorageBloomFilter.h"
+#include "StorageBTree.h"
+#include "StorageQuery.h"
+#include "QueryDaemon.h"
+#include "StorageCatalog.h"
+#include "Directory.h"
 
 using namespace StorageNS;
 
@@ -50,7 +74,7 @@ void testDataConvert()
 	specifier.set_specifier(FormatSpecifier::Type::FLOAT, "%.2f");
 	specifier.set_specifier(FormatSpecifier::Type::DOUBLE, "%.2f");
 
-	CsvStorageConverter converter = CsvStorageConverter();
+	CsvStorageConverter converter;
 
 	converter.setBinarySource("type.dat");
 	converter.setTargetFile("type.csv");
@@ -80,10 +104,811 @@ void testDataConvert()
 	std::cout << "Processing time: " << watcher.elapsed_s() / 60 << " min" << std::endl;
 }
 
-int main(int argc, char *argv[])
+/**
+* Command line options in form of "DataStorage <command> <file> --name value ...".
+* An option without value, e.g. "--smallest", is set to "true".
+*/
+struct CommandOptions {
+	std::string command;
+	std::vector<std::string> positionals;
+	std::map<std::string, std::string> values;
+
+	bool has(const std::string &name) const
+	{
+		return values.find(name) != values.end();
+	}
+
+	std::string get(const std::string &name, const std::string &default_value) const
+	{
+		auto value = values.find(name);
+		return value == values.end() ? default_value : value->second;
+	}
+
+	/**
+	* @brief  Get option as a whole non-negative number, e.g. "--k 10".
+	* @returns false with a message if the value is not such a number.
+	*/
+	bool getCount(const std::string &name, size_t default_value, size_t &count) const
+	{
+		std::string text = get(name, std::to_string(static_cast<unsigned long long>(default_value)));
+		char *end = nullptr;
+
+		errno = 0;
+		unsigned long long value = std::strtoull(text.data(), &end, 10);
+		if (text.empty() || text[0] < '0' || text[0] > '9' || *end != '\0' || errno == ERANGE
+			|| value > static_cast<unsigned long long>(static_cast<size_t>(-1)))
+		{
+			std::cerr << "Option --" << name << " should be a whole number." << std::endl;
+			return false;
+		}
+
+		count = static_cast<size_t>(value);
+		return true;
+	}
+
+	/**
+	* @brief  Get option as a finite number, e.g. "--interval 0.5".
+	* @returns false with a message if the value is not such a number.
+	*/
+	bool getNumber(const std::string &name, double default_value, double &number) const
+	{
+		number = default_value;
+		if (!has(name))
+			return true;
+
+		std::string text = get(name, "");
+		char *end = nullptr;
+		number = std::strtod(text.data(), &end);
+		if (text.empty() || *end != '\0' || !std::isfinite(number))
+		{
+			std::cerr << "Option --" << name << " should be a number." << std::endl;
+			return false;
+		}
+
+		return true;
+	}
+};
+
+CommandOptions parseOptions(int argc, char *argv[])
+{
+	CommandOptions options;
+
+	if (argc > 1)
+		options.command = argv[1];
+
+	for (int i = 2; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		if (arg.compare(0, 2, "--") == 0)
+		{
+			std::string name = arg.substr(2);
+			if (i + 1 < argc && std::string(argv[i + 1]).compare(0, 2, "--") != 0) {
+				options.values[name] = argv[++i];
+			}
+			else {
+				options.values[name] = "true";
+			}
+		}
+		else
+		{
+			options.positionals.push_back(arg);
+		}
+	}
+
+	return options;
+}
+
+std::vector<std::string> splitList(const std::string &list)
+{
+	std::vector<std::string> items;
+	std::istringstream stream(list);
+	std::string item;
+
+	while (std::getline(stream, item, ','))
+	{
+		if (!item.empty())
+			items.push_back(item);
+	}
+
+	return items;
+}
+
+int runConverter(StorageConverter &converter, const CommandOptions &options)
+{
+	if (options.positionals.empty())
+	{
+		std::cerr << "Binary source file is missing." << std::endl;
+		return -1;
+	}
+
+	converter.setBinarySource(options.positionals[0]);
+	converter.setTargetFile(options.get("output", options.command + ".csv"));
+	converter.setTemplate(options.get("schema", "type.json"));
+	if (options.has("from") || options.has("to"))
+	{
+		converter.setRange(options.get("range", "timestamp"),
+			options.get("from", ""), options.get("to", ""));
+	}
+	converter.setFilter(options.get("where", ""));
+	converter.setDerivedFields(options.get("derive", ""));
+
+	StopWatch watcher;
+	watcher.start();
+	if (converter.prepare() == -1)
+	{
+		std::cerr << "Failed to prepare " << options.command << "." << std::endl;
+		return -1;
+	}
+
+	std::cout << "Total item: " << converter.totalItem() << std::endl;
+
+	if (converter.storeHeaders() == -1)
+	{
+		std::cerr << "Failed to store headers." << std::endl;
+		return -1;
+	}
+	while(converter.hasNext()) {
+		if (converter.convertAndStore() == -1)
+		{
+			std::cerr << "Failed to convert item " << converter.currentItem() << "." << std::endl;
+			return -1;
+		}
+	}
+	watcher.stop();
+	std::cout << "Processing time: " << watcher.elapsed_s() << " s" << std::endl;
+
+	return 0;
+}
+
+/**
+* Check if records of a schema have variable length, i.e. have strings, counted
+* arrays or a record length prefix.
+*/
+bool isVariableLength(const std::string &template_file)
+{
+	JsonConfigurator configurator(getTextFileContent(template_file.data()));
+
+	return configurator.isValid() && !configurator.generateParser().isFixedLength();
+}
+
+/**
+* Check if a schema declares a stream of several message types.
+*/
+bool hasMessages(const std::string &template_file)
+{
+	JsonConfigurator configurator(getTextFileContent(template_file.data()));
+
+	return configurator.isValid() && configurator.hasMessages();
+}
+
+int convertCommand(const CommandOptions &options)
+{
+	if (!options.positionals.empty() && isDirectory(options.positionals[0]))
+	{
+		DatasetStorageConverter converter;
+
+		converter.setTimeField(options.get("time", "timestamp"));
+
+		int result = runConverter(converter, options);
+		const std::vector<std::string> &skipped = converter.skippedFiles();
+		for (auto name = skipped.begin(); name != skipped.end(); ++name)
+		{
+			std::cerr << "File " << *name << " has a different schema and is not converted." << std::endl;
+		}
+
+		return result;
+	}
+
+	if (hasMessages(options.get("schema", "type.json")))
+	{
+		MessageStorageConverter converter;
+
+		int result = runConverter(converter, options);
+		if (result == 0 && converter.unconvertedSize() > 0)
+		{
+			std::cerr << converter.unconvertedSize() << " bytes from offset " << converter.indexedSize()
+				<< " are not converted, following an unknown tag or an incomplete record." << std::endl;
+		}
+
+		return result;
+	}
+
+	if (isVariableLength(options.get("schema", "type.json")))
+	{
+		VariableStorageConverter converter;
+
+		int result = runConverter(converter, options);
+		if (result == 0 && converter.unconvertedSize() > 0)
+		{
+			std::cerr << converter.unconvertedSize() << " bytes from offset " << converter.indexedSize()
+				<< " are not converted, following an incomplete or malformed record." << std::endl;
+		}
+
+		return result;
+	}
+
+	CsvStorageConverter converter;
+
+	return runConverter(converter, options);
+}
+
+int resampleCommand(const CommandOptions &options)
+{
+	ResampleStorageConverter converter;
+
+	converter.setTimestampField(options.get("timestamp", "timestamp"));
+	double interval;
+	if (!options.getNumber("interval", 1000, interval))
+	{
+		return -1;
+	}
+	converter.setInterval(interval);
+	converter.setFields(splitList(options.get("fields", "")));
+
+	return runConverter(converter, options);
+}
+
+int decimateCommand(const CommandOptions &options)
+{
+	DecimateStorageConverter converter;
+
+	if (options.get("method", "lttb") == "minmax") {
+		converter.setMethod(DecimateStorageConverter::Method::MIN_MAX);
+	}
+	else {
+		converter.setMethod(DecimateStorageConverter::Method::LTTB);
+	}
+	size_t points;
+	if (!options.getCount("points", 4000, points))
+	{
+		return -1;
+	}
+	converter.setTargetCount(points);
+	converter.setFields(splitList(options.get("fields", "")));
+	converter.setXField(options.get("x", ""));
+
+	return runConverter(converter, options);
+}
+
+int topkCommand(const CommandOptions &options)
+{
+	TopKStorageConverter converter;
+
+	converter.setField(options.get("field", ""));
+	size_t k;
+	if (!options.getCount("k", 10, k))
+	{
+		return -1;
+	}
+	converter.setCount(k);
+	converter.setKeyField(options.get("key", ""));
+	converter.setSelect(splitList(options.get("select", "")));
+	converter.setAscending(options.has("smallest"));
+
+	return runConverter(converter, options);
+}
+
+int joinCommand(const CommandOptions &options)
+{
+	JoinStorageConverter converter;
+
+	if (options.positionals.size() < 2)
+	{
+		std::cerr << "Right binary source file is missing." << std::endl;
+		return -1;
+	}
+
+	std::string timestamp = options.get("timestamp", "timestamp");
+	converter.setRightSource(options.positionals[1]);
+	converter.setRightTemplate(options.get("right-schema", options.get("schema", "type.json")));
+	converter.setTimestampFields(timestamp, options.get("right-timestamp", timestamp));
+	converter.setRightPrefix(options.get("right-prefix", "right."));
+	converter.setJson(options.get("format", "csv") == "json");
+
+	return runConverter(converter, options);
+}
+
+int sortCommand(const CommandOptions &options)
 {
-	testDataConvert();
-	//testDataReceive();
+	StorageSorter sorter;
+
+	if (options.positionals.empty())
+	{
+		std::cerr << "Binary source file is missing." << std::endl;
+		return -1;
+	}
+
+	sorter.setBinarySource(options.positionals[0]);
+	sorter.setTargetFile(options.get("output", "sorted.dat"));
+	sorter.setTemplate(options.get("schema", "type.json"));
+	sorter.setKeyField(options.get("key", "timestamp"));
+	size_t memory;
+	if (!options.getCount("memory", 256, memory))
+	{
+		return -1;
+	}
+	sorter.setMemoryLimit(std::min(memory, static_cast<size_t>(-1) >> 20) << 20);
+	sorter.setRunPrefix(options.get("temp", ""));
+
+	if (isSameFile(options.positionals[0], options.get("output", "sorted.dat")))
+	{
+		std::cerr << "Output should not be the source file." << std::endl;
+		return -1;
+	}
+
+	StopWatch watcher;
+	watcher.start();
+	if (sorter.sort() == -1)
+	{
+		std::cerr << "Failed to sort." << std::endl;
+		return -1;
+	}
+	watcher.stop();
+	std::cout << "Processing time: " << watcher.elapsed_s() << " s" << std::endl;
 
 	return 0;
 }
+
+int indexCommand(const CommandOptions &options)
+{
+	if (options.positionals.empty())
+	{
+		std::cerr << "Binary source file is missing." << std::endl;
+		return -1;
+	}
+
+	std::string source = options.positionals[0];
+	std::string content = StorageNS::getTextFileContent(options.get("schema", "type.json").data());
+	JsonConfigurator configurator(content);
+	if (!configurator.isValid())
+	{
+		std::cerr << "Invalid schema." << std::endl;
+		return -1;
+	}
+
+	SequencedParser parsers = configurator.generateParser();
+	FieldInfo field;
+	if (!parsers.findField(options.get("field", "timestamp"), field))
+	{
+		std::cerr << "Index field is not found." << std::endl;
+		return -1;
+	}
+	if (!field.isNumeric())
+	{
+		std::cerr << "Index field is not numeric." << std::endl;
+		return -1;
+	}
+
+	size_t interval;
+	if (!options.getCount("interval", 4096, interval))
+	{
+		return -1;
+	}
+
+	return StorageIndex::build(source, field, parsers.length(),
+		interval, options.get("output", StorageIndex::sidecarPath(source)));
+}
+
+int zonemapCommand(const CommandOptions &options)
+{
+	if (options.positionals.empty())
+	{
+		std::cerr << "Binary source file is missing." << std::endl;
+		return -1;
+	}
+
+	std::string source = options.positionals[0];
+	std::string content = StorageNS::getTextFileContent(options.get("schema", "type.json").data());
+	JsonConfigurator configurator(content);
+	if (!configurator.isValid())
+	{
+		std::cerr << "Invalid schema." << std::endl;
+		return -1;
+	}
+
+	SequencedParser parsers = configurator.generateParser();
+	std::vector<FieldInfo> fields;
+	auto names = splitList(options.get("fields", ""));
+	if (names.empty())
+	{
+		auto members = parsers.fields();
+		for (auto member = members.begin(); member != members.end(); ++member)
+		{
+			if (member->isNumeric())
+				fields.push_back(*member);
+		}
+	}
+	for (auto name = names.begin(); name != names.end(); ++name)
+	{
+		FieldInfo field;
+		if (!parsers.findField(*name, field))
+		{
+			std::cerr << "Field " << *name << " is not found." << std::endl;
+			return -1;
+		}
+		if (!field.isNumeric())
+		{
+			std::cerr << "Field " << *name << " is not numeric." << std::endl;
+			return -1;
+		}
+		fields.push_back(field);
+	}
+
+	size_t block;
+	if (!options.getCount("block", 65536, block))
+	{
+		return -1;
+	}
+
+	return ZoneMap::build(source, fields, parsers.length(),
+		block, options.get("output", ZoneMap::sidecarPath(source)));
+}
+
+int bloomCommand(const CommandOptions &options)
+{
+	if (options.positionals.empty())
+	{
+		std::cerr << "Binary source file is missing." << std::endl;
+		return -1;
+	}
+
+	std::string source = options.positionals[0];
+	std::string content = StorageNS::getTextFileContent(options.get("schema", "type.json").data());
+	JsonConfigurator configurator(content);
+	if (!configurator.isValid())
+	{
+		std::cerr << "Invalid schema." << std::endl;
+		return -1;
+	}
+
+	// Every field is given as "name" or "name:bits_per_key" or
+	// "name:false_positive_rate", where a rate is less than 1.
+	SequencedParser parsers = configurator.generateParser();
+	std::vector<BloomFilterConfig> configs;
+	auto items = splitList(options.get("fields", ""));
+	if (items.empty())
+	{
+		std::cerr << "Fields to filter are missing, see --fields." << std::endl;
+		return -1;
+	}
+	for (auto item = items.begin(); item != items.end(); ++item)
+	{
+		size_t colon = item->find(':');
+		std::string name = item->substr(0, colon);
+		double bits_per_key = 10;
+
+		if (colon != std::string::npos)
+		{
+			std::string text = item->substr(colon + 1);
+			char *end = nullptr;
+			double value = std::strtod(text.data(), &end);
+			if (text.empty() || *end != '\0' || !(value > 0) || !std::isfinite(value))
+			{
+				std::cerr << "Field " << name << " should have a positive rate or bits per key." << std::endl;
+				return -1;
+			}
+			bits_per_key = value < 1 ? BloomFilterConfig::bitsPerKey(value) : value;
+		}
+
+		FieldInfo field;
+		if (!parsers.findField(name, field))
+		{
+			std::cerr << "Field " << name << " is not found." << std::endl;
+			return -1;
+		}
+		if (!field.isNumeric())
+		{
+			std::cerr << "Field " << name << " is not numeric." << std::endl;
+			return -1;
+		}
+		configs.push_back(BloomFilterConfig(field, bits_per_key));
+	}
+
+	size_t block;
+	if (!options.getCount("block", 65536, block))
+	{
+		return -1;
+	}
+
+	return BlockBloomFilter::build(source, configs, parsers.length(),
+		block, options.get("output", BlockBloomFilter::sidecarPath(source)));
+}
+
+int btreeCommand(const CommandOptions &options)
+{
+	if (options.positionals.empty())
+	{
+		std::cerr << "Binary source file is missing." << std::endl;
+		return -1;
+	}
+
+	std::string source = options.positionals[0];
+	std::string content = StorageNS::getTextFileContent(options.get("schema", "type.json").data());
+	JsonConfigurator configurator(content);
+	if (!configurator.isValid())
+	{
+		std::cerr << "Invalid schema." << std::endl;
+		return -1;
+	}
+
+	SequencedParser parsers = configurator.generateParser();
+	std::string name = options.get("field", "timestamp");
+	FieldInfo field;
+	if (!parsers.findField(name, field))
+	{
+		std::cerr << "Key field is not found." << std::endl;
+		return -1;
+	}
+	if (!field.isNumeric())
+	{
+		std::cerr << "Key field is not numeric." << std::endl;
+		return -1;
+	}
+
+	return BTreeWriter::bulkLoad(source, field, parsers.length(),
+		options.get("output", BTreeWriter::sidecarPath(source, name)));
+}
+
+int lookupCommand(const CommandOptions &options)
+{
+	LookupStorageConverter converter;
+
+	converter.setBTree(options.get("btree", ""));
+	size_t limit;
+	if (!options.getCount("limit", 0, limit))
+	{
+		return -1;
+	}
+	converter.setLimit(limit);
+
+	return runConverter(converter, options);
+}
+
+int queryCommand(const CommandOptions &options)
+{
+	if (options.positionals.empty())
+	{
+		std::cerr << "Binary source file is missing." << std::endl;
+		return -1;
+	}
+
+	// Query is sent to a running daemon if socket is given.
+	if (options.has("socket"))
+	{
+		std::map<std::string, std::string> request_options;
+		const char *names[] = { "schema", "select", "where", "derive", "limit", "format" };
+
+		// Daemon runs in its own working directory, so files are sent as absolute paths.
+		request_options["source"] = absolutePath(options.positionals[0]);
+		for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i)
+		{
+			if (options.has(names[i]))
+				request_options[names[i]] = options.get(names[i], "");
+		}
+		if (options.has("schema"))
+			request_options["schema"] = absolutePath(options.get("schema", ""));
+
+		std::string request = QueryClient::request(request_options);
+		QueryClient client;
+		FileQuerySink sink(stdout);
+		if (request.empty() || client.connect(options.get("socket", "")) == -1)
+		{
+			std::cerr << "Failed to connect query daemon." << std::endl;
+			return -1;
+		}
+		if (client.query(request, sink) == -1)
+		{
+			std::cerr << "Failed to run query. " << client.lastError() << std::endl;
+			return -1;
+		}
+		std::fflush(stdout);
+
+		return 0;
+	}
+
+	StorageQuery query;
+
+	query.setBinarySource(options.positionals[0]);
+	query.setTargetFile(options.get("output", ""));
+	query.setTemplate(options.get("schema", "type.json"));
+	query.setSelect(splitList(options.get("select", "")));
+	query.setFilter(options.get("where", ""));
+	query.setDerivedFields(options.get("derive", ""));
+	size_t limit;
+	if (!options.getCount("limit", 0, limit))
+	{
+		return -1;
+	}
+	query.setLimit(limit);
+	if (options.get("format", "csv") == "json") {
+		query.setFormat(StorageQuery::Format::JSON);
+	}
+	else {
+		query.setFormat(StorageQuery::Format::CSV);
+	}
+
+	if (query.run() == -1)
+	{
+		std::cerr << "Failed to run query." << std::endl;
+		return -1;
+	}
+
+	return 0;
+}
+
+int daemonCommand(const CommandOptions &options)
+{
+	QueryDaemon daemon;
+
+	daemon.setSocketPath(options.get("socket", "datastorage.sock"));
+	size_t threads;
+	if (!options.getCount("threads", 0, threads))
+	{
+		return -1;
+	}
+	daemon.setThreadCount(threads);
+	daemon.setTemplate(options.get("schema", "type.json"));
+
+	if (daemon.serve() == -1)
+	{
+		std::cerr << "Failed to listen on socket." << std::endl;
+		return -1;
+	}
+
+	return 0;
+}
+
+int catalogCommand(const CommandOptions &options)
+{
+	if (options.positionals.empty())
+	{
+		std::cerr << "Dataset directory is missing." << std::endl;
+		return -1;
+	}
+
+	StorageCatalog catalog;
+
+	catalog.setTimeField(options.get("time", "timestamp"));
+	catalog.setSuffix(options.get("suffix", ".dat"));
+	if (catalog.open(options.positionals[0], options.get("schema", "type.json")) == -1)
+	{
+		std::cerr << "Failed to update catalog." << std::endl;
+		return -1;
+	}
+
+	uint64_t record_count = 0;
+	const std::vector<CatalogEntry> &entries = catalog.entries();
+	for (auto entry = entries.begin(); entry != entries.end(); ++entry)
+	{
+		record_count += entry->record_count;
+	}
+	std::cout << "Files: " << entries.size() << ", records: " << record_count << std::endl;
+
+	return 0;
+}
+
+int layoutCommand(const CommandOptions &options)
+{
+	std::string content = StorageNS::getTextFileContent(options.get("schema", "type.json").data());
+	JsonConfigurator configurator(content);
+	if (!configurator.isValid())
+	{
+		std::cerr << "Invalid schema." << std::endl;
+		return -1;
+	}
+
+	if (configurator.hasMessages())
+	{
+		MessageDispatcher dispatcher;
+		if (configurator.generateMessages(dispatcher) == -1)
+		{
+			std::cerr << "Invalid messages." << std::endl;
+			return -1;
+		}
+
+		std::cout << "tag, 0, " << dispatcher.tagField().size() << std::endl;
+		for (size_t i = 0; i < dispatcher.messageCount(); ++i)
+		{
+			MessageDispatcher::Message &message = dispatcher.message(i);
+			std::cout << "message: " << message.name << " = " << message.code << std::endl;
+
+			auto fields = message.parsers.fields();
+			for (auto field = fields.begin(); field != fields.end(); ++field)
+			{
+				std::cout << field->name << ", " << field->offset << ", " << field->size() << std::endl;
+			}
+			if (message.parsers.isFixedLength())
+				std::cout << "sizeof: " << message.parsers.length() << std::endl;
+			else
+				std::cout << "sizeof: variable" << std::endl;
+		}
+
+		return 0;
+	}
+
+	SequencedParser parsers = configurator.generateParser();
+	auto fields = parsers.fields();
+	for (auto field = fields.begin(); field != fields.end(); ++field)
+	{
+		std::cout << field->name << ", " << field->offset << ", " << field->size() << std::endl;
+	}
+	if (parsers.isFixedLength())
+		std::cout << "sizeof: " << parsers.length() << std::endl;
+	else
+		std::cout << "sizeof: variable" << std::endl;
+
+	return 0;
+}
+
+void printUsage()
+{
+	std::cout << "Usage: DataStorage <command> <file.dat> [--schema type.json] [--output file.csv] [options]\n"
+		"  converters except decimate and join accept [--range <field>] [--from <value>] [--to <value>], using <file.dat>.idx if it exists\n"
+		"  converters except decimate and join accept --where \"<field> <op> <value> && ...\", using <file.dat>.zmap and .bloom if they exist\n"
+		"  converters and query accept --units, appending units of scaled fields to headers\n"
+		"  convert and lookup accept --derive \"<name>[:<type>]=<expression>;...\", appending derived fields\n"
+		"  convert, where <file.dat> may be a dataset directory, see catalog, or have variable-length records\n"
+		"  convert of a schema declaring \"Messages\" writes <output>.<message>.csv per message type\n"
+		"  resample --timestamp <field> --interval <width> [--fields a,b]\n"
+		"  decimate [--method lttb|minmax] [--points N] [--fields a,b] [--x <field>]\n"
+		"  topk --field <field> [--k N] [--key <field>] [--select a,b] [--smallest]\n"
+		"  join <right.dat> --right-schema <json> [--timestamp <field>] [--right-timestamp <field>] [--format csv|json]\n"
+		"  sort --key <field> [--memory MB] [--temp <prefix>]\n"
+		"  index [--field <field>] [--interval N]\n"
+		"  zonemap [--fields a,b] [--block N]\n"
+		"  bloom --fields <field>[:bits_per_key|:fp_rate],... [--block N]\n"
+		"  btree [--field <field>]\n"
+		"  lookup [--range <field>] --from <value> --to <value> [--limit N] [--btree <file.btree>]\n"
+		"  query [--select a,b] [--where <expression>] [--derive <declarations>] [--limit N] [--format csv|json] [--socket <path>], writing to standard output by default\n"
+		"  catalog <directory> [--time <field>] [--suffix .dat], updating <directory>/manifest.dsc\n"
+		"  layout, printing offset and size of fields and sizeof records\n"
+		"  daemon [--socket datastorage.sock] [--threads N] [--schema type.json]" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 2)
+	{
+		testDataConvert();
+		//testDataReceive();
+		return 0;
+	}
+
+	CommandOptions options = parseOptions(argc, argv);
+	FormatSpecifier::instance().set_header_units(options.has("units"));
+
+	if (options.command == "convert")
+		return convertCommand(options);
+	if (options.command == "resample")
+		return resampleCommand(options);
+	if (options.command == "decimate")
+		return decimateCommand(options);
+	if (options.command == "topk")
+		return topkCommand(options);
+	if (options.command == "join")
+		return joinCommand(options);
+	if (options.command == "sort")
+		return sortCommand(options);
+	if (options.command == "index")
+		return indexCommand(options);
+	if (options.command == "zonemap")
+		return zonemapCommand(options);
+	if (options.command == "bloom")
+		return bloomCommand(options);
+	if (options.command == "btree")
+		return btreeCommand(options);
+	if (options.command == "lookup")
+		return lookupCommand(options);
+	if (options.command == "query")
+		return queryCommand(options);
+	if (options.command == "daemon")
+		return daemonCommand(options);
+	if (options.command == "catalog")
+		return catalogCommand(options);
+	if (options.command == "layout")
+		return layoutCommand(options);
+
+	printUsage();
+
+	return -1;
+}
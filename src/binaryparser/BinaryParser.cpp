@@ -1,7 +1,383 @@
 #include "BinaryParser.h"
 
+#include <algorithm>
+#include <ctime>
+
+#if defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__))
+#include <immintrin.h>
+#define STORAGE_F16C
+#endif
+
 using namespace StorageNS;
 
+namespace {
+	const char kCOUNTED_ARRAY_SEPARATOR = ';';
+
+	// Dense table is used if it has at most this many slots per label.
+	const uint64_t kDENSE_SLOTS_PER_LABEL = 4;
+	const uint64_t kDENSE_MIN_SLOTS = 256;
+
+	// Hash table of labels grows up to 2^this times before giving up hashing.
+	const unsigned kHASH_MAX_GROWTH = 8;
+
+	// Half precision elements are converted in chunks of this many values.
+	const size_t kHALF_CHUNK_VALUES = 256;
+
+	const int64_t kSECONDS_PER_DAY = 86400;
+
+	// Count of rendered seconds kept per thread, one per field key modulo it.
+	const size_t kTIMESTAMP_CACHES = 16;
+
+	/**
+	* @brief   Rendered text of the last formatted second, see formatTimestamp().
+	**/
+	struct TimestampCache {
+		TimestampCache(): second(std::numeric_limits<int64_t>::min()), local(false), length(0), zone_length(0) {}
+
+		int64_t second;
+		bool local;
+		// "YYYY-MM-DDTHH:MM:SS" of second.
+		char text[32];
+		size_t length;
+		// "Z" or offset of local time zone, e.g. "+02:00".
+		char zone[8];
+		size_t zone_length;
+	};
+
+	/**
+	* @brief   Count days since 1970-01-01 of a date in proleptic Gregorian
+	*          calendar.
+	**/
+	int64_t daysFromCivil(int64_t year, unsigned month, unsigned day)
+	{
+		year -= month <= 2;
+		int64_t era = (year >= 0 ? year : year - 399) / 400;
+		unsigned year_of_era = static_cast<unsigned>(year - era * 400);
+		unsigned day_of_year = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+		unsigned day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+
+		return era * 146097 + static_cast<int64_t>(day_of_era) - 719468;
+	}
+
+	/**
+	* @brief   Count days of a month in proleptic Gregorian calendar.
+	**/
+	unsigned daysInMonth(int64_t year, unsigned month)
+	{
+		const unsigned kDAYS[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+		bool leap = year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+
+		return month == 2 && leap ? 29 : kDAYS[month - 1];
+	}
+
+	/**
+	* @brief   Get date of days since 1970-01-01, see daysFromCivil().
+	**/
+	void civilFromDays(int64_t days, int64_t &year, unsigned &month, unsigned &day)
+	{
+		days += 719468;
+		int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+		unsigned day_of_era = static_cast<unsigned>(days - era * 146097);
+		unsigned year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+		unsigned day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+		unsigned shifted_month = (5 * day_of_year + 2) / 153;
+
+		day = day_of_year - (153 * shifted_month + 2) / 5 + 1;
+		month = shifted_month < 10 ? shifted_month + 3 : shifted_month - 9;
+		year = static_cast<int64_t>(year_of_era) + era * 400 + (month <= 2);
+	}
+
+	/**
+	* @brief   Convert seconds since epoch to local time.
+	* @returns
+	*          false if it is out of range of the host.
+	**/
+	bool localTime(int64_t second, std::tm &time)
+	{
+		std::time_t value = static_cast<std::time_t>(second);
+
+#ifdef _WIN32
+		return localtime_s(&time, &value) == 0;
+#else
+		return localtime_r(&value, &time) != nullptr;
+#endif
+	}
+
+	/**
+	* @brief   Render "YYYY-MM-DDTHH:MM:SS" and zone of a second into cache.
+	**/
+	void renderSecond(int64_t second, bool local, TimestampCache &cache)
+	{
+		int64_t days = second / kSECONDS_PER_DAY;
+		int64_t rest = second % kSECONDS_PER_DAY;
+		int64_t offset = 0;
+		std::tm time;
+
+		if (local && localTime(second, time))
+		{
+			int64_t local_second = daysFromCivil(time.tm_year + 1900LL, time.tm_mon + 1, time.tm_mday) * kSECONDS_PER_DAY
+				+ time.tm_hour * 3600 + time.tm_min * 60 + time.tm_sec;
+			offset = local_second - second;
+			days = local_second / kSECONDS_PER_DAY;
+			rest = local_second % kSECONDS_PER_DAY;
+		}
+		if (rest < 0)
+		{
+			rest += kSECONDS_PER_DAY;
+			--days;
+		}
+
+		int64_t year;
+		unsigned month;
+		unsigned day;
+		civilFromDays(days, year, month, day);
+
+		int length = std::snprintf(cache.text, sizeof(cache.text), "%04lld-%02u-%02uT%02u:%02u:%02u",
+			static_cast<long long>(year), month, day, static_cast<unsigned>(rest / 3600),
+			static_cast<unsigned>(rest / 60 % 60), static_cast<unsigned>(rest % 60));
+		cache.length = std::min(static_cast<size_t>(std::max(length, 0)), sizeof(cache.text) - 1);
+
+		if (!local)
+		{
+			cache.zone_length = std::snprintf(cache.zone, sizeof(cache.zone), "Z");
+		}
+		else
+		{
+			int64_t minutes = (offset < 0 ? -offset : offset) / 60;
+			cache.zone_length = std::snprintf(cache.zone, sizeof(cache.zone), "%c%02u:%02u", offset < 0 ? '-' : '+',
+				static_cast<unsigned>(minutes / 60 % 100), static_cast<unsigned>(minutes % 60));
+		}
+		cache.second = second;
+		cache.local = local;
+	}
+
+	/**
+	* @brief   Parse an unsigned number of count digits at text[position].
+	**/
+	bool parseDigits(const std::string &text, size_t &position, size_t count, int64_t &value)
+	{
+		value = 0;
+		for (size_t i = 0; i < count; ++i, ++position)
+		{
+			if (position >= text.size() || text[position] < '0' || text[position] > '9')
+				return false;
+			value = value * 10 + (text[position] - '0');
+		}
+
+		return true;
+	}
+
+	/**
+	* @brief   Check if text[position] is c, and skip it if so.
+	**/
+	bool skip(const std::string &text, size_t &position, char c)
+	{
+		if (position >= text.size() || text[position] != c)
+			return false;
+
+		++position;
+		return true;
+	}
+}
+
+int StorageNS::formatTimestamp(char *output, int64_t value, uint32_t ticks, bool local, size_t key)
+{
+	// Fields of a record, e.g. start and end, keep their own seconds.
+	static thread_local TimestampCache caches[kTIMESTAMP_CACHES];
+
+	int64_t second = value / static_cast<int64_t>(ticks);
+	int64_t fraction = value % static_cast<int64_t>(ticks);
+	if (fraction < 0)
+	{
+		fraction += ticks;
+		--second;
+	}
+
+	TimestampCache &cache = caches[key % kTIMESTAMP_CACHES];
+	if (cache.second != second || cache.local != local || cache.length == 0)
+		renderSecond(second, local, cache);
+
+	char *end = output;
+	std::memcpy(end, cache.text, cache.length);
+	end += cache.length;
+
+	if (ticks > 1)
+	{
+		*end++ = '.';
+		char *digits = end;
+		for (uint32_t scale = ticks; scale > 1; scale /= 10)
+			++end;
+		for (char *digit = end; digit != digits; fraction /= 10)
+			*--digit = static_cast<char>('0' + fraction % 10);
+	}
+
+	std::memcpy(end, cache.zone, cache.zone_length);
+	end += cache.zone_length;
+	*end = '\0';
+
+	return static_cast<int>(end - output);
+}
+
+bool StorageNS::parseTimestamp(const std::string &text, uint32_t ticks, bool local, int64_t &value)
+{
+	size_t position = 0;
+	int64_t year, month, day;
+	int64_t hour = 0, minute = 0, second = 0;
+	int64_t fraction = 0;
+
+	// Date is "YYYY-MM-DD", optionally followed by "THH:MM[:SS[.fraction]]".
+	if (!parseDigits(text, position, 4, year) || !skip(text, position, '-')
+		|| !parseDigits(text, position, 2, month) || !skip(text, position, '-')
+		|| !parseDigits(text, position, 2, day) || month < 1 || month > 12
+		|| day < 1 || day > daysInMonth(year, static_cast<unsigned>(month)))
+		return false;
+
+	if (skip(text, position, 'T') || skip(text, position, ' '))
+	{
+		if (!parseDigits(text, position, 2, hour) || !skip(text, position, ':')
+			|| !parseDigits(text, position, 2, minute))
+			return false;
+		if (skip(text, position, ':') && !parseDigits(text, position, 2, second))
+			return false;
+		// Second 60 is a leap second.
+		if (hour > 23 || minute > 59 || second > 60)
+			return false;
+		if (skip(text, position, '.') || skip(text, position, ','))
+		{
+			// Digits beyond precision of ticks are truncated.
+			uint32_t scale = ticks;
+			size_t begin = position;
+			for (; position < text.size() && text[position] >= '0' && text[position] <= '9'; ++position)
+			{
+				if (scale > 1)
+				{
+					scale /= 10;
+					fraction += (text[position] - '0') * static_cast<int64_t>(scale);
+				}
+			}
+			if (position == begin)
+				return false;
+		}
+	}
+
+	int64_t seconds = daysFromCivil(year, static_cast<unsigned>(month), static_cast<unsigned>(day)) * kSECONDS_PER_DAY
+		+ hour * 3600 + minute * 60 + second;
+
+	// Zone is "Z" or offset, e.g. "+02:00" or "-0530", or else local if so.
+	bool utc = skip(text, position, 'Z');
+	if (!utc && position < text.size() && (text[position] == '+' || text[position] == '-'))
+	{
+		int64_t sign = text[position++] == '-' ? -1 : 1;
+		int64_t offset_hour, offset_minute;
+		if (!parseDigits(text, position, 2, offset_hour))
+			return false;
+		skip(text, position, ':');
+		if (!parseDigits(text, position, 2, offset_minute) || offset_hour > 23 || offset_minute > 59)
+			return false;
+		seconds -= sign * (offset_hour * 3600 + offset_minute * 60);
+	}
+	else if (!utc && local)
+	{
+		std::tm time = std::tm();
+		time.tm_year = static_cast<int>(year - 1900);
+		time.tm_mon = static_cast<int>(month - 1);
+		time.tm_mday = static_cast<int>(day);
+		time.tm_hour = static_cast<int>(hour);
+		time.tm_min = static_cast<int>(minute);
+		time.tm_sec = static_cast<int>(second);
+		time.tm_isdst = -1;
+		std::time_t local_seconds = std::mktime(&time);
+		if (local_seconds == static_cast<std::time_t>(-1))
+			return false;
+		seconds = static_cast<int64_t>(local_seconds);
+	}
+
+	if (position != text.size())
+		return false;
+
+	value = seconds * static_cast<int64_t>(ticks) + fraction;
+	return true;
+}
+
+void StorageNS::half_to_float(const uint16_t *input, size_t count, float *output)
+{
+	size_t i = 0;
+
+#ifdef STORAGE_F16C
+	for (; i + 8 <= count; i += 8)
+	{
+		__m128i half = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input + i));
+		_mm256_storeu_ps(output + i, _mm256_cvtph_ps(half));
+	}
+#endif
+
+	for (; i < count; ++i)
+		output[i] = half_to_float(input[i]);
+}
+
+void StorageNS::bfloat16_to_float(const uint16_t *input, size_t count, float *output)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		uint32_t bits = static_cast<uint32_t>(input[i]) << 16;
+		std::memcpy(output + i, &bits, sizeof(bits));
+	}
+}
+
+void StorageNS::appendJsonString(std::string &output, const char *text, size_t size)
+{
+	size_t copied = 0;
+
+	// Runs of characters which need no escape are copied at once.
+	output += '"';
+	for (size_t i = 0; i < size; ++i)
+	{
+		char c = text[i];
+		if (c != '"' && c != '\\' && static_cast<unsigned char>(c) >= 0x20)
+			continue;
+
+		output.append(text + copied, i - copied);
+		copied = i + 1;
+		if (c == '"' || c == '\\')
+		{
+			output += '\\';
+			output += c;
+		}
+		else
+		{
+			char escaped[8];
+			std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+			output += escaped;
+		}
+	}
+	output.append(text + copied, size - copied);
+	output += '"';
+}
+
+bool StorageNS::basicType(const std::string &type_name, FormatSpecifier::Type &type)
+{
+	const char *names[] = { "int8_t", "int16_t", "int32_t", "int64_t", "uint8_t",
+		"uint16_t", "uint32_t", "uint64_t", "float", "double", "float16", "bfloat16" };
+	const FormatSpecifier::Type types[] = {
+		FormatSpecifier::Type::INT8_T, FormatSpecifier::Type::INT16_T,
+		FormatSpecifier::Type::INT32_T, FormatSpecifier::Type::INT64_T,
+		FormatSpecifier::Type::UINT8_T, FormatSpecifier::Type::UINT16_T,
+		FormatSpecifier::Type::UINT32_T, FormatSpecifier::Type::UINT64_T,
+		FormatSpecifier::Type::FLOAT, FormatSpecifier::Type::DOUBLE,
+		FormatSpecifier::Type::FLOAT16, FormatSpecifier::Type::BFLOAT16
+	};
+
+	for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i)
+	{
+		if (type_name == names[i]) {
+			type = types[i];
+			return true;
+		}
+	}
+
+	return false;
+}
+
 ParserFactory::~ParserFactory()
 {
 	for (auto parser = parsers.begin(); parser != parsers.end(); ++parser)
@@ -9,6 +385,16 @@ ParserFactory::~ParserFactory()
 		if (parser->second != nullptr)
 			delete parser->second;
 	}
+	for (size_t i = 0; i < adopted.size(); ++i)
+	{
+		delete adopted[i];
+	}
+}
+
+BinaryParser *ParserFactory::adoptParser(BinaryParser *parser)
+{
+	adopted.push_back(parser);
+	return parser;
 }
 
 BinaryParser *ParserFactory::getParser(const std::string &type)
@@ -104,6 +490,18 @@ BinaryParser *ParserFactory::generateArrayParser(const std::string &element_type
 	{
 		parser = new ArrayParser<double>(size);
 	}
+	else if (element_type == "float16")
+	{
+		parser = new HalfFloatParser(FormatSpecifier::Type::FLOAT16, size, true);
+	}
+	else if (element_type == "bfloat16")
+	{
+		parser = new HalfFloatParser(FormatSpecifier::Type::BFLOAT16, size, true);
+	}
+	else if (element_type == "char")
+	{
+		parser = new CharArrayParser(size);
+	}
 
 	return parser;
 }
@@ -123,18 +521,33 @@ bool ParserFactory::isStructType(const std::string &type)
 	return type == "struct";
 }
 
+bool ParserFactory::isPaddingType(const std::string &type)
+{
+	return type.compare(0, 4, "pad[") == 0 && isArrayType(type);
+}
+
 int SequencedParser::fprintf(FILE* fp, const char* buffer)
 {
 	if (buffer == nullptr)
 		throw NullBufferException();
 
-	int offset = 0;
+	int offset = static_cast<int>(prefixLength());
 	FormatSpecifier &specifier = FormatSpecifier::instance();
 
 	for (int i = 0; i < parsers.size(); ++i)
 	{
-		parsers[i].second->fprintf(fp, buffer + offset);
-		offset += static_cast<int>(parsers[i].second->length());
+		if (isPresent(i, buffer))
+		{
+			offset += static_cast<int>(_padding[i]);
+			parsers[i].second->fprintf(fp, buffer + offset);
+			offset += static_cast<int>(memberLength(parsers[i].second, buffer + offset));
+		}
+		else
+		{
+			// Columns of an absent member are left empty.
+			for (size_t column = 1; column < _columns[i]; ++column)
+				std::fprintf(fp, "%s", specifier.get_delimiter());
+		}
 		if (i != parsers.size() - 1)
 		{
 			std::fprintf(fp, "%s", specifier.get_delimiter());
@@ -146,7 +559,102 @@ int SequencedParser::fprintf(FILE* fp, const char* buffer)
 
 size_t SequencedParser::length()
 {
-	return _length;
+	return isFixedLength() ? alignedLength() : 0;
+}
+
+bool SequencedParser::isFixedLength()
+{
+	return _fixed && !_has_record_length;
+}
+
+size_t SequencedParser::lengthAt(const char *buffer, size_t available)
+{
+	if (isFixedLength())
+		return alignedLength() <= available ? alignedLength() : 0;
+
+	size_t offset = prefixLength();
+	if (offset > available)
+		return 0;
+
+	if (_has_record_length)
+	{
+		int64_t body = _record_length.integer(buffer);
+		if (body < 0 || static_cast<uint64_t>(body) > available - offset)
+			return 0;
+		available = offset + static_cast<size_t>(body);
+		if (_fixed)
+			return alignedLength() <= static_cast<size_t>(body) ? available : 0;
+	}
+
+	// Members are checked to be inside the record.
+	for (size_t i = 0; i < parsers.size(); ++i)
+	{
+		BinaryParser *parser = parsers[i].second;
+
+		if (!isPresent(i, buffer))
+			continue;
+		offset += _padding[i];
+		if (offset > available)
+			return 0;
+		size_t length = parser->lengthAt(buffer + offset, available - offset);
+		if (length == 0 && (parser->length() != 0 || !parser->isFixedLength()))
+			return 0;
+		offset += length;
+	}
+	offset += _pending;
+
+	if (_has_record_length)
+		return available;
+
+	return offset <= available ? offset : 0;
+}
+
+size_t SequencedParser::emptyLength()
+{
+	// Zeroed count or length prefix of a variable member, or '\0' of a string.
+	const char kEMPTY[sizeof(uint64_t)] = {};
+	size_t length = prefixLength();
+
+	if (isFixedLength())
+		return this->length();
+
+	for (size_t i = 0; i < parsers.size(); ++i)
+	{
+		BinaryParser *parser = parsers[i].second;
+		SequencedParser *members = dynamic_cast<SequencedParser *>(parser);
+
+		length += _padding[i];
+		if (parser->isFixedLength())
+			length += parser->length();
+		else if (members != nullptr)
+			length += members->emptyLength();
+		else
+			length += parser->lengthAt(kEMPTY, sizeof(kEMPTY));
+	}
+
+	return length + _pending;
+}
+
+void SequencedParser::setRecordLength(const FieldInfo &prefix)
+{
+	_record_length = prefix;
+	_has_record_length = true;
+}
+
+void SequencedParser::setNaturalAlignment(bool natural)
+{
+	_natural = natural;
+}
+
+void SequencedParser::addPadding(size_t size)
+{
+	_pending += size;
+	_length += size;
+}
+
+size_t SequencedParser::alignment()
+{
+	return _natural ? _alignment : 1;
 }
 
 std::string SequencedParser::parse(const char *buffer)
@@ -156,15 +664,18 @@ std::string SequencedParser::parse(const char *buffer)
 
 	std::vector<MemberInfo> members;
 
-	size_t offset = 0;
+	size_t offset = prefixLength();
 	std::string expr;
 
-	for (auto iterator = parsers.begin(); iterator != parsers.end(); ++iterator)
+	for (size_t i = 0; i < parsers.size(); ++i)
 	{
-		auto parser = iterator->second;
+		auto parser = parsers[i].second;
+		if (!isPresent(i, buffer))
+			continue;
+		offset += _padding[i];
 		const char *buf = buffer + offset;
 		expr += parser->parse(buf);
-		offset += parser->length();
+		offset += memberLength(parser, buf);
 	}
 
 	return expr;
@@ -177,7 +688,7 @@ std::vector<MemberInfo> SequencedParser::expr(const std::string &name, const cha
 	if (buffer == nullptr)
 		return members;
 
-	size_t offset = 0;
+	size_t offset = prefixLength();
 	std::string expr_name;
 
 	for (auto parser = parsers.begin(); parser != parsers.end(); ++parser)
@@ -188,9 +699,18 @@ std::vector<MemberInfo> SequencedParser::expr(const std::string &name, const cha
 		else {
 			expr_name = name + "." + parser->first;
 		}
+		if (!isPresent(parser - parsers.begin(), buffer))
+		{
+			auto sub_members = parser->second->expr(expr_name, _zeros.data());
+			for (auto member = sub_members.begin(); member != sub_members.end(); ++member)
+				member->second.clear();
+			members.insert(members.end(), sub_members.begin(), sub_members.end());
+			continue;
+		}
+		offset += _padding[parser - parsers.begin()];
 		auto sub_members = parser->second->expr(expr_name, buffer + offset);
 		members.insert(members.end(), sub_members.begin(), sub_members.end());
-		offset += parser->second->length();
+		offset += memberLength(parser->second, buffer + offset);
 	}
 
 	return members;
@@ -201,35 +721,710 @@ std::vector<MemberInfo> SequencedParser::expr(const char* buffer)
 	return expr("", buffer);
 }
 
+std::vector<FieldInfo> SequencedParser::fields(const std::string &name, size_t offset)
+{
+	std::vector<FieldInfo> members;
+	std::string field_name;
+
+	offset += prefixLength();
+	for (auto parser = parsers.begin(); parser != parsers.end(); ++parser)
+	{
+		if (name.empty()) {
+			field_name = parser->first;
+		}
+		else {
+			field_name = name + "." + parser->first;
+		}
+		if (_presence[parser - parsers.begin()].op != Presence::Op::ALWAYS)
+			break;
+		offset += _padding[parser - parsers.begin()];
+		auto sub_members = parser->second->fields(field_name, offset);
+		members.insert(members.end(), sub_members.begin(), sub_members.end());
+		if (!parser->second->isFixedLength())
+			break;
+		offset += parser->second->length();
+	}
+
+	return members;
+}
+
+std::vector<FieldInfo> SequencedParser::fields()
+{
+	return fields("", 0);
+}
+
+bool SequencedParser::findField(const std::string &name, FieldInfo &field)
+{
+	auto members = fields();
+
+	for (auto member = members.begin(); member != members.end(); ++member)
+	{
+		if (member->name == name) {
+			field = *member;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool SequencedParser::findColumn(const std::string &name, FieldInfo &field, size_t &stride, size_t &count)
+{
+	const std::string kWILDCARD = "[*]";
+	size_t wildcard = name.find(kWILDCARD);
+
+	if (wildcard == std::string::npos || name.find(kWILDCARD, wildcard + 1) != std::string::npos)
+		return false;
+
+	// Elements are named prefix + index + suffix, e.g. "points[" 3 "].x".
+	std::string prefix = name.substr(0, wildcard + 1);
+	std::string suffix = name.substr(wildcard + 2);
+	auto members = fields();
+
+	stride = 0;
+	count = 0;
+	for (auto member = members.begin(); member != members.end(); ++member)
+	{
+		const std::string &member_name = member->name;
+		if (member_name.size() <= prefix.size() + suffix.size()
+			|| member_name.compare(0, prefix.size(), prefix) != 0
+			|| member_name.compare(member_name.size() - suffix.size(), suffix.size(), suffix) != 0)
+			continue;
+
+		std::string index = member_name.substr(prefix.size(), member_name.size() - prefix.size() - suffix.size());
+		if (index.find_first_not_of("0123456789") != std::string::npos || index != to_string(count))
+			continue;
+
+		if (count == 0)
+			field = *member;
+		else if (count == 1)
+			stride = member->offset - field.offset;
+		else if (member->offset != field.offset + count * stride)
+			return false;
+		++count;
+	}
+
+	return count != 0;
+}
+
 void SequencedParser::addParser(const std::string &name, BinaryParser *parser)
 {
+	size_t padding = 0;
+
+	if (_natural && _fixed)
+	{
+		size_t alignment = parser->alignment();
+		padding = (alignment - _length % alignment) % alignment;
+		_alignment = std::max(_alignment, alignment);
+	}
+
 	parsers.emplace_back(std::make_pair(name, parser));
-	_length += parser->length();
+	_padding.push_back(_pending + padding);
+	_presence.push_back(Presence());
+	_columns.push_back(0);
+	_pending = 0;
+	_length += padding + parser->length();
+	if (!parser->isFixedLength())
+		_fixed = false;
 }
 
-std::string StringParser::parse(const char *buffer)
+void SequencedParser::addParser(const std::string &name, BinaryParser *parser, const Presence &presence)
+{
+	addParser(name, parser);
+	_presence.back() = presence;
+	_fixed = false;
+
+	if (_zeros.size() < std::max<size_t>(parser->length(), 1))
+		_zeros.resize(std::max<size_t>(parser->length(), 1), 0);
+	_columns.back() = parser->expr("", _zeros.data()).size();
+}
+
+StructArrayParser::StructArrayParser(BinaryParser *element, size_t size)
+	: _element(element), _size(size), _stride(element->length()), _flat(false)
+{
+	_members = element->fields("", 0);
+
+	// Struct is formatted by its fields only if they are all of its columns.
+	std::vector<char> zeros(_stride, 0);
+	_flat = element->isFixedLength() && element->expr("", zeros.data()).size() == _members.size();
+}
+
+std::string StructArrayParser::parse(const char *buffer)
 {
-	std::string expr(buffer);
-	_length = expr.size();
+	if (buffer == nullptr)
+		throw NullBufferException();
+
+	std::string expr;
+
+	for (size_t i = 0; i < _size; ++i)
+		expr += _element->parse(buffer + i * _stride);
+
 	return expr;
 }
 
-std::vector<MemberInfo> StringParser::expr(const std::string &name, const char *buffer)
+std::vector<MemberInfo> StructArrayParser::expr(const std::string &name, const char *buffer)
 {
-	std::string expr(buffer);
 	std::vector<MemberInfo> members;
 
 	if (buffer == nullptr)
 		return members;
 
-	members.emplace_back(MemberInfo(name, expr));
-
-	_length = expr.size();
+	for (size_t i = 0; i < _size; ++i)
+	{
+		auto element_members = _element->expr(name + "[" + to_string(i) + "]", buffer + i * _stride);
+		members.insert(members.end(), element_members.begin(), element_members.end());
+	}
 
 	return members;
 }
 
-size_t StringParser::length()
+int StructArrayParser::fprintf(FILE *fp, const char *buffer)
+{
+	if (buffer == nullptr)
+		throw NullBufferException();
+
+	FormatSpecifier &specifier = FormatSpecifier::instance();
+
+	for (size_t i = 0; i < _size; ++i)
+	{
+		const char *element = buffer + i * _stride;
+		if (!_flat)
+		{
+			_element->fprintf(fp, element);
+		}
+		else
+		{
+			for (size_t j = 0; j < _members.size(); ++j)
+			{
+				_members[j].fprintf(fp, element);
+				if (j != _members.size() - 1)
+				{
+					std::fprintf(fp, "%s", specifier.get_delimiter());
+				}
+			}
+		}
+		if (i != _size - 1)
+		{
+			std::fprintf(fp, "%s", specifier.get_delimiter());
+		}
+	}
+
+	return 0;
+}
+
+std::vector<FieldInfo> StructArrayParser::fields(const std::string &name, size_t offset)
 {
-	return _length;
-}
\ No newline at end of file
+	std::vector<FieldInfo> members;
+
+	members.reserve(_size * _members.size());
+	for (size_t i = 0; i < _size; ++i)
+	{
+		std::string prefix = name + "[" + to_string(i) + "].";
+		for (size_t j = 0; j < _members.size(); ++j)
+		{
+			FieldInfo member = _members[j];
+			member.name = prefix + member.name;
+			member.offset += offset + i * _stride;
+			members.push_back(member);
+		}
+	}
+
+	return members;
+}
+
+std::string StringParser::parse(const char *buffer)
+{
+	return std::string(buffer);
+}
+
+std::vector<MemberInfo> StringParser::expr(const std::string &name, const char *buffer)
+{
+	std::vector<MemberInfo> members;
+
+	if (buffer == nullptr)
+		return members;
+
+	members.emplace_back(MemberInfo(name, std::string(buffer)));
+
+	return members;
+}
+
+size_t StringParser::lengthAt(const char *buffer, size_t available)
+{
+	const void *end = std::memchr(buffer, '\0', available);
+
+	return end == nullptr ? 0 : static_cast<const char*>(end) - buffer + 1;
+}
+
+std::string PrefixedStringParser::parse(const char *buffer)
+{
+	int64_t count = _prefix.integer(buffer);
+
+	return std::string(buffer + _prefix.size(), count < 0 ? 0 : static_cast<size_t>(count));
+}
+
+std::vector<MemberInfo> PrefixedStringParser::expr(const std::string &name, const char *buffer)
+{
+	std::vector<MemberInfo> members;
+
+	if (buffer == nullptr)
+		return members;
+
+	members.emplace_back(MemberInfo(name, parse(buffer)));
+
+	return members;
+}
+
+int PrefixedStringParser::fprintf(FILE *fp, const char *buffer)
+{
+	int64_t count = _prefix.integer(buffer);
+
+	if (count <= 0)
+		return 0;
+
+	return static_cast<int>(std::fwrite(buffer + _prefix.size(), 1, static_cast<size_t>(count), fp));
+}
+
+size_t PrefixedStringParser::lengthAt(const char *buffer, size_t available)
+{
+	if (_prefix.size() > available)
+		return 0;
+
+	int64_t count = _prefix.integer(buffer);
+	if (count < 0 || static_cast<uint64_t>(count) > available - _prefix.size())
+		return 0;
+
+	return _prefix.size() + static_cast<size_t>(count);
+}
+
+std::string CountedArrayParser::parse(const char *buffer)
+{
+	int64_t count = _prefix.integer(buffer);
+	std::string expr;
+
+	for (int64_t i = 0; i < count; ++i)
+	{
+		const char *element = buffer + _prefix.size() + i * _element.size();
+		const EnumTable::Entry *entry = _element.label(element);
+
+		if (i != 0)
+			expr += kCOUNTED_ARRAY_SEPARATOR;
+		if (entry != nullptr)
+			expr += entry->label;
+		else if (_element.isIntegral())
+			expr += std::to_string(static_cast<long long>(_element.integer(element)));
+		else
+			expr += to_string(_element.value(element));
+	}
+
+	return expr;
+}
+
+std::vector<MemberInfo> CountedArrayParser::expr(const std::string &name, const char *buffer)
+{
+	std::vector<MemberInfo> members;
+
+	if (buffer == nullptr)
+		return members;
+
+	members.emplace_back(MemberInfo(name, parse(buffer)));
+
+	return members;
+}
+
+int CountedArrayParser::fprintf(FILE *fp, const char *buffer)
+{
+	int64_t count = _prefix.integer(buffer);
+
+	for (int64_t i = 0; i < count; ++i)
+	{
+		if (i != 0)
+			std::fputc(kCOUNTED_ARRAY_SEPARATOR, fp);
+		_element.fprintf(fp, buffer + _prefix.size() + i * _element.size());
+	}
+
+	return 0;
+}
+
+size_t CountedArrayParser::lengthAt(const char *buffer, size_t available)
+{
+	if (_prefix.size() > available)
+		return 0;
+
+	int64_t count = _prefix.integer(buffer);
+	if (count < 0 || static_cast<uint64_t>(count) > (available - _prefix.size()) / _element.size())
+		return 0;
+
+	return _prefix.size() + static_cast<size_t>(count) * _element.size();
+}
+
+bool EnumTable::add(int64_t code, const std::string &label)
+{
+	Entry entry;
+
+	for (size_t i = 0; i < entries.size(); ++i)
+	{
+		if (entries[i].code == code)
+			return false;
+	}
+
+	entry.code = code;
+	entry.label = label;
+	appendJsonString(entry.quoted, label.data(), label.size());
+	entries.push_back(entry);
+
+	return true;
+}
+
+void EnumTable::build()
+{
+	slots.clear();
+	multiplier = 0;
+	shift = 64;
+	if (entries.empty())
+		return;
+
+	int64_t max_code = entries[0].code;
+	min_code = entries[0].code;
+	for (size_t i = 1; i < entries.size(); ++i)
+	{
+		min_code = std::min(min_code, entries[i].code);
+		max_code = std::max(max_code, entries[i].code);
+	}
+
+	uint64_t range = static_cast<uint64_t>(max_code) - static_cast<uint64_t>(min_code) + 1;
+	if (range != 0 && range <= std::max<uint64_t>(kDENSE_MIN_SLOTS, entries.size() * kDENSE_SLOTS_PER_LABEL))
+	{
+		slots.assign(range, -1);
+		for (size_t i = 0; i < entries.size(); ++i)
+		{
+			slots[static_cast<uint64_t>(entries[i].code) - static_cast<uint64_t>(min_code)] = static_cast<int32_t>(i);
+		}
+		return;
+	}
+
+	// Sparse codes, search a multiplier which hashes codes without collision,
+	// growing the table if none is found.
+	unsigned bits = 1;
+	while ((1ULL << bits) < entries.size() * 2)
+		++bits;
+
+	uint64_t seed = 0x9e3779b97f4a7c15ULL;
+	for (unsigned max_bits = bits + kHASH_MAX_GROWTH; bits <= max_bits; ++bits)
+	{
+		for (int attempt = 0; attempt < 64; ++attempt)
+		{
+			seed += 0x9e3779b97f4a7c15ULL;
+			uint64_t candidate = (seed ^ (seed >> 31)) | 1;
+
+			slots.assign(1ULL << bits, -1);
+			bool collided = false;
+			for (size_t i = 0; i < entries.size() && !collided; ++i)
+			{
+				int32_t &slot = slots[(static_cast<uint64_t>(entries[i].code) * candidate) >> (64 - bits)];
+				collided = slot != -1;
+				slot = static_cast<int32_t>(i);
+			}
+
+			if (!collided)
+			{
+				multiplier = candidate;
+				shift = 64 - bits;
+				return;
+			}
+		}
+	}
+
+	// No perfect hash is found, codes are searched in order instead.
+	slots.clear();
+	std::sort(entries.begin(), entries.end(),
+		[](const Entry &a, const Entry &b) { return a.code < b.code; });
+}
+
+bool EnumTable::code(const std::string &label, int64_t &code) const
+{
+	for (size_t i = 0; i < entries.size(); ++i)
+	{
+		if (entries[i].label == label)
+		{
+			code = entries[i].code;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void HalfFloatParser::convert(const char *buffer, size_t begin, size_t count, float *output) const
+{
+	uint16_t bits[kHALF_CHUNK_VALUES];
+
+	std::memcpy(bits, buffer + begin * sizeof(uint16_t), count * sizeof(uint16_t));
+	if (_field.type == FormatSpecifier::Type::FLOAT16)
+		half_to_float(bits, count, output);
+	else
+		bfloat16_to_float(bits, count, output);
+}
+
+std::string HalfFloatParser::parse(const char *buffer)
+{
+	if (buffer == nullptr)
+		throw NullBufferException();
+
+	std::string expr;
+	float values[kHALF_CHUNK_VALUES];
+
+	for (size_t begin = 0; begin < _size; begin += kHALF_CHUNK_VALUES)
+	{
+		size_t count = std::min(kHALF_CHUNK_VALUES, _size - begin);
+		convert(buffer, begin, count, values);
+		for (size_t i = 0; i < count; ++i)
+			expr += to_string(values[i]);
+	}
+
+	return expr;
+}
+
+std::vector<MemberInfo> HalfFloatParser::expr(const std::string &name, const char *buffer)
+{
+	std::vector<MemberInfo> members;
+	float values[kHALF_CHUNK_VALUES];
+
+	if (buffer == nullptr)
+		return members;
+
+	for (size_t begin = 0; begin < _size; begin += kHALF_CHUNK_VALUES)
+	{
+		size_t count = std::min(kHALF_CHUNK_VALUES, _size - begin);
+		convert(buffer, begin, count, values);
+		for (size_t i = 0; i < count; ++i)
+		{
+			std::string member = _is_array ? name + "[" + to_string(begin + i) + "]" : name;
+			members.emplace_back(MemberInfo(member, to_string(values[i])));
+		}
+	}
+
+	return members;
+}
+
+int HalfFloatParser::fprintf(FILE *fp, const char *buffer)
+{
+	if (buffer == nullptr)
+		throw NullBufferException();
+
+	FormatSpecifier &specifier = FormatSpecifier::instance();
+	float values[kHALF_CHUNK_VALUES];
+
+	for (size_t begin = 0; begin < _size; begin += kHALF_CHUNK_VALUES)
+	{
+		size_t count = std::min(kHALF_CHUNK_VALUES, _size - begin);
+		convert(buffer, begin, count, values);
+		for (size_t i = 0; i < count; ++i)
+		{
+			std::fprintf(fp, format_specifier<float>(), values[i]);
+			if (begin + i != _size - 1)
+			{
+				std::fprintf(fp, "%s", specifier.get_delimiter());
+			}
+		}
+	}
+
+	return 0;
+}
+
+std::vector<FieldInfo> HalfFloatParser::fields(const std::string &name, size_t offset)
+{
+	if (!_is_array)
+		return std::vector<FieldInfo>(1, FieldInfo(name, offset, _field.type));
+
+	std::vector<FieldInfo> members;
+
+	for (size_t i = 0; i < _size; ++i) {
+		members.emplace_back(FieldInfo(name + "[" + to_string(i) + "]", offset, _field.type));
+		offset += sizeof(uint16_t);
+	}
+
+	return members;
+}
+
+AttributedParser::AttributedParser(BinaryParser *parser, const FieldInfo &attributes)
+	: _parser(parser)
+{
+	_elements = parser->fields("", 0);
+	for (size_t i = 0; i < _elements.size(); ++i)
+	{
+		_elements[i].setAttributes(attributes);
+	}
+}
+
+std::string AttributedParser::parse(const char *buffer)
+{
+	if (buffer == nullptr)
+		throw NullBufferException();
+
+	std::string expr;
+
+	for (size_t i = 0; i < _elements.size(); ++i)
+	{
+		const EnumTable::Entry *entry = _elements[i].label(buffer);
+		if (_elements[i].ticks != 0)
+		{
+			char text[FieldInfo::kTIMESTAMP_LENGTH];
+			expr.append(text, _elements[i].snprintf(text, sizeof(text), buffer));
+		}
+		else
+		{
+			expr += entry != nullptr ? entry->label : to_string(_elements[i].value(buffer));
+		}
+	}
+
+	return expr;
+}
+
+std::vector<MemberInfo> AttributedParser::expr(const std::string &name, const char *buffer)
+{
+	std::vector<MemberInfo> members = _parser->expr(name, buffer);
+	bool header_units = FormatSpecifier::instance().get_header_units();
+
+	for (size_t i = 0; i < members.size() && i < _elements.size(); ++i)
+	{
+		const EnumTable::Entry *entry = _elements[i].label(buffer);
+		if (_elements[i].ticks != 0)
+		{
+			char text[FieldInfo::kTIMESTAMP_LENGTH];
+			members[i].second.assign(text, _elements[i].snprintf(text, sizeof(text), buffer));
+		}
+		else if (entry != nullptr)
+		{
+			members[i].second = entry->label;
+		}
+		else if (_elements[i].isScaled() || _elements[i].swapped)
+		{
+			members[i].second = to_string(_elements[i].value(buffer));
+		}
+		if (header_units && !_elements[i].unit.empty())
+		{
+			members[i].first += " [" + _elements[i].unit + "]";
+		}
+	}
+
+	return members;
+}
+
+int AttributedParser::fprintf(FILE *fp, const char *buffer)
+{
+	if (buffer == nullptr)
+		throw NullBufferException();
+
+	FormatSpecifier &specifier = FormatSpecifier::instance();
+
+	for (size_t i = 0; i < _elements.size(); ++i)
+	{
+		_elements[i].fprintf(fp, buffer);
+		if (i != _elements.size() - 1)
+		{
+			std::fprintf(fp, "%s", specifier.get_delimiter());
+		}
+	}
+
+	return 0;
+}
+
+std::vector<FieldInfo> AttributedParser::fields(const std::string &name, size_t offset)
+{
+	std::vector<FieldInfo> members = _parser->fields(name, offset);
+
+	for (size_t i = 0; i < members.size() && i < _elements.size(); ++i)
+	{
+		members[i].setAttributes(_elements[i]);
+	}
+
+	return members;
+}
+
+size_t AttributedParser::length()
+{
+	return _parser->length();
+}
+
+size_t AttributedParser::alignment()
+{
+	return _parser->alignment();
+}
+
+void BitfieldParser::addBitfield(const FieldInfo &bitfield)
+{
+	_bitfields.push_back(bitfield);
+}
+
+std::string BitfieldParser::parse(const char *buffer)
+{
+	if (buffer == nullptr)
+		throw NullBufferException();
+
+	std::string expr;
+
+	for (size_t i = 0; i < _bitfields.size(); ++i)
+	{
+		const EnumTable::Entry *entry = _bitfields[i].label(buffer);
+		expr += entry != nullptr ? entry->label : to_string(_bitfields[i].value(buffer));
+	}
+
+	return expr;
+}
+
+std::vector<MemberInfo> BitfieldParser::expr(const std::string &name, const char *buffer)
+{
+	std::vector<MemberInfo> members;
+	bool header_units = FormatSpecifier::instance().get_header_units();
+
+	if (buffer == nullptr)
+		return members;
+
+	for (size_t i = 0; i < _bitfields.size(); ++i)
+	{
+		const EnumTable::Entry *entry = _bitfields[i].label(buffer);
+		std::string member_name = name + "." + _bitfields[i].name;
+
+		if (header_units && !_bitfields[i].unit.empty())
+		{
+			member_name += " [" + _bitfields[i].unit + "]";
+		}
+		members.emplace_back(MemberInfo(member_name,
+			entry != nullptr ? entry->label : to_string(_bitfields[i].value(buffer))));
+	}
+
+	return members;
+}
+
+int BitfieldParser::fprintf(FILE *fp, const char *buffer)
+{
+	if (buffer == nullptr)
+		throw NullBufferException();
+
+	FormatSpecifier &specifier = FormatSpecifier::instance();
+
+	for (size_t i = 0; i < _bitfields.size(); ++i)
+	{
+		_bitfields[i].fprintf(fp, buffer);
+		if (i != _bitfields.size() - 1)
+		{
+			std::fprintf(fp, "%s", specifier.get_delimiter());
+		}
+	}
+
+	return 0;
+}
+
+std::vector<FieldInfo> BitfieldParser::fields(const std::string &name, size_t offset)
+{
+	std::vector<FieldInfo> members = _bitfields;
+
+	for (size_t i = 0; i < members.size(); ++i)
+	{
+		members[i].name = name + "." + members[i].name;
+		members[i].offset = offset;
+	}
+
+	return members;
+}
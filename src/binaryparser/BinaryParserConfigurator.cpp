@@ -1,11 +1,153 @@
 #include "BinaryParserConfigurator.h"
 #include "BinaryParser.h"
 
+#include <cstring>
 #include <iostream>
 
 using namespace ArduinoJson;
 using namespace StorageNS;
 
+namespace {
+	// Counts of padding bytes and array elements, which bound the record length.
+	const unsigned long long kMAX_COUNT = 1ULL << 24;
+
+	/**
+	* @brief   Parse the count in brackets of a type, e.g. 3 of "pad[3]".
+	* @returns
+	*          true if the count is a whole number up to kMAX_COUNT, or false if not.
+	**/
+	bool countOf(const std::string &type, size_t &count)
+	{
+		size_t open = type.find('[');
+		size_t close = type.find(']');
+
+		if (open == std::string::npos || close != type.size() - 1 || close == open + 1)
+			return false;
+
+		std::string digits = type.substr(open + 1, close - open - 1);
+		if (digits.find_first_not_of("0123456789") != std::string::npos)
+			return false;
+		try {
+			size_t end;
+			unsigned long long value = std::stoull(digits, &end);
+			if (end != digits.size() || value > kMAX_COUNT)
+				return false;
+			count = static_cast<size_t>(value);
+			return true;
+		}
+		catch (const std::exception &) {
+			return false;
+		}
+	}
+
+	/**
+	* @brief   Check if values in a byte order, "big" or "little", are stored
+	*          reversed to the host.
+	**/
+	bool reversedOrder(const char *endian)
+	{
+		if (endian == nullptr)
+			return false;
+
+		std::string order = endian;
+		return (order == "big" && is_little_endian()) || (order == "little" && !is_little_endian());
+	}
+
+	/**
+	* @brief   Ticks per second of a timestamp unit, "s", "ms", "us" or "ns".
+	* @returns
+	*          0 if unit is unknown.
+	**/
+	uint32_t ticksOf(const char *unit)
+	{
+		const char *units[] = { "s", "ms", "us", "ns" };
+		const uint32_t ticks[] = { 1, 1000, 1000000, 1000000000 };
+
+		for (size_t i = 0; unit != nullptr && i < sizeof(units) / sizeof(units[0]); ++i)
+		{
+			if (std::strcmp(unit, units[i]) == 0)
+				return ticks[i];
+		}
+
+		return 0;
+	}
+
+	/**
+	* @brief   Locate an integral field split into bitfields, which is not a
+	*          field itself, by its bitfields, e.g. "flags" by "flags.ready".
+	* @returns
+	*          true if found, or false if not.
+	**/
+	bool bitfieldWord(const std::string &name, SequencedParser &parsers, FieldInfo &word)
+	{
+		auto fields = parsers.fields();
+
+		for (auto field = fields.begin(); field != fields.end(); ++field)
+		{
+			if (field->width != 0 && field->name.compare(0, name.size() + 1, name + ".") == 0)
+			{
+				word = FieldInfo(name, field->offset, field->type);
+				word.swapped = field->swapped;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	/**
+	* @brief   Parse a condition of presence on an integral field located in
+	*          parsers, e.g. "flags & 0x04", "version >= 2", "mode == RUNNING"
+	*          or "header.extended", which holds if the field is nonzero.
+	* @returns
+	*          true if valid, or false if not.
+	**/
+	bool presenceOf(const std::string &text, SequencedParser &parsers, Presence &presence)
+	{
+		const char *ops[] = { "&", "==", "!=", "<=", ">=", "<", ">" };
+		const Presence::Op codes[] = { Presence::Op::MASK, Presence::Op::EQ, Presence::Op::NE,
+			Presence::Op::LE, Presence::Op::GE, Presence::Op::LT, Presence::Op::GT };
+		const char *kSPACES = " \t";
+		std::string name = text;
+		std::string value;
+
+		presence.op = Presence::Op::NONZERO;
+		for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); ++i)
+		{
+			size_t position = text.find(ops[i]);
+			if (position != std::string::npos)
+			{
+				name = text.substr(0, position);
+				value = text.substr(position + std::strlen(ops[i]));
+				presence.op = codes[i];
+				break;
+			}
+		}
+
+		name.erase(name.find_last_not_of(kSPACES) + 1);
+		name.erase(0, name.find_first_not_of(kSPACES));
+		value.erase(value.find_last_not_of(kSPACES) + 1);
+		value.erase(0, value.find_first_not_of(kSPACES));
+		if (!parsers.findField(name, presence.field) && !bitfieldWord(name, parsers, presence.field))
+			return false;
+		if (!presence.field.isIntegral())
+			return false;
+		if (presence.op == Presence::Op::NONZERO)
+			return true;
+
+		if (presence.field.labels && presence.field.labels->code(value, presence.value))
+			return true;
+		try {
+			size_t end;
+			presence.value = std::stoll(value, &end, 0);
+			return end == value.size();
+		}
+		catch (const std::exception &) {
+			return false;
+		}
+	}
+}
+
 JsonConfigurator::JsonConfigurator( const std::string &json_string )
 	: _doc(json_string.size() * 2)
 {
@@ -29,6 +171,13 @@ JsonConfigurator::JsonConfigurator( const std::string &json_string )
 	_factory.addParser("uint64_t", new BasicParser<uint64_t>());
 	_factory.addParser("float", new BasicParser<float>());
 	_factory.addParser("double", new BasicParser<double>());
+	_factory.addParser("float16", new HalfFloatParser(FormatSpecifier::Type::FLOAT16, 1, false));
+	_factory.addParser("bfloat16", new HalfFloatParser(FormatSpecifier::Type::BFLOAT16, 1, false));
+	_factory.addParser("string", new StringParser());
+
+	// Layout is composed up front, so a malformed member invalidates the configuration.
+	SequencedParser parsers;
+	composeMembers("TypeDescription", parsers);
 }
 
 bool JsonConfigurator::isValid()
@@ -36,22 +185,99 @@ bool JsonConfigurator::isValid()
 	return _valid;
 }
 
-SequencedParser JsonConfigurator::generateParser()
+std::string JsonConfigurator::derivedFields()
 {
-	JsonArray descriptions = _doc["TypeDescription"];
-	SequencedParser parsers;
+	JsonArray descriptions = _doc["DerivedFields"];
+	std::string declarations;
 
 	for (size_t i = 0; i < descriptions.size(); ++i) {
 		ArduinoJson::JsonObject obj = descriptions[i];
 		const char* name = obj.getMember("name");
+		const char* expression = obj.getMember("expression");
 		const char* type = obj.getMember("type");
-		const char* custom_type = obj.getMember("concreteType");
 
-		auto parser = generateParser(name, type, custom_type);
+		if (name == nullptr || expression == nullptr)
+			continue;
 
-		parsers.addParser(name, parser);
+		declarations += name;
+		if (type != nullptr) {
+			declarations += ":";
+			declarations += type;
+		}
+		declarations += "=";
+		declarations += expression;
+		declarations += ";";
 	}
 
+	return declarations;
+}
+
+bool JsonConfigurator::hasMessages()
+{
+	return _doc["Messages"].is<JsonObject>();
+}
+
+int JsonConfigurator::generateMessages(MessageDispatcher &dispatcher)
+{
+	JsonObject messages = _doc["Messages"];
+	const char* tag = messages["tag"];
+	FormatSpecifier::Type tag_type;
+
+	if (tag == nullptr || !basicType(tag, tag_type) || !FieldInfo("", 0, tag_type).isIntegral())
+		return -1;
+
+	FieldInfo tag_field("", 0, tag_type);
+	tag_field.swapped = tag_field.size() > 1 && reversedOrder(_doc["Endian"]);
+	dispatcher.setTag(tag_field);
+
+	JsonObject types = messages["types"];
+	for (auto type = types.begin(); type != types.end(); ++type)
+	{
+		const char* key = type->value().as<const char*>();
+		int64_t code;
+
+		if (key == nullptr || !_doc[key].is<JsonArray>())
+			return -1;
+		try {
+			code = std::stoll(type->key().c_str());
+		}
+		catch (const std::exception &) {
+			return -1;
+		}
+
+		// Layout covers the whole record, so it should start with the tag.
+		SequencedParser parsers;
+		composeMembers(key, parsers);
+		std::vector<FieldInfo> fields = parsers.fields();
+		if (!_valid || fields.empty() || fields[0].offset != 0 || fields[0].layoutCode() != tag_field.layoutCode()
+			|| fields[0].swapped != tag_field.swapped || parsers.length() < tag_field.size())
+			return -1;
+
+		// A code given twice, e.g. by "1" and "01", is ambiguous.
+		if (!dispatcher.addMessage(code, key, parsers))
+			return -1;
+	}
+	dispatcher.build();
+
+	return dispatcher.messageCount() == 0 ? -1 : 0;
+}
+
+SequencedParser JsonConfigurator::generateParser()
+{
+	SequencedParser parsers;
+
+	// Records may be prefixed with their length, e.g. "RecordLength": "uint32_t".
+	const char* record_length = _doc["RecordLength"];
+	FormatSpecifier::Type record_length_type;
+	if (record_length != nullptr && basicType(record_length, record_length_type))
+	{
+		FieldInfo prefix("", 0, record_length_type);
+		prefix.swapped = reversedOrder(_doc["Endian"]);
+		parsers.setRecordLength(prefix);
+	}
+
+	composeMembers("TypeDescription", parsers);
+
 	return parsers;
 }
 
@@ -59,9 +285,11 @@ BinaryParser * JsonConfigurator::generateParser( const char *name, const char *t
 {
 	const char* key = type;
 	
-	if (_factory.isStructType(type)) {
+	if (type != nullptr && _factory.isStructType(type)) {
 		key = concreteType;
 	}
+	if (key == nullptr)
+		return nullptr;
 
 	BinaryParser *parser = _factory.getParser(key);
 
@@ -80,47 +308,304 @@ BinaryParser * JsonConfigurator::generateParser( const char *name, const char *t
 	return parser;
 }
 
-BinaryParser* JsonConfigurator::composeParser(const char *key)
+BinaryParser* JsonConfigurator::fieldParser(ArduinoJson::JsonObject obj)
 {
-	JsonArray descriptions = _doc[key];
-	SequencedParser *parsers = new SequencedParser();
+	const char* name = obj.getMember("name");
+	const char* type = obj.getMember("type");
+	const char* custom_type = obj.getMember("concreteType");
+	const char* prefix = obj.getMember("prefix");
+
+	// Strings and arrays prefixed with their length, e.g.
+	// {"type": "string", "prefix": "uint16_t"} or {"type": "float[]", "prefix": "uint32_t"}.
+	FormatSpecifier::Type prefix_type;
+	if (type != nullptr && prefix != nullptr && basicType(prefix, prefix_type))
+	{
+		std::string type_name = type;
+		FormatSpecifier::Type element_type;
+		FieldInfo prefix_field("", 0, prefix_type);
+		prefix_field.swapped = reversedOrder(byteOrder(obj));
+
+		if (type_name == "string")
+		{
+			return _factory.adoptParser(new PrefixedStringParser(prefix_field));
+		}
+		if (type_name.size() > 2 && type_name.compare(type_name.size() - 2, 2, "[]") == 0
+			&& basicType(type_name.substr(0, type_name.size() - 2), element_type))
+		{
+			FieldInfo element("", 0, element_type);
+			FieldInfo attributes;
+			if (fieldAttributes(obj, attributes))
+				element.setAttributes(attributes);
+
+			return _factory.adoptParser(new CountedArrayParser(prefix_field, element));
+		}
+	}
+
+	// Bits of an integral field, e.g. "bitfields": [{"name": "mode", "bits": "4-6"}].
+	if (!obj["bitfields"].isNull())
+	{
+		return bitfieldParser(obj);
+	}
 
+	return attributeParser(obj, generateParser(name, type, custom_type));
+}
+
+BinaryParser* JsonConfigurator::bitfieldParser(ArduinoJson::JsonObject obj)
+{
+	const char* type = obj.getMember("type");
+	JsonArray descriptions = obj["bitfields"];
+	FormatSpecifier::Type word_type;
+	FieldInfo word;
+
+	// Only an integral word splits into bits.
+	if (type == nullptr || !basicType(type, word_type) || FieldInfo("", 0, word_type).isFloatingPoint())
+		return nullptr;
+	fieldAttributes(obj, word);
+
+	BitfieldParser *parser = new BitfieldParser(_factory.getParser(type));
 	for (size_t i = 0; i < descriptions.size(); ++i) {
-		ArduinoJson::JsonObject obj = descriptions[i];
-		const char* name = obj.getMember("name");
-		const char* type = obj.getMember("type");
-		const char* custom_type = obj.getMember("concreteType");
+		ArduinoJson::JsonObject description = descriptions[i];
+		const char* name = description.getMember("name");
+		JsonVariant bits = description["bits"];
+		unsigned low;
+		unsigned high;
 
-		auto parser = generateParser(name, type, custom_type);
+		// Bits are numbered from the least significant bit, e.g. "4-6" or 3.
+		// A bitfield of malformed or out-of-range bits invalidates the configuration.
+		std::string range = bits.is<const char*>() ? bits.as<const char*>()
+			: bits.is<unsigned>() ? std::to_string(bits.as<unsigned>()) : "";
+		size_t dash = range.find('-');
+		std::string first = range.substr(0, dash);
+		std::string last = dash == std::string::npos ? first : range.substr(dash + 1);
+		if (name == nullptr || first.empty() || last.empty() || first.size() > 2 || last.size() > 2
+			|| (first + last).find_first_not_of("0123456789") != std::string::npos)
+		{
+			_valid = false;
+			continue;
+		}
+		low = static_cast<unsigned>(std::stoul(first));
+		high = static_cast<unsigned>(std::stoul(last));
+		if (low > high || high >= FieldInfo("", 0, word_type).size() * 8)
+		{
+			_valid = false;
+			continue;
+		}
 
-		parsers->addParser(name, parser);
+		FieldInfo bitfield(name, 0, word_type);
+		FieldInfo attributes;
+		if (fieldAttributes(description, attributes))
+			bitfield.setAttributes(attributes);
+		bitfield.swapped = word.swapped;
+		bitfield.shift = low;
+		bitfield.width = high - low + 1;
+		parser->addBitfield(bitfield);
 	}
 
-	return parsers;
+	return _factory.adoptParser(parser);
 }
 
-BinaryParser* JsonConfigurator::composeStructParser(const char *key)
+bool JsonConfigurator::fieldAttributes(ArduinoJson::JsonObject obj, FieldInfo &attributes)
+{
+	bool attributed = false;
+
+	if (obj.containsKey("scale") || obj.containsKey("offset") || obj.containsKey("unit"))
+	{
+		const char* unit = obj.getMember("unit");
+
+		attributes.scale = obj.containsKey("scale") ? obj["scale"].as<double>() : 1.0;
+		attributes.bias = obj.containsKey("offset") ? obj["offset"].as<double>() : 0.0;
+		attributes.unit = unit == nullptr ? "" : unit;
+		attributed = true;
+	}
+
+	// Labels of codes, e.g. "enum": {"0": "IDLE", "2": "RUNNING"}.
+	JsonObject labels = obj["enum"];
+	if (!labels.isNull())
+	{
+		std::shared_ptr<EnumTable> table = std::make_shared<EnumTable>();
+
+		// A code labelled twice, e.g. by "1" and "01", keeps its first label.
+		// A key other than a whole decimal code, e.g. "2.9" or "0x2", invalidates the configuration.
+		for (auto label = labels.begin(); label != labels.end(); ++label)
+		{
+			const char* text = label->value().as<const char*>();
+			std::string key = label->key().c_str();
+			int64_t code = 0;
+			size_t end = 0;
+			try {
+				code = std::stoll(key, &end);
+			}
+			catch (const std::exception &) {
+				end = 0;
+			}
+			if (end == 0 || end != key.size())
+			{
+				_valid = false;
+				continue;
+			}
+			table->add(code, text == nullptr ? "" : text);
+		}
+		table->build();
+		attributes.labels = table;
+		attributed = true;
+	}
+
+	// Byte order of basic or array type elements, single bytes have none.
+	const char* type = obj.getMember("type");
+	FormatSpecifier::Type element_type;
+	if (type != nullptr && reversedOrder(byteOrder(obj))
+		&& basicType(std::string(type).substr(0, std::string(type).find('[')), element_type)
+		&& FieldInfo("", 0, element_type).size() > 1)
+	{
+		attributes.swapped = true;
+		attributed = true;
+	}
+
+	// Ticks since epoch of an integral field, e.g. "timestamp": "ns".
+	uint32_t ticks = ticksOf(obj.getMember("timestamp"));
+	if (ticks != 0 && type != nullptr
+		&& basicType(std::string(type).substr(0, std::string(type).find('[')), element_type)
+		&& FieldInfo("", 0, element_type).isIntegral())
+	{
+		const char* zone = obj.getMember("timezone");
+		if (zone == nullptr)
+			zone = _doc["Timezone"].as<const char*>();
+
+		attributes.ticks = ticks;
+		attributes.local = zone != nullptr && std::string(zone) == "local";
+		attributed = true;
+	}
+
+	return attributed;
+}
+
+const char* JsonConfigurator::byteOrder(ArduinoJson::JsonObject obj)
+{
+	const char* endian = obj.getMember("endian");
+
+	return endian != nullptr ? endian : _doc["Endian"].as<const char*>();
+}
+
+BinaryParser* JsonConfigurator::attributeParser(ArduinoJson::JsonObject obj, BinaryParser *parser)
+{
+	const char* type = obj.getMember("type");
+
+	if (parser == nullptr || type == nullptr || _factory.isStructType(type) || !parser->isFixedLength())
+		return parser;
+
+	FieldInfo attributes;
+	if (fieldAttributes(obj, attributes))
+	{
+		parser = _factory.adoptParser(new AttributedParser(parser, attributes));
+	}
+
+	return parser;
+}
+
+bool JsonConfigurator::naturalAlignment(const char *key)
+{
+	// Either "Alignment": "natural" for all structs, or per struct, e.g.
+	// "Alignment": {"default": "packed", "Point": "natural"}.
+	JsonVariant alignment = _doc["Alignment"];
+	const char* mode = alignment.as<const char*>();
+
+	if (alignment.is<JsonObject>())
+	{
+		JsonObject modes = alignment.as<JsonObject>();
+		mode = modes.containsKey(key) ? modes[key].as<const char*>() : modes["default"].as<const char*>();
+	}
+
+	return mode != nullptr && std::string(mode) == "natural";
+}
+
+void JsonConfigurator::composeMembers(const char *key, SequencedParser &parsers)
 {
 	JsonArray descriptions = _doc[key];
-	SequencedParser *parsers = new SequencedParser();
 
+	parsers.setNaturalAlignment(naturalAlignment(key));
 	for (size_t i = 0; i < descriptions.size(); ++i) {
 		ArduinoJson::JsonObject obj = descriptions[i];
 		const char* name = obj.getMember("name");
 		const char* type = obj.getMember("type");
-		const char* custom_type = obj.getMember("concreteType");
 
-		auto parser = generateParser(name, type, custom_type);
+		// Explicit padding, e.g. {"type": "pad[3]"}, is skipped without a parser.
+		if (type != nullptr && _factory.isPaddingType(type))
+		{
+			size_t count;
+			if (!countOf(type, count))
+			{
+				_valid = false;
+				return;
+			}
+			parsers.addPadding(count);
+			continue;
+		}
+
+		// A member of an undeclared type, e.g. "Foo[3]", invalidates the configuration.
+		auto parser = fieldParser(obj);
+		if (parser == nullptr)
+		{
+			_valid = false;
+			return;
+		}
+
+		// Optional members, e.g. {"name": "ext", "type": "struct", "concreteType": "Ext", "present_if": "flags & 0x04"}.
+		// A member of an invalid condition, or of variable length, invalidates the configuration.
+		const char* present_if = obj.getMember("present_if");
+		if (present_if != nullptr)
+		{
+			Presence presence;
+			if (!parser->isFixedLength() || parser->length() == 0 || !presenceOf(present_if, parsers, presence))
+			{
+				_valid = false;
+				return;
+			}
+			parsers.addParser(name, parser, presence);
+			continue;
+		}
 
-		parsers->addParser(name, parser);
+		parsers.addParser(name, parser);
 	}
+}
+
+BinaryParser* JsonConfigurator::composeParser(const char *key)
+{
+	SequencedParser *parsers = new SequencedParser();
+
+	composeMembers(key, *parsers);
+
+	return parsers;
+}
+
+BinaryParser* JsonConfigurator::composeStructParser(const char *key)
+{
+	SequencedParser *parsers = new SequencedParser();
+
+	composeMembers(key, *parsers);
 
 	return parsers;
 }
 
 BinaryParser* JsonConfigurator::composeArrayParser(const char *key)
 {
+	size_t count;
+	if (!countOf(key, count))
+		return nullptr;
+
 	auto parser = _factory.getArrayParser(key);
 
-	return parser;
+	if (parser != nullptr)
+		return parser;
+
+	// Array of a struct declared in configuration, e.g. "Point[16]".
+	std::string type = key;
+	std::string element_type = type.substr(0, type.find('['));
+	if (!_doc[element_type].is<JsonArray>())
+		return nullptr;
+
+	BinaryParser *element = generateParser(element_type.c_str(), "struct", element_type.c_str());
+	if (element == nullptr || !element->isFixedLength())
+		return nullptr;
+
+	return new StructArrayParser(element, count);
 }
@@ -0,0 +1,540 @@
+#include "FieldExpression.h"
+
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+using namespace StorageNS;
+
+namespace {
+	typedef double (*Function1)(double);
+	typedef double (*Function2)(double, double);
+
+	struct NamedFunction1 {
+		const char *name;
+		Function1 function;
+	};
+
+	struct NamedFunction2 {
+		const char *name;
+		Function2 function;
+	};
+
+	const NamedFunction1 kFUNCTIONS1[] = {
+		{ "sqrt", [](double x) { return std::sqrt(x); } },
+		{ "abs", [](double x) { return std::fabs(x); } },
+		{ "exp", [](double x) { return std::exp(x); } },
+		{ "log", [](double x) { return std::log(x); } },
+		{ "log10", [](double x) { return std::log10(x); } },
+		{ "sin", [](double x) { return std::sin(x); } },
+		{ "cos", [](double x) { return std::cos(x); } },
+		{ "tan", [](double x) { return std::tan(x); } },
+		{ "asin", [](double x) { return std::asin(x); } },
+		{ "acos", [](double x) { return std::acos(x); } },
+		{ "atan", [](double x) { return std::atan(x); } },
+		{ "floor", [](double x) { return std::floor(x); } },
+		{ "ceil", [](double x) { return std::ceil(x); } },
+		{ "round", [](double x) { return std::round(x); } }
+	};
+
+	const NamedFunction2 kFUNCTIONS2[] = {
+		{ "pow", [](double x, double y) { return std::pow(x, y); } },
+		{ "atan2", [](double x, double y) { return std::atan2(x, y); } },
+		{ "min", [](double x, double y) { return x < y ? x : y; } },
+		{ "max", [](double x, double y) { return x < y ? y : x; } },
+		{ "hypot", [](double x, double y) { return std::hypot(x, y); } }
+	};
+
+	// Names of aggregates in order of FieldExpression::Aggregate.
+	const char *kAGGREGATES[] = { "sum", "mean", "min", "max" };
+
+	const size_t kFUNCTION1_COUNT = sizeof(kFUNCTIONS1) / sizeof(kFUNCTIONS1[0]);
+	const size_t kFUNCTION2_COUNT = sizeof(kFUNCTIONS2) / sizeof(kFUNCTIONS2[0]);
+
+	inline std::string trim(const std::string &text)
+	{
+		size_t begin = text.find_first_not_of(" \t\r\n");
+		size_t end = text.find_last_not_of(" \t\r\n");
+		return begin == std::string::npos ? std::string() : text.substr(begin, end - begin + 1);
+	}
+
+	// Round a value to an integral type, saturating at limits of type.
+	template <typename T>
+	inline void storeRounded(double value, char *buffer)
+	{
+		T stored;
+
+		if (value <= static_cast<double>(std::numeric_limits<T>::min()))
+			stored = std::numeric_limits<T>::min();
+		else if (value >= static_cast<double>(std::numeric_limits<T>::max()))
+			stored = std::numeric_limits<T>::max();
+		else
+			stored = static_cast<T>(std::round(value));
+		std::memcpy(buffer, &stored, sizeof(stored));
+	}
+}
+
+/**
+* Recursive descent compiler emitting code in postfix order.
+*/
+class StorageNS::ExpressionCompiler {
+public:
+	ExpressionCompiler(const std::string &text, SequencedParser &parsers, FieldExpression &expression)
+		:text(text), position(0), parsers(parsers), expression(expression), depth(0) {}
+
+	bool compile()
+	{
+		if (!parseSum())
+			return false;
+		skipSpaces();
+		return position == text.size() && depth == 1;
+	}
+
+private:
+	void skipSpaces()
+	{
+		while (position < text.size() && std::isspace(static_cast<unsigned char>(text[position])))
+			++position;
+	}
+
+	bool accept(char c)
+	{
+		skipSpaces();
+		if (position < text.size() && text[position] == c) {
+			++position;
+			return true;
+		}
+		return false;
+	}
+
+	void emit(FieldExpression::OpCode op, size_t operand, int stack_change)
+	{
+		FieldExpression::Instruction instruction = { op, operand };
+		expression.code.push_back(instruction);
+		depth += stack_change;
+		if (depth > static_cast<int>(expression.depth))
+			expression.depth = static_cast<size_t>(depth);
+	}
+
+	bool parseSum()
+	{
+		if (!parseProduct())
+			return false;
+
+		while (true)
+		{
+			if (accept('+')) {
+				if (!parseProduct())
+					return false;
+				emit(FieldExpression::OpCode::ADD, 0, -1);
+			}
+			else if (accept('-')) {
+				if (!parseProduct())
+					return false;
+				emit(FieldExpression::OpCode::SUBTRACT, 0, -1);
+			}
+			else {
+				return true;
+			}
+		}
+	}
+
+	bool parseProduct()
+	{
+		if (!parseUnary())
+			return false;
+
+		while (true)
+		{
+			if (accept('*')) {
+				if (!parseUnary())
+					return false;
+				emit(FieldExpression::OpCode::MULTIPLY, 0, -1);
+			}
+			else if (accept('/')) {
+				if (!parseUnary())
+					return false;
+				emit(FieldExpression::OpCode::DIVIDE, 0, -1);
+			}
+			else {
+				return true;
+			}
+		}
+	}
+
+	bool parseUnary()
+	{
+		if (accept('-')) {
+			if (!parseUnary())
+				return false;
+			emit(FieldExpression::OpCode::NEGATE, 0, 0);
+			return true;
+		}
+		if (accept('+'))
+			return parseUnary();
+
+		return parsePrimary();
+	}
+
+	bool parsePrimary()
+	{
+		skipSpaces();
+		if (position >= text.size())
+			return false;
+
+		char c = text[position];
+		if (accept('(')) {
+			return parseSum() && accept(')');
+		}
+
+		if (std::isdigit(static_cast<unsigned char>(c)) || c == '.') {
+			const char *begin = text.c_str() + position;
+			char *end = nullptr;
+			double value = std::strtod(begin, &end);
+			if (end == begin)
+				return false;
+			position += end - begin;
+			expression.constants.push_back(value);
+			emit(FieldExpression::OpCode::CONSTANT, expression.constants.size() - 1, 1);
+			return true;
+		}
+
+		if (!std::isalpha(static_cast<unsigned char>(c)) && c != '_')
+			return false;
+
+		std::string name;
+		if (!parseName(name))
+			return false;
+
+		if (accept('('))
+			return parseCall(name);
+
+		// Text of char fields has no value in expressions.
+		FieldInfo field;
+		if (!parsers.findField(name, field) || !field.isNumeric())
+			return false;
+		expression.fields.push_back(field);
+		emit(FieldExpression::OpCode::FIELD, expression.fields.size() - 1, 1);
+
+		return true;
+	}
+
+	// Field names may be nested, e.g. "pos.x", or array elements, e.g. "s[1]".
+	bool parseName(std::string &name)
+	{
+		size_t begin = position;
+
+		while (position < text.size())
+		{
+			char c = text[position];
+			if (std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '.') {
+				++position;
+			}
+			else if (c == '[') {
+				size_t close = text.find(']', position);
+				if (close == std::string::npos)
+					return false;
+				position = close + 1;
+			}
+			else {
+				break;
+			}
+		}
+		name = text.substr(begin, position - begin);
+
+		return !name.empty();
+	}
+
+	// Aggregate of a column of array elements, e.g. "sum(samples[*])".
+	bool parseAggregate(const std::string &function)
+	{
+		size_t begin = position;
+
+		for (size_t i = 0; i < sizeof(kAGGREGATES) / sizeof(kAGGREGATES[0]); ++i)
+		{
+			FieldExpression::Column column;
+			std::string name;
+
+			if (function != kAGGREGATES[i])
+				continue;
+
+			skipSpaces();
+			if (parseName(name) && accept(')')
+				&& parsers.findColumn(name, column.field, column.stride, column.count))
+			{
+				column.aggregate = static_cast<FieldExpression::Aggregate>(i);
+				expression.columns.push_back(column);
+				emit(FieldExpression::OpCode::AGGREGATE, expression.columns.size() - 1, 1);
+
+				// Elements are read into a scratch slot above the top.
+				if (depth + 1 > static_cast<int>(expression.depth))
+					expression.depth = static_cast<size_t>(depth + 1);
+				return true;
+			}
+			break;
+		}
+		position = begin;
+
+		return false;
+	}
+
+	bool parseCall(const std::string &name)
+	{
+		if (parseAggregate(name))
+			return true;
+
+		for (size_t i = 0; i < kFUNCTION1_COUNT; ++i)
+		{
+			if (name == kFUNCTIONS1[i].name) {
+				if (!parseSum() || !accept(')'))
+					return false;
+				emit(FieldExpression::OpCode::CALL1, i, 0);
+				return true;
+			}
+		}
+
+		for (size_t i = 0; i < kFUNCTION2_COUNT; ++i)
+		{
+			if (name == kFUNCTIONS2[i].name) {
+				if (!parseSum() || !accept(',') || !parseSum() || !accept(')'))
+					return false;
+				emit(FieldExpression::OpCode::CALL2, i, -1);
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	const std::string &text;
+	size_t position;
+	SequencedParser &parsers;
+	FieldExpression &expression;
+	int depth;
+};
+
+int FieldExpression::compile(const std::string &expression, SequencedParser &parsers)
+{
+	code.clear();
+	fields.clear();
+	columns.clear();
+	constants.clear();
+	depth = 0;
+
+	ExpressionCompiler compiler(expression, parsers, *this);
+	if (!compiler.compile())
+	{
+		code.clear();
+		return -1;
+	}
+
+	return 0;
+}
+
+void FieldExpression::evaluate(const char *records, size_t item_length, const uint32_t *selection, size_t count,
+	double *output, std::vector<double> &stack) const
+{
+	if (code.empty() || count == 0)
+		return;
+
+	if (stack.size() < (depth + 1) * count)
+		stack.resize((depth + 1) * count);
+
+	// Column i of stack holds values of stack slot i of all records, and
+	// column 0 is left unused so that top always points into stack.
+	double *top = stack.data();
+	for (auto instruction = code.begin(); instruction != code.end(); ++instruction)
+	{
+		switch (instruction->op) {
+		case OpCode::FIELD:
+		{
+			top += count;
+			fields[instruction->operand].values(records, item_length, selection, count, top);
+			break;
+		}
+		case OpCode::CONSTANT:
+		{
+			double value = constants[instruction->operand];
+			top += count;
+			for (size_t i = 0; i < count; ++i)
+				top[i] = value;
+			break;
+		}
+		case OpCode::ADD:
+			top -= count;
+			for (size_t i = 0; i < count; ++i)
+				top[i] += top[i + count];
+			break;
+		case OpCode::SUBTRACT:
+			top -= count;
+			for (size_t i = 0; i < count; ++i)
+				top[i] -= top[i + count];
+			break;
+		case OpCode::MULTIPLY:
+			top -= count;
+			for (size_t i = 0; i < count; ++i)
+				top[i] *= top[i + count];
+			break;
+		case OpCode::DIVIDE:
+			top -= count;
+			for (size_t i = 0; i < count; ++i)
+				top[i] /= top[i + count];
+			break;
+		case OpCode::NEGATE:
+			for (size_t i = 0; i < count; ++i)
+				top[i] = -top[i];
+			break;
+		case OpCode::CALL1:
+		{
+			Function1 function = kFUNCTIONS1[instruction->operand].function;
+			for (size_t i = 0; i < count; ++i)
+				top[i] = function(top[i]);
+			break;
+		}
+		case OpCode::AGGREGATE:
+		{
+			const Column &column = columns[instruction->operand];
+			FieldInfo element = column.field;
+			double *scratch = top + 2 * count;
+
+			// Elements are swept one at a time over all records.
+			top += count;
+			element.values(records, item_length, selection, count, top);
+			for (size_t j = 1; j < column.count; ++j)
+			{
+				element.offset = column.field.offset + j * column.stride;
+				element.values(records, item_length, selection, count, scratch);
+				switch (column.aggregate) {
+				case Aggregate::MIN:
+					for (size_t i = 0; i < count; ++i)
+						top[i] = scratch[i] < top[i] ? scratch[i] : top[i];
+					break;
+				case Aggregate::MAX:
+					for (size_t i = 0; i < count; ++i)
+						top[i] = top[i] < scratch[i] ? scratch[i] : top[i];
+					break;
+				default:
+					for (size_t i = 0; i < count; ++i)
+						top[i] += scratch[i];
+					break;
+				}
+			}
+			if (column.aggregate == Aggregate::MEAN)
+			{
+				for (size_t i = 0; i < count; ++i)
+					top[i] /= static_cast<double>(column.count);
+			}
+			break;
+		}
+		default:
+		{
+			Function2 function = kFUNCTIONS2[instruction->operand].function;
+			top -= count;
+			for (size_t i = 0; i < count; ++i)
+				top[i] = function(top[i], top[i + count]);
+			break;
+		}
+		}
+	}
+
+	std::copy(top, top + count, output);
+}
+
+double FieldExpression::evaluate(const char *record, std::vector<double> &stack) const
+{
+	const uint32_t selection = 0;
+	double value = 0;
+
+	evaluate(record, 0, &selection, 1, &value, stack);
+
+	return value;
+}
+
+int DerivedField::snprintf(char *output, size_t size, double value) const
+{
+	char buffer[sizeof(uint64_t)];
+
+	// NaN has no integral value, it is left empty.
+	if (value != value && format.isIntegral())
+	{
+		if (size > 0)
+			output[0] = '\0';
+		return 0;
+	}
+
+	store(value, buffer);
+	return format.snprintf(output, size, buffer);
+}
+
+void DerivedField::store(double value, char *buffer) const
+{
+	switch (type) {
+	case FormatSpecifier::Type::INT8_T: storeRounded<int8_t>(value, buffer); break;
+	case FormatSpecifier::Type::INT16_T: storeRounded<int16_t>(value, buffer); break;
+	case FormatSpecifier::Type::INT32_T: storeRounded<int32_t>(value, buffer); break;
+	case FormatSpecifier::Type::INT64_T: storeRounded<int64_t>(value, buffer); break;
+	case FormatSpecifier::Type::UINT8_T: storeRounded<uint8_t>(value, buffer); break;
+	case FormatSpecifier::Type::UINT16_T: storeRounded<uint16_t>(value, buffer); break;
+	case FormatSpecifier::Type::UINT32_T: storeRounded<uint32_t>(value, buffer); break;
+	case FormatSpecifier::Type::UINT64_T: storeRounded<uint64_t>(value, buffer); break;
+	case FormatSpecifier::Type::FLOAT: { float stored = static_cast<float>(value); std::memcpy(buffer, &stored, sizeof(stored)); break; }
+	case FormatSpecifier::Type::FLOAT16: { uint16_t stored = float_to_half(static_cast<float>(value)); std::memcpy(buffer, &stored, sizeof(stored)); break; }
+	case FormatSpecifier::Type::BFLOAT16: { uint16_t stored = float_to_bfloat16(static_cast<float>(value)); std::memcpy(buffer, &stored, sizeof(stored)); break; }
+	default: std::memcpy(buffer, &value, sizeof(value)); break;
+	}
+}
+
+int DerivedField::fprintf(FILE *fp, double value) const
+{
+	char buffer[64];
+	int length = snprintf(buffer, sizeof(buffer), value);
+
+	if (length < 0 || static_cast<size_t>(length) < sizeof(buffer))
+		return length < 0 ? length : std::fprintf(fp, "%s", buffer);
+
+	std::vector<char> large(length + 1);
+	snprintf(large.data(), large.size(), value);
+	return std::fprintf(fp, "%s", large.data());
+}
+
+int StorageNS::parseDerivedFields(const std::string &declarations, SequencedParser &parsers, std::vector<DerivedField> &derived)
+{
+	size_t begin = 0;
+
+	while (begin <= declarations.size())
+	{
+		size_t end = declarations.find(';', begin);
+		if (end == std::string::npos)
+			end = declarations.size();
+
+		std::string declaration = trim(declarations.substr(begin, end - begin));
+		begin = end + 1;
+		if (declaration.empty())
+			continue;
+
+		size_t equal = declaration.find('=');
+		if (equal == std::string::npos)
+			return -1;
+
+		DerivedField field;
+		std::string name = trim(declaration.substr(0, equal));
+		size_t colon = name.find(':');
+		if (colon != std::string::npos)
+		{
+			if (!basicType(trim(name.substr(colon + 1)), field.type))
+				return -1;
+			name = trim(name.substr(0, colon));
+		}
+		if (name.empty())
+			return -1;
+
+		field.name = name;
+		field.format = FieldInfo(name, 0, field.type);
+		if (field.expression.compile(declaration.substr(equal + 1), parsers) == -1)
+			return -1;
+		derived.push_back(field);
+	}
+
+	return 0;
+}
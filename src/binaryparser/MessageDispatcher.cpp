@@ -0,0 +1,81 @@
+#include "MessageDispatcher.h"
+
+#include <algorithm>
+
+using namespace StorageNS;
+
+namespace {
+	// Jump table is dense if codes span at most this many slots.
+	const uint64_t kDENSE_MAX_SLOTS = 65536;
+}
+
+void MessageDispatcher::setTag(const FieldInfo &tag)
+{
+	this->tag = tag;
+}
+
+bool MessageDispatcher::addMessage(int64_t code, const std::string &name, const SequencedParser &parsers)
+{
+	for (size_t i = 0; i < messages.size(); ++i)
+	{
+		if (messages[i].code == code)
+			return false;
+	}
+
+	Message message = { code, name, parsers };
+	messages.push_back(message);
+
+	return true;
+}
+
+void MessageDispatcher::build()
+{
+	slots.clear();
+	sparse.clear();
+	if (messages.empty())
+		return;
+
+	int64_t max_code = messages[0].code;
+	min_code = messages[0].code;
+	for (size_t i = 1; i < messages.size(); ++i)
+	{
+		min_code = std::min(min_code, messages[i].code);
+		max_code = std::max(max_code, messages[i].code);
+	}
+
+	uint64_t span = static_cast<uint64_t>(max_code) - static_cast<uint64_t>(min_code);
+	if (span < kDENSE_MAX_SLOTS)
+	{
+		slots.assign(static_cast<size_t>(span) + 1, -1);
+		for (size_t i = 0; i < messages.size(); ++i)
+			slots[static_cast<size_t>(messages[i].code - min_code)] = static_cast<int32_t>(i);
+	}
+	else
+	{
+		for (size_t i = 0; i < messages.size(); ++i)
+			sparse[messages[i].code] = static_cast<int32_t>(i);
+	}
+}
+
+size_t MessageDispatcher::lengthAt(const char *buffer, size_t available)
+{
+	if (available < tag.size())
+		return 0;
+
+	int index = find(buffer);
+	if (index == -1)
+		return 0;
+
+	return messages[index].parsers.lengthAt(buffer, available);
+}
+
+bool MessageDispatcher::isFixedLength()
+{
+	for (size_t i = 0; i < messages.size(); ++i)
+	{
+		if (!messages[i].parsers.isFixedLength())
+			return false;
+	}
+
+	return true;
+}
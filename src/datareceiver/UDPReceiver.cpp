@@ -49,3 +49,15 @@ buffer_t UDPReceiver::receive(int size)
 
 	return buffer_t(buffer, received);
 }
+
+buffer_t UDPReceiver::receiveMessage(int max_size)
+{
+	// One byte more than max_size tells a larger datagram, which is truncated.
+	char *buffer = new char[max_size + 1];
+	int received = recvfrom(link.local, buffer, max_size + 1, 0, NULL, NULL);
+
+	if (received <= 0 || received > max_size)
+		received = 0;
+
+	return buffer_t(buffer, received);
+}
\ No newline at end of file
@@ -0,0 +1,179 @@
+#include "DatasetConverter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+using namespace StorageNS;
+
+namespace {
+	const size_t kCOPY_BUFFER_SIZE = 64 * 1024;
+}
+
+DatasetStorageConverter::~DatasetStorageConverter()
+{
+	if (csv_file != nullptr)
+		std::fclose(csv_file);
+
+	// Parts left by a failed or stopped conversion.
+	for (size_t i = current_item; i < parts.size(); ++i)
+	{
+		std::remove(parts[i].data());
+	}
+}
+
+void DatasetStorageConverter::setTimeField(const std::string &field)
+{
+	catalog.setTimeField(field);
+}
+
+int DatasetStorageConverter::prepare()
+{
+	if (catalog.open(source, template_) == -1)
+	{
+		return -1;
+	}
+
+	SequencedParser &parsers = catalog.parsers();
+	item_length = parsers.length();
+	skipped = catalog.mismatched();
+
+	predicates.clear();
+	if (parsePredicates(filter, parsers, predicates) == -1)
+	{
+		return -1;
+	}
+
+	// Parts evaluate derived fields themselves, these only name header.
+	derived.clear();
+	if (parseDerivedFields(catalog.derivedFields() + derivation, parsers, derived) == -1)
+	{
+		return -1;
+	}
+
+	uint64_t begin_key = 0;
+	uint64_t end_key = ~0ULL;
+	if (has_range && range_name == catalog.timeField().name
+		&& compileRange(catalog.timeField(), begin_key, end_key) == -1)
+	{
+		return -1;
+	}
+
+	std::vector<std::string> files = catalog.select(begin_key, end_key, predicates);
+
+	parts.clear();
+	current_item = 0;
+	for (size_t i = 0; i < files.size(); ++i)
+	{
+		std::string part = createPartFile(i);
+		if (part.empty())
+		{
+			return -1;
+		}
+		parts.push_back(part);
+	}
+
+	std::atomic<size_t> next_file(0);
+	std::atomic<bool> failed(false);
+	auto worker = [&]() {
+		for (size_t i = next_file++; i < files.size() && !failed; i = next_file++)
+		{
+			CsvStorageConverter converter;
+
+			converter.setBinarySource(files[i]);
+			converter.setTargetFile(parts[i]);
+			converter.setTemplate(template_);
+			if (has_range)
+				converter.setRange(range_name, range_begin, range_end);
+			converter.setFilter(filter);
+			converter.setDerivedFields(derivation);
+
+			if (converter.prepare() == -1)
+			{
+				failed = true;
+				return;
+			}
+			while (converter.hasNext()) {
+				if (converter.convertAndStore() == -1)
+				{
+					failed = true;
+					return;
+				}
+			}
+		}
+	};
+
+	size_t thread_count = std::min<size_t>(std::max<size_t>(files.size(), 1),
+		std::max(1u, std::thread::hardware_concurrency()));
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < thread_count; ++i)
+	{
+		threads.emplace_back(worker);
+	}
+	worker();
+	for (auto thread = threads.begin(); thread != threads.end(); ++thread)
+	{
+		thread->join();
+	}
+
+	if (failed)
+	{
+		return -1;
+	}
+
+	csv_file = std::fopen(target.data(), "w+");
+	if (csv_file == nullptr)
+	{
+		return -1;
+	}
+
+	total_item = parts.size();
+
+	return 0;
+}
+
+int DatasetStorageConverter::convertAndStore()
+{
+	if (!hasNext())
+		return -1;
+
+	std::FILE *part = std::fopen(parts[current_item].data(), "rb");
+	if (part == nullptr)
+		return -1;
+
+	std::vector<char> buffer(kCOPY_BUFFER_SIZE);
+	size_t read_size;
+	while ((read_size = std::fread(buffer.data(), 1, buffer.size(), part)) > 0)
+	{
+		std::fwrite(buffer.data(), 1, read_size, csv_file);
+	}
+	std::fclose(part);
+	std::remove(parts[current_item].data());
+
+	++current_item;
+
+	return 0;
+}
+
+int DatasetStorageConverter::storeHeaders()
+{
+	FormatSpecifier& specifier = FormatSpecifier::instance();
+	std::vector<char> record(item_length, 0);
+	auto member_infos = catalog.parsers().expr(record.data());
+
+	for (size_t i = 0; i < member_infos.size(); ++i)
+	{
+		std::fprintf(csv_file, "%s", member_infos[i].first.data());
+		if (i != member_infos.size() - 1)
+		{
+			std::fprintf(csv_file, "%s", specifier.get_delimiter());
+		}
+	}
+	for (auto field = derived.begin(); field != derived.end(); ++field)
+	{
+		std::fprintf(csv_file, "%s%s", specifier.get_delimiter(), field->name.data());
+	}
+	std::fprintf(csv_file, "\n");
+
+	return 0;
+}
@@ -0,0 +1,307 @@
+#include "DecimateConverter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+using namespace StorageNS;
+
+DecimateStorageConverter::~DecimateStorageConverter()
+{
+	if (csv_file != nullptr)
+		std::fclose(csv_file);
+}
+
+void DecimateStorageConverter::setMethod(Method method)
+{
+	this->method = method;
+}
+
+void DecimateStorageConverter::setTargetCount(size_t count)
+{
+	target_count = count;
+}
+
+void DecimateStorageConverter::setFields(const std::vector<std::string> &fields)
+{
+	field_names = fields;
+}
+
+void DecimateStorageConverter::setXField(const std::string &field)
+{
+	x_name = field;
+}
+
+int DecimateStorageConverter::prepare()
+{
+	std::string content = StorageNS::getTextFileContent(template_.data());
+	configurator = std::unique_ptr<JsonConfigurator>(new JsonConfigurator(content));
+
+	if (!configurator->isValid()){
+		return -1;
+	}
+
+	// Points are selected from whole series of source fields, so range,
+	// filter and derived fields do not apply.
+	if (has_range || !filter.empty() || !derivation.empty())
+	{
+		return -1;
+	}
+
+	parsers = configurator->generateParser();
+	item_length = parsers.length();
+	if (item_length == 0 || target_count == 0)
+	{
+		return -1;
+	}
+
+	has_x_field = !x_name.empty();
+	if (has_x_field && (!parsers.findField(x_name, x_field) || !x_field.isNumeric()))
+	{
+		return -1;
+	}
+
+	fields.clear();
+	if (field_names.empty())
+	{
+		auto members = parsers.fields();
+		for (auto member = members.begin(); member != members.end(); ++member)
+		{
+			if ((!has_x_field || member->name != x_name) && member->isNumeric())
+				fields.push_back(*member);
+		}
+	}
+	else
+	{
+		FieldInfo field;
+		for (auto name = field_names.begin(); name != field_names.end(); ++name)
+		{
+			if (!parsers.findField(*name, field) || !field.isNumeric())
+			{
+				return -1;
+			}
+			fields.push_back(field);
+		}
+	}
+
+	if (!source_file.open(source))
+	{
+		return -1;
+	}
+
+	csv_file = std::fopen(target.data(), "w+");
+	if (csv_file == nullptr)
+	{
+		return -1;
+	}
+
+	record_count = source_file.size() / item_length;
+
+	// Every worker takes next unselected field until all fields are selected.
+	std::vector<std::vector<size_t>> selections(fields.size());
+	std::atomic<size_t> next_field(0);
+	auto worker = [&]() {
+		for (size_t i = next_field++; i < fields.size(); i = next_field++)
+		{
+			selections[i] = select(fields[i]);
+		}
+	};
+
+	size_t thread_count = std::min<size_t>(fields.size(), std::max(1u, std::thread::hardware_concurrency()));
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < thread_count; ++i)
+	{
+		threads.emplace_back(worker);
+	}
+	worker();
+	for (auto thread = threads.begin(); thread != threads.end(); ++thread)
+	{
+		thread->join();
+	}
+
+	selected.clear();
+	for (auto selection = selections.begin(); selection != selections.end(); ++selection)
+	{
+		selected.insert(selected.end(), selection->begin(), selection->end());
+	}
+	std::sort(selected.begin(), selected.end());
+	selected.erase(std::unique(selected.begin(), selected.end()), selected.end());
+
+	total_item = selected.size();
+	current_item = 0;
+
+	return 0;
+}
+
+double DecimateStorageConverter::xOf(size_t item)
+{
+	if (has_x_field)
+		return x_field.value(source_file.data() + item * item_length);
+
+	return static_cast<double>(item);
+}
+
+double DecimateStorageConverter::yOf(const FieldInfo &field, size_t item)
+{
+	return field.value(source_file.data() + item * item_length);
+}
+
+std::vector<size_t> DecimateStorageConverter::select(const FieldInfo &field)
+{
+	if (record_count <= target_count)
+	{
+		std::vector<size_t> all(record_count);
+		for (size_t i = 0; i < record_count; ++i)
+			all[i] = i;
+		return all;
+	}
+
+	if (method == Method::MIN_MAX)
+		return selectMinMax(field);
+
+	return selectLTTB(field);
+}
+
+std::vector<size_t> DecimateStorageConverter::selectMinMax(const FieldInfo &field)
+{
+	std::vector<size_t> selection;
+	size_t bucket_count = std::max<size_t>(1, target_count / 2);
+
+	for (size_t bucket = 0; bucket < bucket_count; ++bucket)
+	{
+		size_t begin = record_count * bucket / bucket_count;
+		size_t end = record_count * (bucket + 1) / bucket_count;
+		if (begin == end)
+			continue;
+
+		size_t min_item = begin, max_item = begin;
+		double min_value = yOf(field, begin), max_value = min_value;
+
+		for (size_t item = begin + 1; item < end; ++item)
+		{
+			double value = yOf(field, item);
+			if (value < min_value) {
+				min_value = value;
+				min_item = item;
+			}
+			if (value > max_value) {
+				max_value = value;
+				max_item = item;
+			}
+		}
+
+		selection.push_back(std::min(min_item, max_item));
+		if (min_item != max_item)
+			selection.push_back(std::max(min_item, max_item));
+	}
+
+	return selection;
+}
+
+std::vector<size_t> DecimateStorageConverter::selectLTTB(const FieldInfo &field)
+{
+	std::vector<size_t> selection;
+
+	if (target_count < 3)
+	{
+		selection.push_back(0);
+		if (target_count == 2)
+			selection.push_back(record_count - 1);
+		return selection;
+	}
+
+	// First and last record are always kept, the others are divided into
+	// buckets with one record picked from each.
+	size_t bucket_count = target_count - 2;
+	size_t inner_count = record_count - 2;
+	auto bucketBegin = [&](size_t bucket) {
+		return 1 + inner_count * bucket / bucket_count;
+	};
+
+	// First pass computes the average point of every bucket.
+	std::vector<std::pair<double, double>> averages(bucket_count);
+	for (size_t bucket = 0; bucket < bucket_count; ++bucket)
+	{
+		size_t begin = bucketBegin(bucket), end = bucketBegin(bucket + 1);
+		double sum_x = 0, sum_y = 0;
+
+		for (size_t item = begin; item < end; ++item)
+		{
+			sum_x += xOf(item);
+			sum_y += yOf(field, item);
+		}
+		averages[bucket].first = sum_x / (end - begin);
+		averages[bucket].second = sum_y / (end - begin);
+	}
+
+	// Second pass picks the record forming the largest triangle with previous
+	// picked record and average point of next bucket.
+	size_t picked = 0;
+	selection.push_back(picked);
+	for (size_t bucket = 0; bucket < bucket_count; ++bucket)
+	{
+		double a_x = xOf(picked), a_y = yOf(field, picked);
+		double c_x, c_y;
+		if (bucket + 1 < bucket_count) {
+			c_x = averages[bucket + 1].first;
+			c_y = averages[bucket + 1].second;
+		}
+		else {
+			c_x = xOf(record_count - 1);
+			c_y = yOf(field, record_count - 1);
+		}
+
+		size_t begin = bucketBegin(bucket), end = bucketBegin(bucket + 1);
+		double max_area = -1;
+
+		for (size_t item = begin; item < end; ++item)
+		{
+			double area = std::fabs((a_x - c_x) * (yOf(field, item) - a_y)
+				- (a_x - xOf(item)) * (c_y - a_y));
+			if (area > max_area) {
+				max_area = area;
+				picked = item;
+			}
+		}
+		selection.push_back(picked);
+	}
+	selection.push_back(record_count - 1);
+
+	return selection;
+}
+
+int DecimateStorageConverter::convertAndStore()
+{
+	if (!hasNext())
+		return -1;
+
+	const char *record = source_file.data() + selected[current_item] * item_length;
+
+	parsers.fprintf(csv_file, record);
+	std::fprintf(csv_file, "\n");
+
+	++current_item;
+
+	return 0;
+}
+
+int DecimateStorageConverter::storeHeaders()
+{
+	// Names are taken from schema, so an empty file still gets its headers.
+	FormatSpecifier& specifier = FormatSpecifier::instance();
+	std::vector<char> record(item_length, 0);
+	auto member_infos = parsers.expr(record.data());
+
+	for (size_t i = 0; i < member_infos.size(); ++i)
+	{
+		std::fprintf(csv_file, "%s", member_infos[i].first.data());
+		if (i != member_infos.size() - 1)
+		{
+			std::fprintf(csv_file, "%s", specifier.get_delimiter());
+		}
+	}
+	std::fprintf(csv_file, "\n");
+
+	return 0;
+}
@@ -0,0 +1,245 @@
+#include "JoinConverter.h"
+
+using namespace StorageNS;
+
+namespace {
+	// Quotients of a positive divisor, rounded down or up, without overflow.
+	inline int64_t floorDiv(int64_t value, int64_t divisor)
+	{
+		int64_t quotient = value / divisor;
+		return (value % divisor != 0 && value < 0) ? quotient - 1 : quotient;
+	}
+
+	inline int64_t ceilDiv(int64_t value, int64_t divisor)
+	{
+		int64_t quotient = value / divisor;
+		return (value % divisor != 0 && value > 0) ? quotient + 1 : quotient;
+	}
+}
+
+JoinStorageConverter::~JoinStorageConverter()
+{
+	if (csv_file != nullptr)
+		std::fclose(csv_file);
+}
+
+void JoinStorageConverter::setRightSource(const std::string &source_file)
+{
+	right_source = source_file;
+}
+
+void JoinStorageConverter::setRightTemplate(const std::string &template_file)
+{
+	right_template = template_file;
+}
+
+void JoinStorageConverter::setTimestampFields(const std::string &left_field, const std::string &right_field)
+{
+	timestamp_name = left_field;
+	right_timestamp_name = right_field;
+}
+
+void JoinStorageConverter::setRightPrefix(const std::string &prefix)
+{
+	right_prefix = prefix;
+}
+
+void JoinStorageConverter::setJson(bool json)
+{
+	this->json = json;
+}
+
+int JoinStorageConverter::prepare()
+{
+	std::string content = StorageNS::getTextFileContent(template_.data());
+	configurator = std::unique_ptr<JsonConfigurator>(new JsonConfigurator(content));
+
+	content = StorageNS::getTextFileContent(right_template.data());
+	right_configurator = std::unique_ptr<JsonConfigurator>(new JsonConfigurator(content));
+
+	if (!configurator->isValid() || !right_configurator->isValid()){
+		return -1;
+	}
+
+	// Records are merged in order of both files, range, filter and derived
+	// fields do not apply.
+	if (has_range || !filter.empty() || !derivation.empty())
+	{
+		return -1;
+	}
+
+	parsers = configurator->generateParser();
+	right_parsers = right_configurator->generateParser();
+	item_length = parsers.length();
+	right_length = right_parsers.length();
+	if (item_length == 0 || right_length == 0)
+	{
+		return -1;
+	}
+
+	if (!parsers.findField(timestamp_name, timestamp) || !timestamp.isNumeric()
+		|| !right_parsers.findField(right_timestamp_name, right_timestamp) || !right_timestamp.isNumeric())
+	{
+		return -1;
+	}
+
+	// Timestamps of different units, e.g. "ns" and "ms", are compared in the
+	// finer one. A timestamp is not comparable to a number of unknown unit.
+	if ((timestamp.ticks == 0) != (right_timestamp.ticks == 0))
+	{
+		return -1;
+	}
+	left_scale = 1;
+	right_scale = 1;
+	if (timestamp.ticks < right_timestamp.ticks)
+		left_scale = right_timestamp.ticks / timestamp.ticks;
+	else if (right_timestamp.ticks < timestamp.ticks)
+		right_scale = timestamp.ticks / right_timestamp.ticks;
+
+	if (!source_file.open(source) || !right_file.open(right_source))
+	{
+		return -1;
+	}
+
+	csv_file = std::fopen(target.data(), "w+");
+	if (csv_file == nullptr)
+	{
+		return -1;
+	}
+
+	total_item = source_file.size() / item_length;
+	right_total = right_file.size() / right_length;
+	right_item = 0;
+	std::vector<char> right_record(right_length, 0);
+	right_columns = right_parsers.expr(right_record.data()).size();
+	fields = parsers.fields();
+	right_fields = right_parsers.fields();
+
+	return 0;
+}
+
+bool JoinStorageConverter::notAfter(const char *right_record, const char *left_record)
+{
+	if (timestamp.isIntegral() && right_timestamp.isIntegral())
+	{
+		int64_t left = timestamp.integer(left_record);
+		int64_t right = right_timestamp.integer(right_record);
+
+		// right * right_scale <= left * left_scale, where either scale is 1.
+		if (right_scale != 1)
+			return right <= floorDiv(left, right_scale);
+		if (left_scale != 1)
+			return ceilDiv(right, left_scale) <= left;
+		return right <= left;
+	}
+
+	return right_timestamp.value(right_record) <= timestamp.value(left_record);
+}
+
+int JoinStorageConverter::convertAndStore()
+{
+	if (!hasNext())
+		return -1;
+
+	const char *record = source_file.data() + current_item * item_length;
+	const char *right_base = right_file.data();
+
+	// right_item is the count of right records at or before current left record,
+	// so the latest matched one is right_item - 1.
+	while (right_item < right_total && notAfter(right_base + right_item * right_length, record))
+	{
+		++right_item;
+	}
+
+	if (json)
+	{
+		storeJson(record, right_item > 0 ? right_base + (right_item - 1) * right_length : nullptr);
+		++current_item;
+		return 0;
+	}
+
+	FormatSpecifier &specifier = FormatSpecifier::instance();
+
+	parsers.fprintf(csv_file, record);
+	std::fprintf(csv_file, "%s", specifier.get_delimiter());
+	if (right_item > 0)
+	{
+		right_parsers.fprintf(csv_file, right_base + (right_item - 1) * right_length);
+	}
+	else
+	{
+		for (size_t i = 1; i < right_columns; ++i)
+		{
+			std::fprintf(csv_file, "%s", specifier.get_delimiter());
+		}
+	}
+	std::fprintf(csv_file, "\n");
+
+	++current_item;
+
+	return 0;
+}
+
+void JoinStorageConverter::storeJson(const char *record, const char *right_record)
+{
+	// Every object takes one line, and is preceded by a comma except the first one.
+	std::string output = current_item == 0 ? "\n{" : ",\n{";
+
+	for (size_t i = 0; i < fields.size(); ++i)
+	{
+		if (i != 0)
+			output += ", ";
+		appendJsonString(output, fields[i].name.data(), fields[i].name.size());
+		output += ": ";
+		fields[i].appendJson(output, record);
+	}
+	for (size_t i = 0; i < right_fields.size(); ++i)
+	{
+		std::string name = right_prefix + right_fields[i].name;
+
+		output += ", ";
+		appendJsonString(output, name.data(), name.size());
+		output += ": ";
+		if (right_record != nullptr)
+			right_fields[i].appendJson(output, right_record);
+		else
+			output += "null";
+	}
+	output += "}";
+	if (current_item + 1 == total_item)
+		output += "\n]\n";
+
+	std::fwrite(output.data(), 1, output.size(), csv_file);
+}
+
+int JoinStorageConverter::storeHeaders()
+{
+	if (json)
+	{
+		std::fputs(total_item == 0 ? "[\n]\n" : "[", csv_file);
+		return 0;
+	}
+
+	// Names are taken from schemas, so either file may be empty.
+	FormatSpecifier& specifier = FormatSpecifier::instance();
+	std::vector<char> record(item_length, 0);
+	std::vector<char> right_record(right_length, 0);
+	auto member_infos = parsers.expr(record.data());
+	auto right_member_infos = right_parsers.expr(right_record.data());
+
+	for (size_t i = 0; i < member_infos.size(); ++i)
+	{
+		std::fprintf(csv_file, "%s%s", member_infos[i].first.data(), specifier.get_delimiter());
+	}
+	for (size_t i = 0; i < right_member_infos.size(); ++i)
+	{
+		std::fprintf(csv_file, "%s%s", right_prefix.data(), right_member_infos[i].first.data());
+		if (i != right_member_infos.size() - 1)
+		{
+			std::fprintf(csv_file, "%s", specifier.get_delimiter());
+		}
+	}
+	std::fprintf(csv_file, "\n");
+
+	return 0;
+}
@@ -0,0 +1,132 @@
+#include "LookupConverter.h"
+#include "StorageBTree.h"
+
+#include <limits>
+
+using namespace StorageNS;
+
+LookupStorageConverter::~LookupStorageConverter()
+{
+	if (csv_file != nullptr)
+		std::fclose(csv_file);
+}
+
+void LookupStorageConverter::setBTree(const std::string &btree_file)
+{
+	btree_path = btree_file;
+}
+
+void LookupStorageConverter::setLimit(size_t limit)
+{
+	this->limit = limit;
+}
+
+int LookupStorageConverter::prepare()
+{
+	std::string content = StorageNS::getTextFileContent(template_.data());
+	configurator = std::unique_ptr<JsonConfigurator>(new JsonConfigurator(content));
+
+	if (!configurator->isValid()){
+		return -1;
+	}
+
+	parsers = configurator->generateParser();
+	item_length = parsers.length();
+	if (item_length == 0 || !has_range)
+	{
+		return -1;
+	}
+
+	derived.clear();
+	if (parseDerivedFields(configurator->derivedFields() + derivation, parsers, derived) == -1)
+	{
+		return -1;
+	}
+
+	if (!source_file.open(source))
+	{
+		return -1;
+	}
+
+	current_item = 0;
+	total_item = source_file.size() / item_length;
+	if (locateRecords(parsers) == -1)
+	{
+		return -1;
+	}
+
+	BTreeIndex index;
+	std::string path = btree_path.empty() ? BTreeWriter::sidecarPath(source, range_name) : btree_path;
+	if (index.open(path, range_field, item_length) == -1)
+	{
+		return -1;
+	}
+
+	// Filtered records are dropped after lookup, so limit is applied then.
+	size_t lookup_limit = (limit == 0 || !predicates.empty()) ? std::numeric_limits<size_t>::max() : limit;
+	size_t record_count = source_file.size() / item_length;
+
+	results.clear();
+	std::vector<uint64_t> items = index.lookup(range_begin_key, range_end_key, lookup_limit);
+	for (auto item = items.begin(); item != items.end() && (limit == 0 || results.size() < limit); ++item)
+	{
+		if (*item < record_count && accepts(source_file.data() + *item * item_length))
+		{
+			results.push_back(*item);
+		}
+	}
+
+	csv_file = std::fopen(target.data(), "w+");
+	if (csv_file == nullptr)
+	{
+		return -1;
+	}
+
+	total_item = results.size();
+	current_item = 0;
+
+	return 0;
+}
+
+int LookupStorageConverter::convertAndStore()
+{
+	if (!hasNext())
+		return -1;
+
+	const char *record = source_file.data() + results[current_item] * item_length;
+	parsers.fprintf(csv_file, record);
+	for (auto field = derived.begin(); field != derived.end(); ++field)
+	{
+		std::fprintf(csv_file, "%s", FormatSpecifier::instance().get_delimiter());
+		field->fprintf(csv_file, field->expression.evaluate(record, stack));
+	}
+	std::fprintf(csv_file, "\n");
+
+	++current_item;
+
+	return 0;
+}
+
+int LookupStorageConverter::storeHeaders()
+{
+	// Names are taken from schema, so an empty file still gets its headers.
+	FormatSpecifier& specifier = FormatSpecifier::instance();
+	std::vector<char> record(item_length, 0);
+	auto member_infos = parsers.expr(record.data());
+
+	for (size_t i = 0; i < member_infos.size(); ++i)
+	{
+		std::fprintf(csv_file, "%s", member_infos[i].first.data());
+		if (i != member_infos.size() - 1)
+		{
+			std::fprintf(csv_file, "%s", specifier.get_delimiter());
+		}
+	}
+	for (auto field = derived.begin(); field != derived.end(); ++field)
+	{
+		std::fprintf(csv_file, "%s%s", specifier.get_delimiter(), field->name.data());
+	}
+	std::fprintf(csv_file, "\n");
+
+	return 0;
+}
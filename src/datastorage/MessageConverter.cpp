@@ -0,0 +1,126 @@
+#include "MessageConverter.h"
+
+using namespace StorageNS;
+
+MessageStorageConverter::~MessageStorageConverter()
+{
+	for (size_t i = 0; i < csv_files.size(); ++i)
+	{
+		if (csv_files[i] != nullptr)
+			std::fclose(csv_files[i]);
+	}
+}
+
+int MessageStorageConverter::prepare()
+{
+	std::string content = StorageNS::getTextFileContent(template_.data());
+	configurator = std::unique_ptr<JsonConfigurator>(new JsonConfigurator(content));
+
+	if (!configurator->isValid() || !configurator->hasMessages()){
+		return -1;
+	}
+
+	if (has_range || !filter.empty() || !derivation.empty())
+	{
+		return -1;
+	}
+
+	if (configurator->generateMessages(dispatcher) == -1)
+	{
+		return -1;
+	}
+
+	if (!source_file.open(source))
+	{
+		return -1;
+	}
+
+	indexRecords();
+	csv_files.assign(dispatcher.messageCount(), nullptr);
+
+	current_item = 0;
+	total_item = offsets.size();
+
+	return 0;
+}
+
+void MessageStorageConverter::indexRecords()
+{
+	const char *data = source_file.data();
+	size_t size = source_file.size();
+	size_t offset = 0;
+
+	offsets.clear();
+	types.clear();
+	while (offset < size)
+	{
+		size_t length = dispatcher.lengthAt(data + offset, size - offset);
+		if (length == 0)
+			break;
+
+		offsets.push_back(offset);
+		types.push_back(dispatcher.find(data + offset));
+		offset += length;
+	}
+	indexed_size = offset;
+}
+
+std::string MessageStorageConverter::targetOf(const std::string &message) const
+{
+	std::string stem = target;
+	size_t dot = stem.find_last_of('.');
+
+	if (dot != std::string::npos && stem.find_first_of("/\\", dot) == std::string::npos)
+		stem.erase(dot);
+
+	return stem + "." + message + ".csv";
+}
+
+std::FILE *MessageStorageConverter::openTarget(size_t message, const char *record)
+{
+	FormatSpecifier& specifier = FormatSpecifier::instance();
+	MessageDispatcher::Message &type = dispatcher.message(message);
+
+	std::FILE *csv_file = std::fopen(targetOf(type.name).data(), "w+");
+	if (csv_file == nullptr)
+		return nullptr;
+
+	auto member_infos = type.parsers.expr(record);
+	for (size_t i = 0; i < member_infos.size(); ++i)
+	{
+		std::fprintf(csv_file, "%s", member_infos[i].first.data());
+		if (i != member_infos.size() - 1)
+		{
+			std::fprintf(csv_file, "%s", specifier.get_delimiter());
+		}
+	}
+	std::fprintf(csv_file, "\n");
+	csv_files[message] = csv_file;
+
+	return csv_file;
+}
+
+int MessageStorageConverter::convertAndStore()
+{
+	if (!hasNext())
+		return -1;
+
+	const char *record = source_file.data() + offsets[current_item];
+	size_t message = static_cast<size_t>(types[current_item]);
+
+	std::FILE *csv_file = csv_files[message];
+	if (csv_file == nullptr && (csv_file = openTarget(message, record)) == nullptr)
+		return -1;
+
+	dispatcher.message(message).parsers.fprintf(csv_file, record);
+	std::fprintf(csv_file, "\n");
+
+	++current_item;
+
+	return 0;
+}
+
+int MessageStorageConverter::storeHeaders()
+{
+	return 0;
+}
@@ -0,0 +1,635 @@
+#include "QueryDaemon.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#ifndef WIN32
+#include <sys/stat.h>
+#endif
+
+using namespace StorageNS;
+
+namespace {
+	const size_t kRECEIVE_BUFFER_SIZE = 4096;
+
+	// Longest accepted request line.
+	const size_t kMAX_REQUEST_SIZE = 64 * 1024;
+
+	// Interval of checking stop() while waiting for clients.
+	const long kACCEPT_TIMEOUT_US = 200 * 1000;
+
+	// Count of tables kept open for following queries.
+	const size_t kMAX_OPEN_TABLES = 64;
+
+	bool sendAll(socket_t s, const char *data, size_t size)
+	{
+		while (size > 0)
+		{
+			int sent = send(s, data, static_cast<int>(std::min<size_t>(size, 1 << 30)), MSG_NOSIGNAL);
+			if (sent <= 0)
+				return false;
+			data += sent;
+			size -= sent;
+		}
+
+		return true;
+	}
+
+	bool sendError(socket_t s, const std::string &message)
+	{
+		std::string response = "ERROR " + message + "\n";
+		return sendAll(s, response.data(), response.size());
+	}
+
+	/**
+	* Remove an existing Unix domain socket file, but no other kind of file.
+	*/
+	void removeSocketFile(const std::string &socket_path)
+	{
+#ifdef WIN32
+		// Unix domain sockets are reparse points on Windows.
+		DWORD attributes = GetFileAttributesA(socket_path.data());
+		if (attributes == INVALID_FILE_ATTRIBUTES || !(attributes & FILE_ATTRIBUTE_REPARSE_POINT))
+			return;
+#else
+		struct stat status;
+		if (lstat(socket_path.data(), &status) != 0 || !S_ISSOCK(status.st_mode))
+			return;
+#endif
+		std::remove(socket_path.data());
+	}
+
+	/**
+	* Check if one more socket can be waited by select().
+	*/
+	bool selectable(socket_t s, size_t count)
+	{
+#ifdef WIN32
+		(void)s;
+		return count < FD_SETSIZE;
+#else
+		(void)count;
+		return s < FD_SETSIZE;
+#endif
+	}
+
+	bool socketAddress(const std::string &socket_path, sockaddr_un &addr)
+	{
+		std::memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		if (socket_path.size() >= sizeof(addr.sun_path))
+			return false;
+		std::memcpy(addr.sun_path, socket_path.data(), socket_path.size());
+
+		return true;
+	}
+
+	/**
+	* Result is streamed to client in chunks while formatting, after "OK".
+	*/
+	class SocketQuerySink: public QuerySink {
+	public:
+		SocketQuerySink(socket_t s): s(s), started(false) {}
+
+		bool write(const char *data, size_t size) override
+		{
+			if (size == 0)
+				return true;
+
+			char header[32];
+			int length = std::snprintf(header, sizeof(header), "%s%zx\n", started ? "" : "OK\n", size);
+			started = true;
+
+			return sendAll(s, header, static_cast<size_t>(length)) && sendAll(s, data, size);
+		}
+
+		/**
+		* @brief  End response with a chunk of size 0.
+		*/
+		bool finish()
+		{
+			const char *end = started ? "0\n" : "OK\n0\n";
+			started = true;
+
+			return sendAll(s, end, std::strlen(end));
+		}
+
+		bool hasStarted() const
+		{
+			return started;
+		}
+
+	private:
+		socket_t s;
+		bool started;
+	};
+
+	/**
+	* Size of a file, or -1 if it cannot be opened.
+	*/
+	long long fileSize(const std::string &path)
+	{
+		std::ifstream stream(path, std::ios::binary | std::ios::ate);
+		if (!stream.is_open())
+			return -1;
+
+		return static_cast<long long>(stream.tellg());
+	}
+}
+
+QueryDaemon::~QueryDaemon()
+{
+	stop();
+}
+
+void QueryDaemon::setSocketPath(const std::string &socket_path)
+{
+	this->socket_path = socket_path;
+}
+
+void QueryDaemon::setThreadCount(size_t thread_count)
+{
+	this->thread_count = thread_count;
+}
+
+void QueryDaemon::setTemplate(const std::string &template_file)
+{
+	template_ = template_file;
+}
+
+int QueryDaemon::serve()
+{
+	sockaddr_un addr;
+	if (!socketAddress(socket_path, addr))
+	{
+		return -1;
+	}
+
+	socket_init();
+	listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listener == INVALID_SOCKET)
+	{
+		socket_destroy();
+		return -1;
+	}
+
+	removeSocketFile(socket_path);
+	if (bind(listener, (struct sockaddr *)&addr, sizeof(addr)) == SOCKET_ERROR
+		|| listen(listener, SOMAXCONN) == SOCKET_ERROR)
+	{
+		closesocket(listener);
+		listener = INVALID_SOCKET;
+		socket_destroy();
+		return -1;
+	}
+
+	wake_sender = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (wake_sender == INVALID_SOCKET
+		|| ::connect(wake_sender, (struct sockaddr *)&addr, sizeof(addr)) == SOCKET_ERROR
+		|| (wake_receiver = ::accept(listener, NULL, NULL)) == INVALID_SOCKET)
+	{
+		closeSockets();
+		return -1;
+	}
+
+	running = true;
+
+	size_t workers = thread_count != 0 ? thread_count : std::max(1u, std::thread::hardware_concurrency());
+	std::vector<std::thread> threads;
+	for (size_t i = 0; i < workers; ++i)
+	{
+		threads.emplace_back(&QueryDaemon::work, this);
+	}
+
+	// Clients waiting for their next requests, owned by this thread.
+	std::vector<std::unique_ptr<Connection>> idle;
+	while (running)
+	{
+		fd_set readable;
+		FD_ZERO(&readable);
+		FD_SET(listener, &readable);
+		FD_SET(wake_receiver, &readable);
+		socket_t max_socket = std::max(listener, wake_receiver);
+		for (auto connection = idle.begin(); connection != idle.end(); ++connection)
+		{
+			FD_SET((*connection)->socket, &readable);
+			max_socket = std::max(max_socket, (*connection)->socket);
+		}
+		timeval timeout = { 0, kACCEPT_TIMEOUT_US };
+
+		if (select(static_cast<int>(max_socket) + 1, &readable, NULL, NULL, &timeout) <= 0)
+			continue;
+
+		if (FD_ISSET(wake_receiver, &readable))
+		{
+			char buffer[kRECEIVE_BUFFER_SIZE];
+			recv(wake_receiver, buffer, sizeof(buffer), 0);
+		}
+
+		std::vector<std::unique_ptr<Connection>> requested;
+		for (auto connection = idle.begin(); connection != idle.end();)
+		{
+			if (FD_ISSET((*connection)->socket, &readable))
+			{
+				requested.push_back(std::move(*connection));
+				connection = idle.erase(connection);
+			}
+			else
+			{
+				++connection;
+			}
+		}
+
+		if (FD_ISSET(listener, &readable))
+		{
+			socket_t client = ::accept(listener, NULL, NULL);
+			if (client != INVALID_SOCKET && !selectable(client, connection_count + 2))
+			{
+				sendError(client, "too many connections");
+				closesocket(client);
+			}
+			else if (client != INVALID_SOCKET)
+			{
+				std::unique_ptr<Connection> connection(new Connection());
+				connection->socket = client;
+				idle.push_back(std::move(connection));
+				++connection_count;
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(client_mutex);
+		for (auto connection = requested.begin(); connection != requested.end(); ++connection)
+		{
+			ready.push_back(std::move(*connection));
+		}
+		for (auto connection = returned.begin(); connection != returned.end(); ++connection)
+		{
+			idle.push_back(std::move(*connection));
+		}
+		returned.clear();
+		if (!requested.empty())
+			client_ready.notify_all();
+	}
+
+	client_ready.notify_all();
+	for (auto thread = threads.begin(); thread != threads.end(); ++thread)
+	{
+		thread->join();
+	}
+
+	for (auto connection = idle.begin(); connection != idle.end(); ++connection)
+	{
+		closesocket((*connection)->socket);
+	}
+	for (auto connection = ready.begin(); connection != ready.end(); ++connection)
+	{
+		closesocket((*connection)->socket);
+	}
+	for (auto connection = returned.begin(); connection != returned.end(); ++connection)
+	{
+		closesocket((*connection)->socket);
+	}
+	ready.clear();
+	returned.clear();
+	connection_count = 0;
+
+	closeSockets();
+
+	return 0;
+}
+
+void QueryDaemon::closeSockets()
+{
+	if (wake_sender != INVALID_SOCKET)
+		closesocket(wake_sender);
+	if (wake_receiver != INVALID_SOCKET)
+		closesocket(wake_receiver);
+	wake_sender = INVALID_SOCKET;
+	wake_receiver = INVALID_SOCKET;
+
+	closesocket(listener);
+	listener = INVALID_SOCKET;
+	removeSocketFile(socket_path);
+	socket_destroy();
+}
+
+void QueryDaemon::stop()
+{
+	running = false;
+	client_ready.notify_all();
+}
+
+void QueryDaemon::work()
+{
+	while (true)
+	{
+		std::unique_ptr<Connection> connection;
+		{
+			std::unique_lock<std::mutex> lock(client_mutex);
+			client_ready.wait(lock, [this]() { return !running || !ready.empty(); });
+			if (!running)
+				return;
+			connection = std::move(ready.front());
+			ready.pop_front();
+		}
+
+		if (!serveConnection(*connection))
+		{
+			closesocket(connection->socket);
+			--connection_count;
+			continue;
+		}
+
+		// A client with more requests received is queued behind others, or
+		// else waits for its next request in the accepting thread.
+		bool requested = connection->pending.find('\n') != std::string::npos;
+		{
+			std::lock_guard<std::mutex> lock(client_mutex);
+			if (requested)
+				ready.push_back(std::move(connection));
+			else
+				returned.push_back(std::move(connection));
+		}
+		if (requested)
+			client_ready.notify_one();
+		else
+			sendAll(wake_sender, "w", 1);
+	}
+}
+
+bool QueryDaemon::serveConnection(Connection &connection)
+{
+	// Receiving is skipped if a request has been received, as the client may
+	// send nothing more.
+	if (connection.pending.find('\n') == std::string::npos)
+	{
+		char buffer[kRECEIVE_BUFFER_SIZE];
+		int received = recv(connection.socket, buffer, sizeof(buffer), 0);
+		if (received <= 0)
+			return false;
+		connection.pending.append(buffer, received);
+	}
+
+	size_t line_end = connection.pending.find('\n');
+	if (line_end == std::string::npos)
+	{
+		if (connection.pending.size() > kMAX_REQUEST_SIZE)
+		{
+			sendError(connection.socket, "request is too long");
+			return false;
+		}
+		return true;
+	}
+
+	std::string request = connection.pending.substr(0, line_end);
+	connection.pending.erase(0, line_end + 1);
+	if (!request.empty() && request.back() == '\r')
+		request.pop_back();
+
+	return serveRequest(connection.socket, request);
+}
+
+bool QueryDaemon::serveRequest(socket_t client, const std::string &request)
+{
+	std::map<std::string, std::string> options;
+	std::istringstream stream(request);
+	std::string option;
+
+	while (std::getline(stream, option, '\t'))
+	{
+		size_t equal = option.find('=');
+		if (equal == std::string::npos)
+			return sendError(client, "invalid option " + option);
+		options[option.substr(0, equal)] = option.substr(equal + 1);
+	}
+
+	auto value = [&options](const std::string &name, const std::string &default_value) {
+		auto found = options.find(name);
+		return found == options.end() ? default_value : found->second;
+	};
+
+	std::string source = value("source", "");
+	if (source.empty())
+		return sendError(client, "source is missing");
+
+	std::shared_ptr<QueryTable> opened = table(source, value("schema", template_));
+	if (!opened)
+		return sendError(client, "cannot open " + source);
+
+	StorageQuery query;
+	std::vector<std::string> select;
+	std::istringstream select_stream(value("select", ""));
+	std::string name;
+	while (std::getline(select_stream, name, ','))
+	{
+		if (!name.empty())
+			select.push_back(name);
+	}
+
+	query.setSelect(select);
+	query.setFilter(value("where", ""));
+	query.setDerivedFields(value("derive", ""));
+	try {
+		query.setLimit(std::stoul(value("limit", "0")));
+	}
+	catch (const std::exception &) {
+		return sendError(client, "invalid limit");
+	}
+	query.setFormat(value("format", "csv") == "json" ? StorageQuery::Format::JSON : StorageQuery::Format::CSV);
+
+	// Fields and filter are checked before any output, so a failure after
+	// output has started means the client has gone.
+	SocketQuerySink sink(client);
+	if (query.run(*opened, sink) == -1)
+		return !sink.hasStarted() && sendError(client, "invalid query");
+
+	return sink.finish();
+}
+
+std::shared_ptr<QueryTable> QueryDaemon::table(const std::string &source_file, const std::string &template_file)
+{
+	long long size = fileSize(source_file);
+	auto key = std::make_pair(source_file, template_file);
+
+	{
+		std::lock_guard<std::mutex> lock(table_mutex);
+		auto cached = tables.find(key);
+		if (cached != tables.end() && static_cast<long long>(cached->second.table->source_file.size()) == size)
+		{
+			cached->second.used = ++table_clock;
+			return cached->second.table;
+		}
+	}
+
+	// Opened outside of lock, tables in use by other queries are kept alive by
+	// their shared pointers after being replaced.
+	std::shared_ptr<QueryTable> opened = std::make_shared<QueryTable>();
+	if (size <= 0 || opened->open(source_file, template_file) == -1)
+		return std::shared_ptr<QueryTable>();
+
+	std::lock_guard<std::mutex> lock(table_mutex);
+	CachedTable &cached = tables[key];
+	cached.table = opened;
+	cached.used = ++table_clock;
+
+	// Tables in use by other queries are closed when they are done.
+	while (tables.size() > kMAX_OPEN_TABLES)
+	{
+		auto oldest = tables.begin();
+		for (auto entry = tables.begin(); entry != tables.end(); ++entry)
+		{
+			if (entry->second.used < oldest->second.used)
+				oldest = entry;
+		}
+		tables.erase(oldest);
+	}
+
+	return opened;
+}
+
+QueryClient::~QueryClient()
+{
+	disconnect();
+}
+
+int QueryClient::connect(const std::string &socket_path)
+{
+	sockaddr_un addr;
+
+	disconnect();
+	if (!socketAddress(socket_path, addr))
+		return -1;
+
+	socket_init();
+	connection = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (connection == INVALID_SOCKET)
+	{
+		socket_destroy();
+		return -1;
+	}
+
+	if (::connect(connection, (struct sockaddr *)&addr, sizeof(addr)) == SOCKET_ERROR)
+	{
+		disconnect();
+		return -1;
+	}
+
+	return 0;
+}
+
+std::string QueryClient::request(const std::map<std::string, std::string> &options)
+{
+	std::string line;
+
+	for (auto option = options.begin(); option != options.end(); ++option)
+	{
+		if (option->first.find_first_of("\t\r\n=") != std::string::npos
+			|| option->second.find_first_of("\t\r\n") != std::string::npos)
+			return "";
+
+		if (!line.empty())
+			line += "\t";
+		line += option->first + "=" + option->second;
+	}
+
+	return line;
+}
+
+int QueryClient::query(const std::string &request, QuerySink &sink)
+{
+	if (connection == INVALID_SOCKET)
+		return -1;
+
+	std::string line = request + "\n";
+	if (!sendAll(connection, line.data(), line.size()))
+		return -1;
+
+	error.clear();
+	if (!receiveLine(line))
+		return -1;
+	if (line.compare(0, 6, "ERROR ") == 0)
+	{
+		error = line.substr(6);
+		return -1;
+	}
+	if (line != "OK")
+		return -1;
+
+	while (true)
+	{
+		size_t size;
+		size_t end;
+
+		if (!receiveLine(line) || line.empty())
+			return -1;
+		try {
+			size = std::stoul(line, &end, 16);
+		}
+		catch (const std::exception &) {
+			return -1;
+		}
+		if (end != line.size())
+			return -1;
+		if (size == 0)
+			return 0;
+		if (!receiveChunk(size, sink))
+			return -1;
+	}
+}
+
+bool QueryClient::receiveLine(std::string &line)
+{
+	char buffer[kRECEIVE_BUFFER_SIZE];
+	size_t line_end;
+
+	while ((line_end = inbox.find('\n')) == std::string::npos)
+	{
+		if (inbox.size() > kMAX_REQUEST_SIZE)
+			return false;
+		int received = recv(connection, buffer, sizeof(buffer), 0);
+		if (received <= 0)
+			return false;
+		inbox.append(buffer, received);
+	}
+
+	line = inbox.substr(0, line_end);
+	inbox.erase(0, line_end + 1);
+
+	return true;
+}
+
+bool QueryClient::receiveChunk(size_t size, QuerySink &sink)
+{
+	char buffer[kRECEIVE_BUFFER_SIZE];
+
+	size_t buffered = std::min(size, inbox.size());
+	if (buffered > 0 && !sink.write(inbox.data(), buffered))
+		return false;
+	inbox.erase(0, buffered);
+	size -= buffered;
+
+	while (size > 0)
+	{
+		int received = recv(connection, buffer, static_cast<int>(std::min(size, sizeof(buffer))), 0);
+		if (received <= 0 || !sink.write(buffer, static_cast<size_t>(received)))
+			return false;
+		size -= static_cast<size_t>(received);
+	}
+
+	return true;
+}
+
+void QueryClient::disconnect()
+{
+	if (connection != INVALID_SOCKET)
+	{
+		closesocket(connection);
+		connection = INVALID_SOCKET;
+		inbox.clear();
+		socket_destroy();
+	}
+}
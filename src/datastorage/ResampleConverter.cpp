@@ -0,0 +1,223 @@
+#include "ResampleConverter.h"
+
+#include <cmath>
+
+using namespace StorageNS;
+
+ResampleStorageConverter::~ResampleStorageConverter()
+{
+	if (csv_file != nullptr)
+		std::fclose(csv_file);
+}
+
+void ResampleStorageConverter::setTimestampField(const std::string &field)
+{
+	timestamp_name = field;
+}
+
+void ResampleStorageConverter::setInterval(double interval)
+{
+	this->interval = interval;
+}
+
+void ResampleStorageConverter::setFields(const std::vector<std::string> &fields)
+{
+	field_names = fields;
+}
+
+int ResampleStorageConverter::prepare()
+{
+	std::string content = StorageNS::getTextFileContent(template_.data());
+	configurator = std::unique_ptr<JsonConfigurator>(new JsonConfigurator(content));
+
+	if (!configurator->isValid()){
+		return -1;
+	}
+
+	parsers = configurator->generateParser();
+	item_length = parsers.length();
+	// Buckets hold aggregates of source fields only, derived fields do not apply.
+	if (item_length == 0 || !derivation.empty())
+	{
+		return -1;
+	}
+
+	if (!parsers.findField(timestamp_name, timestamp) || !timestamp.isNumeric())
+	{
+		return -1;
+	}
+
+	// Integral timestamps are bucketed with integer division, so the width
+	// should be a whole number of units.
+	if (interval <= 0 || (timestamp.isIntegral() && (interval < 1 || interval != std::floor(interval))))
+	{
+		return -1;
+	}
+
+	fields.clear();
+	if (field_names.empty())
+	{
+		auto members = parsers.fields();
+		for (auto member = members.begin(); member != members.end(); ++member)
+		{
+			if (member->name != timestamp_name && member->isNumeric())
+				fields.push_back(*member);
+		}
+	}
+	else
+	{
+		FieldInfo field;
+		for (auto name = field_names.begin(); name != field_names.end(); ++name)
+		{
+			if (!parsers.findField(*name, field) || !field.isNumeric())
+			{
+				return -1;
+			}
+			fields.push_back(field);
+		}
+	}
+	rollups.resize(fields.size());
+
+	if (!source_file.open(source))
+	{
+		return -1;
+	}
+
+	csv_file = std::fopen(target.data(), "w+");
+	if (csv_file == nullptr)
+	{
+		return -1;
+	}
+
+	total_item = source_file.size() / item_length;
+
+	if (locateRecords(parsers) == -1)
+	{
+		return -1;
+	}
+
+	return 0;
+}
+
+int64_t ResampleStorageConverter::bucketOf(const char *record)
+{
+	if (timestamp.isIntegral())
+	{
+		int64_t width = static_cast<int64_t>(interval);
+		int64_t value = timestamp.integer(record);
+		int64_t bucket = value / width;
+
+		// Round towards negative infinity for timestamps before epoch.
+		if (value % width < 0)
+			--bucket;
+
+		return bucket;
+	}
+
+	return static_cast<int64_t>(std::floor(timestamp.value(record) / interval));
+}
+
+int ResampleStorageConverter::convertAndStore()
+{
+	if (!hasNext())
+		return -1;
+
+	const char *base = source_file.data();
+	const char *record = base + current_item * item_length;
+
+	// A bucket starts with an accepted record.
+	while (!accepts(record))
+	{
+		current_item = nextCandidate(current_item + 1);
+		if (current_item == total_item)
+			return 0;
+		record = base + current_item * item_length;
+	}
+
+	int64_t bucket = bucketOf(record);
+
+	for (size_t i = 0; i < fields.size(); ++i)
+	{
+		double value = fields[i].value(record);
+		rollups[i].min = value;
+		rollups[i].max = value;
+		rollups[i].sum = 0;
+	}
+
+	size_t count = 0;
+	for (; current_item < total_item; current_item = nextCandidate(current_item + 1))
+	{
+		record = base + current_item * item_length;
+		if (bucketOf(record) != bucket)
+			break;
+		if (!accepts(record))
+			continue;
+		++count;
+
+		for (size_t i = 0; i < fields.size(); ++i)
+		{
+			double value = fields[i].value(record);
+			Rollup &rollup = rollups[i];
+
+			if (value < rollup.min)
+				rollup.min = value;
+			if (value > rollup.max)
+				rollup.max = value;
+			rollup.sum += value;
+			rollup.last = value;
+		}
+	}
+
+	FormatSpecifier &specifier = FormatSpecifier::instance();
+	const char *delimiter = specifier.get_delimiter();
+	const char *double_specifier = specifier.get_specifier(FormatSpecifier::Type::DOUBLE);
+
+	if (timestamp.ticks != 0)
+	{
+		char text[FieldInfo::kTIMESTAMP_LENGTH];
+		formatTimestamp(text, bucket * static_cast<int64_t>(interval), timestamp.ticks, timestamp.local);
+		std::fprintf(csv_file, "%s", text);
+	}
+	else if (timestamp.isIntegral())
+	{
+		std::fprintf(csv_file, "%lld", static_cast<long long>(bucket * static_cast<int64_t>(interval)));
+	}
+	else
+	{
+		std::fprintf(csv_file, double_specifier, bucket * interval);
+	}
+
+	for (size_t i = 0; i < fields.size(); ++i)
+	{
+		const Rollup &rollup = rollups[i];
+		double values[] = { rollup.min, rollup.max, rollup.sum / count, rollup.last };
+
+		for (size_t j = 0; j < sizeof(values) / sizeof(values[0]); ++j)
+		{
+			std::fprintf(csv_file, "%s", delimiter);
+			std::fprintf(csv_file, double_specifier, values[j]);
+		}
+	}
+	std::fprintf(csv_file, "%s%llu\n", delimiter, static_cast<unsigned long long>(count));
+
+	return 0;
+}
+
+int ResampleStorageConverter::storeHeaders()
+{
+	FormatSpecifier& specifier = FormatSpecifier::instance();
+	const char *delimiter = specifier.get_delimiter();
+	const char *suffixes[] = { ".min", ".max", ".avg", ".last" };
+
+	std::fprintf(csv_file, "%s", timestamp.name.data());
+	for (size_t i = 0; i < fields.size(); ++i)
+	{
+		for (size_t j = 0; j < sizeof(suffixes) / sizeof(suffixes[0]); ++j)
+		{
+			std::fprintf(csv_file, "%s%s%s", delimiter, fields[i].name.data(), suffixes[j]);
+		}
+	}
+	std::fprintf(csv_file, "%scount\n", delimiter);
+
+	return 0;
+}
@@ -0,0 +1,457 @@
+#include "StorageBTree.h"
+
+#include <algorithm>
+
+using namespace StorageNS;
+
+namespace {
+	const char kBTREE_MAGIC[4] = { 'D', 'S', 'B', 'T' };
+	const uint32_t kBTREE_VERSION = 1;
+	const uint32_t kPAGE_SIZE = 4096;
+	const uint16_t kLEAF_PAGE = 1;
+	const uint16_t kINNER_PAGE = 2;
+
+	const size_t kLEAF_CAPACITY = (kPAGE_SIZE - sizeof(BTreePageHeader)) / sizeof(BTreeLeafEntry);
+	const size_t kINNER_CAPACITY = (kPAGE_SIZE - sizeof(BTreePageHeader)) / sizeof(BTreeInnerEntry);
+
+	// Count of cached pages before they are written back.
+	const size_t kCACHE_PAGES = 1024;
+
+	inline bool entryLess(uint64_t key, uint64_t item, uint64_t other_key, uint64_t other_item)
+	{
+		return key < other_key || (key == other_key && item < other_item);
+	}
+
+	inline BTreePageHeader *pageHeader(char *page)
+	{
+		return reinterpret_cast<BTreePageHeader *>(page);
+	}
+
+	template <typename Entry>
+	inline Entry *pageEntries(char *page)
+	{
+		return reinterpret_cast<Entry *>(page + sizeof(BTreePageHeader));
+	}
+
+	template <typename Entry>
+	inline const Entry *pageEntries(const char *page)
+	{
+		return reinterpret_cast<const Entry *>(page + sizeof(BTreePageHeader));
+	}
+
+	/**
+	* @brief  Index of child of inner page whose subtree holds (key, item).
+	*/
+	inline size_t childIndex(const BTreeInnerEntry *entries, size_t count, uint64_t key, uint64_t item)
+	{
+		size_t index = 0;
+		for (size_t i = 1; i < count && !entryLess(key, item, entries[i].key, entries[i].item); ++i)
+		{
+			index = i;
+		}
+		return index;
+	}
+
+	void initHeader(BTreeHeader &header, const FieldInfo &field, size_t item_length)
+	{
+		std::memset(&header, 0, sizeof(header));
+		std::memcpy(header.magic, kBTREE_MAGIC, sizeof(header.magic));
+		header.version = kBTREE_VERSION;
+		header.page_size = kPAGE_SIZE;
+		header.key_offset = static_cast<uint32_t>(field.offset);
+		header.key_type = field.layoutCode();
+		header.item_length = item_length;
+	}
+
+	bool matchHeader(const BTreeHeader &header, const FieldInfo &field, size_t item_length)
+	{
+		return std::memcmp(header.magic, kBTREE_MAGIC, sizeof(header.magic)) == 0
+			&& header.version == kBTREE_VERSION
+			&& header.page_size == kPAGE_SIZE
+			&& header.key_offset == field.offset
+			&& header.key_type == field.layoutCode()
+			&& header.item_length == item_length;
+	}
+}
+
+BTreeWriter::~BTreeWriter()
+{
+	close();
+}
+
+int BTreeWriter::bulkLoad(const std::string &source_file, const FieldInfo &field,
+	size_t item_length, const std::string &btree_file)
+{
+	MappedFile source;
+
+	if (item_length == 0 || !source.open(source_file))
+		return -1;
+
+	size_t record_count = source.size() / item_length;
+	std::vector<BTreeLeafEntry> entries(record_count);
+	for (size_t item = 0; item < record_count; ++item)
+	{
+		entries[item].key = field.sortKey(source.data() + item * item_length);
+		entries[item].item = item;
+	}
+	std::sort(entries.begin(), entries.end(), [](const BTreeLeafEntry &a, const BTreeLeafEntry &b) {
+		return entryLess(a.key, a.item, b.key, b.item);
+	});
+
+	std::ofstream stream(btree_file, std::ios::binary | std::ios::out | std::ios::trunc);
+	if (!stream.is_open())
+		return -1;
+
+	BTreeHeader header;
+	initHeader(header, field, item_length);
+	header.entry_count = record_count;
+
+	std::vector<char> page(kPAGE_SIZE);
+	stream.write(page.data(), page.size());
+	uint64_t page_count = 1;
+
+	// Leaves are filled up and written in key order, collecting the first
+	// entry of every page as entry of the upper level.
+	std::vector<BTreeInnerEntry> level;
+	size_t leaf_count = std::max<size_t>(1, (record_count + kLEAF_CAPACITY - 1) / kLEAF_CAPACITY);
+	for (size_t leaf = 0; leaf < leaf_count; ++leaf)
+	{
+		size_t begin = leaf * kLEAF_CAPACITY;
+		size_t count = std::min(kLEAF_CAPACITY, record_count - begin);
+
+		std::fill(page.begin(), page.end(), 0);
+		BTreePageHeader *page_header = pageHeader(page.data());
+		page_header->type = kLEAF_PAGE;
+		page_header->count = static_cast<uint16_t>(count);
+		page_header->next = leaf + 1 < leaf_count ? page_count + 1 : 0;
+		std::copy(entries.begin() + begin, entries.begin() + begin + count, pageEntries<BTreeLeafEntry>(page.data()));
+
+		BTreeInnerEntry entry = { 0, 0, page_count };
+		if (count > 0) {
+			entry.key = entries[begin].key;
+			entry.item = entries[begin].item;
+		}
+		level.push_back(entry);
+
+		stream.write(page.data(), page.size());
+		++page_count;
+	}
+	header.height = 1;
+
+	while (level.size() > 1)
+	{
+		std::vector<BTreeInnerEntry> upper;
+		size_t inner_count = (level.size() + kINNER_CAPACITY - 1) / kINNER_CAPACITY;
+
+		for (size_t inner = 0; inner < inner_count; ++inner)
+		{
+			size_t begin = inner * kINNER_CAPACITY;
+			size_t count = std::min(kINNER_CAPACITY, level.size() - begin);
+
+			std::fill(page.begin(), page.end(), 0);
+			BTreePageHeader *page_header = pageHeader(page.data());
+			page_header->type = kINNER_PAGE;
+			page_header->count = static_cast<uint16_t>(count);
+			page_header->next = inner + 1 < inner_count ? page_count + 1 : 0;
+			std::copy(level.begin() + begin, level.begin() + begin + count, pageEntries<BTreeInnerEntry>(page.data()));
+
+			BTreeInnerEntry entry = { level[begin].key, level[begin].item, page_count };
+			upper.push_back(entry);
+
+			stream.write(page.data(), page.size());
+			++page_count;
+		}
+
+		level.swap(upper);
+		++header.height;
+	}
+
+	header.root = level[0].child;
+	header.page_count = page_count;
+	stream.seekp(0, std::ios::beg);
+	stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+	return stream.good() ? 0 : -1;
+}
+
+int BTreeWriter::create(const std::string &btree_file, const FieldInfo &field, size_t item_length)
+{
+	close();
+
+	// Create the file, since fstream does not create file in in|out mode.
+	std::ofstream(btree_file, std::ios::binary | std::ios::out | std::ios::trunc).close();
+	stream.open(btree_file, std::ios::binary | std::ios::in | std::ios::out);
+	if (!stream.is_open())
+		return -1;
+
+	initHeader(header, field, item_length);
+	header.page_count = 1;
+	header.height = 1;
+	header.root = allocate();
+	pageHeader(page(header.root, true))->type = kLEAF_PAGE;
+
+	return flush();
+}
+
+int BTreeWriter::open(const std::string &btree_file, const FieldInfo &field, size_t item_length)
+{
+	close();
+
+	stream.open(btree_file, std::ios::binary | std::ios::in | std::ios::out);
+	if (!stream.is_open())
+		return -1;
+
+	stream.read(reinterpret_cast<char *>(&header), sizeof(header));
+	if (!stream.good() || !matchHeader(header, field, item_length))
+	{
+		stream.close();
+		return -1;
+	}
+
+	return 0;
+}
+
+bool BTreeWriter::isOpen()
+{
+	return stream.is_open();
+}
+
+char *BTreeWriter::page(uint64_t number, bool dirty)
+{
+	auto cached = pages.find(number);
+
+	if (cached == pages.end())
+	{
+		CachedPage &loaded = pages[number];
+		loaded.data.resize(kPAGE_SIZE);
+		loaded.dirty = false;
+		stream.seekg(number * kPAGE_SIZE, std::ios::beg);
+		stream.read(loaded.data.data(), kPAGE_SIZE);
+		stream.clear();
+		cached = pages.find(number);
+	}
+
+	cached->second.dirty = cached->second.dirty || dirty;
+
+	return cached->second.data.data();
+}
+
+uint64_t BTreeWriter::allocate()
+{
+	uint64_t number = header.page_count++;
+	CachedPage &allocated = pages[number];
+
+	allocated.data.assign(kPAGE_SIZE, 0);
+	allocated.dirty = true;
+
+	return number;
+}
+
+int BTreeWriter::insert(uint64_t key, uint64_t item)
+{
+	if (!stream.is_open())
+		return -1;
+
+	if (pages.size() > kCACHE_PAGES && flush() == -1)
+		return -1;
+
+	Split split;
+	if (insertInto(header.root, key, item, split))
+	{
+		uint64_t root = allocate();
+		char *data = page(root, true);
+		BTreePageHeader *root_header = pageHeader(data);
+		BTreeInnerEntry *entries = pageEntries<BTreeInnerEntry>(data);
+
+		root_header->type = kINNER_PAGE;
+		root_header->count = 2;
+		entries[0].key = 0;
+		entries[0].item = 0;
+		entries[0].child = header.root;
+		entries[1].key = split.key;
+		entries[1].item = split.item;
+		entries[1].child = split.page;
+
+		header.root = root;
+		++header.height;
+	}
+	++header.entry_count;
+
+	return 0;
+}
+
+bool BTreeWriter::insertInto(uint64_t number, uint64_t key, uint64_t item, Split &split)
+{
+	char *data = page(number, true);
+	BTreePageHeader *page_header = pageHeader(data);
+	size_t count = page_header->count;
+
+	if (page_header->type == kLEAF_PAGE)
+	{
+		BTreeLeafEntry *entries = pageEntries<BTreeLeafEntry>(data);
+		BTreeLeafEntry entry = { key, item };
+		size_t position = std::upper_bound(entries, entries + count, entry,
+			[](const BTreeLeafEntry &a, const BTreeLeafEntry &b) {
+				return entryLess(a.key, a.item, b.key, b.item);
+			}) - entries;
+
+		if (count < kLEAF_CAPACITY)
+		{
+			std::copy_backward(entries + position, entries + count, entries + count + 1);
+			entries[position] = entry;
+			++page_header->count;
+			return false;
+		}
+
+		std::vector<BTreeLeafEntry> all(entries, entries + count);
+		all.insert(all.begin() + position, entry);
+
+		// Appending to the last page keeps it full, so ascending keys such as
+		// sequence numbers fill pages completely.
+		size_t left_count = (position == count && page_header->next == 0) ? count : all.size() / 2;
+		uint64_t right_number = allocate();
+		char *right = page(right_number, true);
+		BTreePageHeader *right_header = pageHeader(right);
+
+		right_header->type = kLEAF_PAGE;
+		right_header->count = static_cast<uint16_t>(all.size() - left_count);
+		right_header->next = page_header->next;
+		std::copy(all.begin() + left_count, all.end(), pageEntries<BTreeLeafEntry>(right));
+
+		page_header->count = static_cast<uint16_t>(left_count);
+		page_header->next = right_number;
+		std::copy(all.begin(), all.begin() + left_count, entries);
+
+		split.key = all[left_count].key;
+		split.item = all[left_count].item;
+		split.page = right_number;
+		return true;
+	}
+
+	BTreeInnerEntry *entries = pageEntries<BTreeInnerEntry>(data);
+	size_t index = childIndex(entries, count, key, item);
+	Split child_split;
+
+	if (!insertInto(entries[index].child, key, item, child_split))
+		return false;
+
+	BTreeInnerEntry entry = { child_split.key, child_split.item, child_split.page };
+	size_t position = index + 1;
+
+	if (count < kINNER_CAPACITY)
+	{
+		std::copy_backward(entries + position, entries + count, entries + count + 1);
+		entries[position] = entry;
+		++page_header->count;
+		return false;
+	}
+
+	std::vector<BTreeInnerEntry> all(entries, entries + count);
+	all.insert(all.begin() + position, entry);
+
+	size_t left_count = (position == count && page_header->next == 0) ? count : all.size() / 2;
+	uint64_t right_number = allocate();
+	char *right = page(right_number, true);
+	BTreePageHeader *right_header = pageHeader(right);
+
+	right_header->type = kINNER_PAGE;
+	right_header->count = static_cast<uint16_t>(all.size() - left_count);
+	right_header->next = page_header->next;
+	std::copy(all.begin() + left_count, all.end(), pageEntries<BTreeInnerEntry>(right));
+
+	page_header->count = static_cast<uint16_t>(left_count);
+	page_header->next = right_number;
+	std::copy(all.begin(), all.begin() + left_count, entries);
+
+	split.key = all[left_count].key;
+	split.item = all[left_count].item;
+	split.page = right_number;
+	return true;
+}
+
+int BTreeWriter::flush()
+{
+	if (!stream.is_open())
+		return -1;
+
+	for (auto cached = pages.begin(); cached != pages.end(); ++cached)
+	{
+		if (cached->second.dirty)
+		{
+			stream.seekp(cached->first * kPAGE_SIZE, std::ios::beg);
+			stream.write(cached->second.data.data(), kPAGE_SIZE);
+		}
+	}
+	pages.clear();
+
+	stream.seekp(0, std::ios::beg);
+	stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	stream.flush();
+
+	return stream.good() ? 0 : -1;
+}
+
+void BTreeWriter::close()
+{
+	if (stream.is_open())
+	{
+		flush();
+		stream.close();
+	}
+	pages.clear();
+}
+
+int BTreeIndex::open(const std::string &btree_file, const FieldInfo &field, size_t item_length)
+{
+	header = nullptr;
+
+	if (!this->btree_file.open(btree_file) || this->btree_file.size() < kPAGE_SIZE)
+		return -1;
+
+	const BTreeHeader *mapped = reinterpret_cast<const BTreeHeader *>(this->btree_file.data());
+	if (!matchHeader(*mapped, field, item_length)
+		|| this->btree_file.size() < mapped->page_count * kPAGE_SIZE
+		|| mapped->root == 0 || mapped->root >= mapped->page_count)
+	{
+		this->btree_file.close();
+		return -1;
+	}
+
+	header = mapped;
+
+	return 0;
+}
+
+std::vector<uint64_t> BTreeIndex::lookup(uint64_t begin_key, uint64_t end_key, size_t limit)
+{
+	std::vector<uint64_t> items;
+	uint64_t number = header->root;
+
+	for (uint64_t level = header->height; level > 1; --level)
+	{
+		const char *data = page(number);
+		const BTreePageHeader *page_header = reinterpret_cast<const BTreePageHeader *>(data);
+		const BTreeInnerEntry *entries = pageEntries<BTreeInnerEntry>(data);
+
+		number = entries[childIndex(entries, page_header->count, begin_key, 0)].child;
+	}
+
+	while (number != 0 && items.size() < limit)
+	{
+		const char *data = page(number);
+		const BTreePageHeader *page_header = reinterpret_cast<const BTreePageHeader *>(data);
+		const BTreeLeafEntry *entries = pageEntries<BTreeLeafEntry>(data);
+
+		for (size_t i = 0; i < page_header->count && items.size() < limit; ++i)
+		{
+			if (entries[i].key > end_key)
+				return items;
+			if (entries[i].key >= begin_key)
+				items.push_back(entries[i].item);
+		}
+
+		number = page_header->next;
+	}
+
+	return items;
+}
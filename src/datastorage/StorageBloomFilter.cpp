@@ -0,0 +1,243 @@
+#include "StorageBloomFilter.h"
+#include "Directory.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+using namespace StorageNS;
+
+namespace {
+	const char kBLOOM_MAGIC[4] = { 'D', 'S', 'B', 'F' };
+	const uint32_t kBLOOM_VERSION = 2;
+	const uint32_t kMAX_HASH_COUNT = 30;
+
+	// Finalizer of MurmurHash3, mixing all key bits into all hash bits.
+	inline uint64_t mix(uint64_t key)
+	{
+		key ^= key >> 33;
+		key *= 0xff51afd7ed558ccdULL;
+		key ^= key >> 33;
+		key *= 0xc4ceb9fe1a85ec53ULL;
+		key ^= key >> 33;
+		return key;
+	}
+
+	/**
+	* Bit positions of a key are generated with double hashing h1 + i * h2.
+	*/
+	struct BloomProbe {
+		BloomProbe(uint64_t key, uint64_t bits)
+			:hash(mix(key)), step(mix(key ^ 0x9e3779b97f4a7c15ULL) | 1), bits(bits) {}
+
+		uint64_t next()
+		{
+			uint64_t bit = hash % bits;
+			hash += step;
+			return bit;
+		}
+
+		uint64_t hash;
+		uint64_t step;
+		uint64_t bits;
+	};
+}
+
+double BloomFilterConfig::bitsPerKey(double false_positive_rate)
+{
+	const double kLN2 = 0.69314718055994531;
+
+	return -std::log(false_positive_rate) / (kLN2 * kLN2);
+}
+
+int BlockBloomFilter::build(const std::string &source_file, const std::vector<BloomFilterConfig> &configs,
+	size_t item_length, size_t block_records, const std::string &bloom_file)
+{
+	MappedFile source;
+	FileStatus status;
+
+	if (item_length == 0 || block_records == 0 || configs.empty()
+		|| !statFile(source_file, status) || !source.open(source_file))
+		return -1;
+
+	size_t record_count = source.size() / item_length;
+	size_t block_count = (record_count + block_records - 1) / block_records;
+
+	std::vector<BloomFilterField> fields(configs.size());
+	uint64_t word_count = 0;
+	for (size_t i = 0; i < configs.size(); ++i)
+	{
+		const double kLN2 = 0.69314718055994531;
+		double bits_per_key = std::max(1.0, configs[i].bits_per_key);
+		uint64_t block_bits = static_cast<uint64_t>(std::ceil(bits_per_key * block_records));
+
+		fields[i].offset = static_cast<uint32_t>(configs[i].field.offset);
+		fields[i].type = configs[i].field.layoutCode();
+		fields[i].hash_count = std::min(kMAX_HASH_COUNT,
+			std::max(1u, static_cast<uint32_t>(std::lround(bits_per_key * kLN2))));
+		fields[i].block_words = static_cast<uint32_t>((block_bits + 63) / 64);
+		fields[i].first_word = word_count;
+		word_count += static_cast<uint64_t>(fields[i].block_words) * block_count;
+	}
+
+	std::ofstream stream(bloom_file, std::ios::binary | std::ios::out | std::ios::trunc);
+	if (!stream.is_open())
+		return -1;
+
+	BloomFilterHeader header;
+	std::memcpy(header.magic, kBLOOM_MAGIC, sizeof(header.magic));
+	header.version = kBLOOM_VERSION;
+	header.block_records = block_records;
+	header.item_length = item_length;
+	header.block_count = block_count;
+	header.field_count = static_cast<uint32_t>(fields.size());
+	header.reserved = 0;
+	header.source_size = status.size;
+	header.source_modified = status.modified;
+
+	stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	stream.write(reinterpret_cast<const char *>(fields.data()), fields.size() * sizeof(BloomFilterField));
+
+	// Every worker keeps filters of one block, which are written to their
+	// places among filters of other blocks once the block is done.
+	std::streamoff words_offset = static_cast<std::streamoff>(sizeof(header) + fields.size() * sizeof(BloomFilterField));
+	std::mutex stream_mutex;
+	std::atomic<size_t> next_block(0);
+
+	auto worker = [&]() {
+		std::vector<uint64_t> words;
+
+		for (size_t block = next_block++; block < block_count; block = next_block++)
+		{
+			size_t begin = block * block_records;
+			size_t end = std::min(record_count, begin + block_records);
+
+			for (size_t i = 0; i < configs.size(); ++i)
+			{
+				const BloomFilterField &field = fields[i];
+				uint64_t bits = static_cast<uint64_t>(field.block_words) * 64;
+
+				words.assign(field.block_words, 0);
+				uint64_t *filter = words.data();
+
+				for (size_t item = begin; item < end; ++item)
+				{
+					BloomProbe probe(configs[i].field.sortKey(source.data() + item * item_length), bits);
+					for (uint32_t hash = 0; hash < field.hash_count; ++hash)
+					{
+						uint64_t bit = probe.next();
+						filter[bit / 64] |= 1ULL << (bit % 64);
+					}
+				}
+
+				std::lock_guard<std::mutex> lock(stream_mutex);
+				stream.seekp(words_offset + static_cast<std::streamoff>((field.first_word + block * field.block_words) * sizeof(uint64_t)));
+				stream.write(reinterpret_cast<const char *>(filter), field.block_words * sizeof(uint64_t));
+			}
+		}
+	};
+
+	size_t thread_count = std::min<size_t>(std::max<size_t>(block_count, 1),
+		std::max(1u, std::thread::hardware_concurrency()));
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < thread_count; ++i)
+	{
+		threads.emplace_back(worker);
+	}
+	worker();
+	for (auto thread = threads.begin(); thread != threads.end(); ++thread)
+	{
+		thread->join();
+	}
+
+	return stream.good() ? 0 : -1;
+}
+
+int BlockBloomFilter::open(const std::string &bloom_file, const std::string &source_file, size_t item_length)
+{
+	FileStatus status;
+
+	header = nullptr;
+
+	if (!statFile(source_file, status) || !this->bloom_file.open(bloom_file)
+		|| this->bloom_file.size() < sizeof(BloomFilterHeader))
+		return -1;
+
+	const BloomFilterHeader *mapped = reinterpret_cast<const BloomFilterHeader *>(this->bloom_file.data());
+	size_t fields_size = mapped->field_count * sizeof(BloomFilterField);
+
+	if (std::memcmp(mapped->magic, kBLOOM_MAGIC, sizeof(mapped->magic)) != 0
+		|| mapped->version != kBLOOM_VERSION
+		|| mapped->item_length != item_length
+		|| mapped->block_records == 0
+		|| mapped->source_size != status.size
+		|| mapped->source_modified != status.modified
+		|| this->bloom_file.size() < sizeof(BloomFilterHeader) + fields_size)
+	{
+		this->bloom_file.close();
+		return -1;
+	}
+
+	const BloomFilterField *mapped_fields = reinterpret_cast<const BloomFilterField *>(
+		this->bloom_file.data() + sizeof(BloomFilterHeader));
+	uint64_t word_count = 0;
+	for (uint32_t i = 0; i < mapped->field_count; ++i)
+	{
+		word_count += static_cast<uint64_t>(mapped_fields[i].block_words) * mapped->block_count;
+	}
+
+	if (this->bloom_file.size() != sizeof(BloomFilterHeader) + fields_size + word_count * sizeof(uint64_t))
+	{
+		this->bloom_file.close();
+		return -1;
+	}
+
+	header = mapped;
+	fields = mapped_fields;
+	words = reinterpret_cast<const uint64_t *>(fields + header->field_count);
+
+	return 0;
+}
+
+int BlockBloomFilter::fieldIndex(const FieldInfo &field) const
+{
+	for (uint32_t i = 0; i < header->field_count; ++i)
+	{
+		if (fields[i].offset == field.offset && fields[i].type == field.layoutCode())
+			return static_cast<int>(i);
+	}
+
+	return -1;
+}
+
+bool BlockBloomFilter::mayMatch(size_t block, const std::vector<Predicate> &predicates) const
+{
+	if (block >= header->block_count)
+		return true;
+
+	for (auto predicate = predicates.begin(); predicate != predicates.end(); ++predicate)
+	{
+		if (predicate->op != Predicate::Operator::EQUAL)
+			continue;
+
+		int index = fieldIndex(predicate->field);
+		if (index == -1)
+			continue;
+
+		const BloomFilterField &field = fields[index];
+		const uint64_t *filter = words + field.first_word + block * field.block_words;
+		BloomProbe probe(predicate->key, static_cast<uint64_t>(field.block_words) * 64);
+
+		for (uint32_t hash = 0; hash < field.hash_count; ++hash)
+		{
+			uint64_t bit = probe.next();
+			if ((filter[bit / 64] & (1ULL << (bit % 64))) == 0)
+				return false;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,320 @@
+#include "StorageCatalog.h"
+#include "Directory.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <thread>
+
+using namespace StorageNS;
+
+namespace {
+	const char *kMANIFEST_TAG = "#DataStorage catalog 1";
+
+	// FNV-1a, good enough to tell layouts apart.
+	inline uint64_t hashBytes(uint64_t hash, const void *data, size_t size)
+	{
+		const unsigned char *bytes = static_cast<const unsigned char *>(data);
+
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= 0x100000001b3ULL;
+		}
+
+		return hash;
+	}
+
+	inline bool endsWith(const std::string &text, const std::string &suffix)
+	{
+		return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+	}
+}
+
+uint64_t StorageCatalog::schemaHash(SequencedParser &parsers)
+{
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	uint64_t length = parsers.length();
+	auto fields = parsers.fields();
+
+	hash = hashBytes(hash, &length, sizeof(length));
+	for (auto field = fields.begin(); field != fields.end(); ++field)
+	{
+		uint64_t offset = field->offset;
+		uint32_t type = static_cast<uint32_t>(field->type);
+
+		hash = hashBytes(hash, field->name.data(), field->name.size() + 1);
+		hash = hashBytes(hash, &offset, sizeof(offset));
+		hash = hashBytes(hash, &type, sizeof(type));
+		// Bit ranges and byte order change values read from the same bytes.
+		if (field->width != 0)
+		{
+			uint32_t code = field->layoutCode();
+			hash = hashBytes(hash, &code, sizeof(code));
+		}
+		if (field->swapped)
+		{
+			hash = hashBytes(hash, &field->swapped, sizeof(field->swapped));
+		}
+		// Keys of scaled fields are of physical values.
+		if (field->isScaled())
+		{
+			hash = hashBytes(hash, &field->scale, sizeof(field->scale));
+			hash = hashBytes(hash, &field->bias, sizeof(field->bias));
+		}
+	}
+
+	return hash;
+}
+
+void StorageCatalog::setTimeField(const std::string &field)
+{
+	time_name = field;
+}
+
+void StorageCatalog::setSuffix(const std::string &suffix)
+{
+	this->suffix = suffix;
+}
+
+int StorageCatalog::open(const std::string &directory, const std::string &template_file)
+{
+	this->directory = directory;
+	template_ = template_file;
+
+	std::string content = StorageNS::getTextFileContent(template_file.data());
+	configurator = std::unique_ptr<JsonConfigurator>(new JsonConfigurator(content));
+
+	if (!configurator->isValid()){
+		return -1;
+	}
+
+	parsers_ = configurator->generateParser();
+	if (parsers_.length() == 0 || !parsers_.findField(time_name, time_field))
+	{
+		return -1;
+	}
+	schema_hash = schemaHash(parsers_);
+
+	std::vector<FileStatus> files;
+	if (!listDirectory(directory, files))
+	{
+		return -1;
+	}
+
+	// Entries of unchanged files are kept, others are scanned again.
+	load();
+	std::map<std::string, CatalogEntry> loaded;
+	for (auto entry = entries_.begin(); entry != entries_.end(); ++entry)
+	{
+		loaded[entry->name] = *entry;
+	}
+
+	std::vector<CatalogEntry> entries;
+	std::vector<size_t> changed;
+	for (auto file = files.begin(); file != files.end(); ++file)
+	{
+		if (!endsWith(file->name, suffix))
+			continue;
+
+		auto found = loaded.find(file->name);
+		if (found != loaded.end() && found->second.size == file->size && found->second.modified == file->modified)
+		{
+			entries.push_back(found->second);
+			continue;
+		}
+
+		CatalogEntry entry;
+		entry.name = file->name;
+		entry.size = file->size;
+		entry.modified = file->modified;
+		changed.push_back(entries.size());
+		entries.push_back(entry);
+	}
+
+	std::atomic<size_t> next_file(0);
+	auto worker = [&]() {
+		for (size_t i = next_file++; i < changed.size(); i = next_file++)
+		{
+			scan(entries[changed[i]]);
+		}
+	};
+
+	size_t thread_count = std::min<size_t>(std::max<size_t>(changed.size(), 1),
+		std::max(1u, std::thread::hardware_concurrency()));
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < thread_count; ++i)
+	{
+		threads.emplace_back(worker);
+	}
+	worker();
+	for (auto thread = threads.begin(); thread != threads.end(); ++thread)
+	{
+		thread->join();
+	}
+
+	std::sort(entries.begin(), entries.end(), [](const CatalogEntry &a, const CatalogEntry &b) {
+		return a.first_key < b.first_key || (a.first_key == b.first_key && a.name < b.name);
+	});
+
+	bool modified = !changed.empty() || entries.size() != entries_.size();
+	entries_.swap(entries);
+
+	return modified ? save() : 0;
+}
+
+void StorageCatalog::scan(CatalogEntry &entry)
+{
+	std::string path = directory + "/" + entry.name;
+	std::string schema_path = path.substr(0, path.size() - suffix.size()) + ".json";
+
+	entry.schema_hash = schema_hash;
+	entry.record_count = 0;
+	entry.first_key = ~0ULL;
+	entry.last_key = 0;
+
+	size_t item_length = parsers_.length();
+	std::string content = StorageNS::getTextFileContent(schema_path.data());
+	if (!content.empty())
+	{
+		JsonConfigurator configurator(content);
+		if (!configurator.isValid())
+		{
+			entry.schema_hash = 0;
+			return;
+		}
+
+		SequencedParser parsers = configurator.generateParser();
+		entry.schema_hash = schemaHash(parsers);
+		item_length = parsers.length();
+		if (item_length == 0)
+			return;
+	}
+
+	entry.record_count = entry.size / item_length;
+
+	// Time range is only used with the catalog schema.
+	if (entry.schema_hash != schema_hash)
+		return;
+
+	MappedFile file;
+	if (!file.open(path))
+	{
+		entry.record_count = 0;
+		return;
+	}
+
+	entry.record_count = file.size() / item_length;
+	for (size_t item = 0; item < entry.record_count; ++item)
+	{
+		uint64_t key = time_field.sortKey(file.data() + item * item_length);
+		entry.first_key = std::min(entry.first_key, key);
+		entry.last_key = std::max(entry.last_key, key);
+	}
+}
+
+int StorageCatalog::load()
+{
+	entries_.clear();
+
+	std::ifstream stream(manifestPath(directory));
+	if (!stream.is_open())
+		return -1;
+
+	// Entries are valid only with the same schema and time field.
+	std::ostringstream expected;
+	expected << kMANIFEST_TAG << '\t' << schema_hash << '\t' << time_field.offset
+		<< '\t' << static_cast<int>(time_field.type);
+
+	std::string line;
+	if (!std::getline(stream, line) || line != expected.str())
+		return -1;
+
+	while (std::getline(stream, line))
+	{
+		std::istringstream fields(line);
+		CatalogEntry entry;
+
+		if (std::getline(fields, entry.name, '\t')
+			&& fields >> entry.size >> entry.modified >> entry.schema_hash
+				>> entry.record_count >> entry.first_key >> entry.last_key)
+		{
+			entries_.push_back(entry);
+		}
+	}
+
+	return 0;
+}
+
+int StorageCatalog::save()
+{
+	std::string path = manifestPath(directory);
+	std::string temporary = path + ".tmp";
+
+	{
+		std::ofstream stream(temporary, std::ios::out | std::ios::trunc);
+		if (!stream.is_open())
+			return -1;
+
+		stream << kMANIFEST_TAG << '\t' << schema_hash << '\t' << time_field.offset
+			<< '\t' << static_cast<int>(time_field.type) << '\n';
+		for (auto entry = entries_.begin(); entry != entries_.end(); ++entry)
+		{
+			stream << entry->name << '\t' << entry->size << '\t' << entry->modified << '\t'
+				<< entry->schema_hash << '\t' << entry->record_count << '\t'
+				<< entry->first_key << '\t' << entry->last_key << '\n';
+		}
+
+		if (!stream.good())
+			return -1;
+	}
+
+	// Renaming replaces existing file on POSIX, but fails on Windows.
+	if (std::rename(temporary.data(), path.data()) == 0)
+		return 0;
+
+	std::remove(path.data());
+	return std::rename(temporary.data(), path.data()) == 0 ? 0 : -1;
+}
+
+std::vector<std::string> StorageCatalog::select(uint64_t begin_key, uint64_t end_key,
+	const std::vector<Predicate> &predicates) const
+{
+	std::vector<std::string> paths;
+
+	for (auto entry = entries_.begin(); entry != entries_.end(); ++entry)
+	{
+		if (entry->schema_hash != schema_hash || entry->record_count == 0
+			|| entry->last_key < begin_key || entry->first_key > end_key)
+			continue;
+
+		bool may_match = true;
+		for (auto predicate = predicates.begin(); predicate != predicates.end() && may_match; ++predicate)
+		{
+			if (predicate->field.offset == time_field.offset && predicate->field.layoutCode() == time_field.layoutCode())
+				may_match = predicate->mayMatch(entry->first_key, entry->last_key);
+		}
+
+		if (may_match)
+			paths.push_back(directory + "/" + entry->name);
+	}
+
+	return paths;
+}
+
+std::vector<std::string> StorageCatalog::mismatched() const
+{
+	std::vector<std::string> names;
+
+	for (auto entry = entries_.begin(); entry != entries_.end(); ++entry)
+	{
+		if (entry->schema_hash != schema_hash)
+			names.push_back(entry->name);
+	}
+
+	return names;
+}
@@ -1,8 +1,18 @@
 #include "StorageConverter.h"
 #include "DataReceiver.h"
+#include "StorageIndex.h"
+
+#include <algorithm>
 
 using namespace StorageNS;
 
+namespace {
+	// Count of names tried for a part file before giving up.
+	const unsigned kPART_NAME_ATTEMPTS = 1000;
+	// Count of records read and evaluated at a time by CSV conversion.
+	const size_t kBATCH_RECORDS = 4096;
+}
+
 void StorageConverter::setBinarySource(const std::string &source_file)
 {
 	source = source_file;
@@ -18,6 +28,150 @@ void StorageConverter::setTemplate(const std::string &template_file)
 	template_ = template_file;
 }
 
+void StorageConverter::setRange(const std::string &field, const std::string &begin, const std::string &end)
+{
+	has_range = true;
+	range_name = field;
+	range_begin = begin;
+	range_end = end;
+}
+
+void StorageConverter::setDerivedFields(const std::string &declarations)
+{
+	derivation = declarations;
+}
+
+void StorageConverter::setFilter(const std::string &expression)
+{
+	filter = expression;
+}
+
+int StorageConverter::compileFilter(SequencedParser &parsers)
+{
+	predicates.clear();
+	if (parsePredicates(filter, parsers, predicates) == -1)
+		return -1;
+
+	if (!has_range)
+		return 0;
+
+	if (!parsers.findField(range_name, range_field))
+		return -1;
+
+	return compileRange(range_field, range_begin_key, range_end_key);
+}
+
+int StorageConverter::compileRange(const FieldInfo &field, uint64_t &begin_key, uint64_t &end_key) const
+{
+	begin_key = 0;
+	end_key = ~0ULL;
+
+	try {
+		if ((!range_begin.empty() && !field.boundKeyOf(range_begin, false, begin_key))
+			|| (!range_end.empty() && !field.boundKeyOf(range_end, true, end_key)))
+		{
+			begin_key = 1;
+			end_key = 0;
+		}
+	}
+	catch (const std::exception &) {
+		return -1;
+	}
+
+	return 0;
+}
+
+int StorageConverter::locateRecords(SequencedParser &parsers)
+{
+	if (compileFilter(parsers) == -1)
+		return -1;
+
+	if (!predicates.empty())
+	{
+		zone_map.open(ZoneMap::sidecarPath(source), source, item_length);
+		bloom_filter.open(BlockBloomFilter::sidecarPath(source), source, item_length);
+	}
+
+	if (!has_range)
+		return 0;
+
+	if (range_begin_key > range_end_key)
+	{
+		current_item = total_item;
+		return 0;
+	}
+
+	StorageIndex index;
+	if (index.open(StorageIndex::sidecarPath(source), source, range_field, item_length) == 0)
+	{
+		index.range(range_begin_key, range_end_key, current_item, total_item);
+	}
+
+	if (current_item > total_item)
+		current_item = total_item;
+
+	return 0;
+}
+
+std::string StorageConverter::createPartFile(size_t index) const
+{
+	std::string prefix = target + ".part" + std::to_string(static_cast<unsigned long long>(index));
+
+	for (unsigned attempt = 0; attempt < kPART_NAME_ATTEMPTS; ++attempt)
+	{
+		std::string path = prefix + "." + std::to_string(static_cast<unsigned long long>(attempt)) + ".tmp";
+		std::FILE *file = std::fopen(path.data(), "wx");
+		if (file != nullptr)
+		{
+			std::fclose(file);
+			return path;
+		}
+	}
+
+	return std::string();
+}
+
+bool StorageConverter::accepts(const char *record)
+{
+	if (has_range)
+	{
+		uint64_t key = range_field.sortKey(record);
+		if (key < range_begin_key || key > range_end_key)
+			return false;
+	}
+
+	for (auto predicate = predicates.begin(); predicate != predicates.end(); ++predicate)
+	{
+		if (!predicate->match(record))
+			return false;
+	}
+
+	return true;
+}
+
+size_t StorageConverter::nextCandidate(size_t item)
+{
+	while (item < total_item)
+	{
+		if (zone_map.isOpen() && item % zone_map.blockRecords() == 0
+			&& !zone_map.mayMatch(item / zone_map.blockRecords(), predicates))
+		{
+			item += zone_map.blockRecords();
+		}
+		else if (bloom_filter.isOpen() && item % bloom_filter.blockRecords() == 0
+			&& !bloom_filter.mayMatch(item / bloom_filter.blockRecords(), predicates))
+		{
+			item += bloom_filter.blockRecords();
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	return std::min(item, total_item);
+}
+
 size_t StorageConverter::totalItem()
 {
 	return total_item;
@@ -36,6 +190,12 @@ bool StorageConverter::hasNext()
 	return false;
 }
 
+CsvStorageConverter::~CsvStorageConverter()
+{
+	if (csv_file != nullptr)
+		std::fclose(csv_file);
+}
+
 int CsvStorageConverter::prepare()
 {
 	std::string content = StorageNS::getTextFileContent(template_.data());
@@ -47,6 +207,16 @@ int CsvStorageConverter::prepare()
 
 	parsers = configurator->generateParser();
 	item_length = parsers.length();
+	if (item_length == 0)
+	{
+		return -1;
+	}
+
+	derived.clear();
+	if (parseDerivedFields(configurator->derivedFields() + derivation, parsers, derived) == -1)
+	{
+		return -1;
+	}
 
 	csv_file = std::fopen(target.data(), "w+");
 
@@ -58,16 +228,78 @@ int CsvStorageConverter::prepare()
 
 	total_item = calculateFileSize(source_stream) / item_length;
 
+	if (locateRecords(parsers) == -1)
+	{
+		return -1;
+	}
+	batch_begin = current_item;
+	batch_count = 0;
+
+	return 0;
+}
+
+int CsvStorageConverter::loadBatch()
+{
+	batch_begin = current_item;
+	batch_count = std::min(kBATCH_RECORDS, total_item - current_item);
+	batch.resize(batch_count * item_length);
+
+	source_stream.seekg(batch_begin * item_length, std::ios::beg);
+	if (!source_stream.read(batch.data(), batch.size()))
+	{
+		batch_count = 0;
+		return -1;
+	}
+
+	selection.clear();
+	selected = 0;
+	for (size_t i = 0; i < batch_count; ++i)
+	{
+		if (accepts(batch.data() + i * item_length))
+			selection.push_back(static_cast<uint32_t>(i));
+	}
+
+	derived_values.resize(derived.size() * selection.size());
+	for (size_t i = 0; i < derived.size() && !selection.empty(); ++i)
+	{
+		derived[i].expression.evaluate(batch.data(), item_length, selection.data(), selection.size(),
+			&derived_values[i * selection.size()], stack);
+	}
+
 	return 0;
 }
 
 int CsvStorageConverter::convertAndStore()
 {
-	char *buf = new char[item_length];
-	source_stream.read(buf, item_length);
+	size_t next = nextCandidate(current_item);
+	if (next != current_item)
+	{
+		current_item = next;
+		if (!hasNext())
+			return 0;
+	}
 
-	parsers.fprintf(csv_file, buf);
-	std::fprintf(csv_file, "\n");
+	if (current_item < batch_begin || current_item >= batch_begin + batch_count)
+	{
+		if (loadBatch() == -1)
+			return -1;
+	}
+
+	// Selected records are met in order, as current_item only grows.
+	size_t index = current_item - batch_begin;
+	while (selected < selection.size() && selection[selected] < index)
+		++selected;
+
+	if (selected < selection.size() && selection[selected] == index)
+	{
+		parsers.fprintf(csv_file, batch.data() + index * item_length);
+		for (size_t i = 0; i < derived.size(); ++i)
+		{
+			std::fprintf(csv_file, "%s", FormatSpecifier::instance().get_delimiter());
+			derived[i].fprintf(csv_file, derived_values[i * selection.size() + selected]);
+		}
+		std::fprintf(csv_file, "\n");
+	}
 
 	++current_item;
 
@@ -77,7 +309,8 @@ int CsvStorageConverter::convertAndStore()
 int CsvStorageConverter::storeHeaders()
 {
 	FormatSpecifier& specifier = FormatSpecifier::instance();
-	auto member_infos = parsers.expr("");
+	std::vector<char> record(item_length, 0);
+	auto member_infos = parsers.expr(record.data());
 	int result = 0;
 
 	for (int i = 0; i < member_infos.size(); ++i)
@@ -88,6 +321,10 @@ int CsvStorageConverter::storeHeaders()
 			std::fprintf(csv_file, "%s", specifier.get_delimiter());
 		}
 	}
+	for (auto field = derived.begin(); field != derived.end(); ++field)
+	{
+		std::fprintf(csv_file, "%s%s", specifier.get_delimiter(), field->name.data());
+	}
 	std::fprintf(csv_file, "\n");
 
 	return 0;
@@ -0,0 +1,162 @@
+#include "StorageIndex.h"
+
+#include <algorithm>
+
+using namespace StorageNS;
+
+namespace {
+	const char kINDEX_MAGIC[4] = { 'D', 'S', 'I', 'X' };
+	const uint32_t kINDEX_VERSION = 1;
+	// Count of entries checked against records of binary file on open.
+	const size_t kINDEX_SAMPLES = 64;
+}
+
+int IndexWriter::open(const std::string &index_file, const FieldInfo &field, size_t interval, size_t item_length)
+{
+	if (interval == 0)
+		return -1;
+
+	this->field = field;
+	this->interval = interval;
+	item = 0;
+
+	stream.open(index_file, std::ios::binary | std::ios::out | std::ios::trunc);
+	if (!stream.is_open())
+		return -1;
+
+	IndexHeader header;
+	std::memcpy(header.magic, kINDEX_MAGIC, sizeof(header.magic));
+	header.version = kINDEX_VERSION;
+	header.interval = interval;
+	header.item_length = item_length;
+	header.key_offset = static_cast<uint32_t>(field.offset);
+	header.key_type = field.layoutCode();
+	stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+	return 0;
+}
+
+bool IndexWriter::isOpen()
+{
+	return stream.is_open();
+}
+
+void IndexWriter::write(const char *record)
+{
+	IndexEntry entry;
+	entry.key = field.sortKey(record);
+	entry.item = item;
+	stream.write(reinterpret_cast<const char *>(&entry), sizeof(entry));
+}
+
+void IndexWriter::flush()
+{
+	stream.flush();
+}
+
+int StorageIndex::build(const std::string &source_file, const FieldInfo &field,
+	size_t item_length, size_t interval, const std::string &index_file)
+{
+	MappedFile source;
+	IndexWriter writer;
+
+	if (item_length == 0 || !source.open(source_file))
+		return -1;
+	if (writer.open(index_file, field, interval, item_length) == -1)
+		return -1;
+
+	size_t record_count = source.size() / item_length;
+	for (size_t item = 0; item < record_count; ++item)
+	{
+		writer.append(source.data() + item * item_length);
+	}
+	writer.flush();
+
+	return writer.isOpen() ? 0 : -1;
+}
+
+int StorageIndex::open(const std::string &index_file, const std::string &source_file,
+	const FieldInfo &field, size_t item_length)
+{
+	entries = nullptr;
+	entry_count = 0;
+
+	if (!this->index_file.open(index_file) || this->index_file.size() < sizeof(IndexHeader))
+		return -1;
+
+	IndexHeader header;
+	std::memcpy(&header, this->index_file.data(), sizeof(header));
+	if (std::memcmp(header.magic, kINDEX_MAGIC, sizeof(header.magic)) != 0
+		|| header.version != kINDEX_VERSION
+		|| header.item_length != item_length
+		|| header.key_offset != field.offset
+		|| header.key_type != field.layoutCode())
+	{
+		this->index_file.close();
+		return -1;
+	}
+
+	const IndexEntry *mapped = reinterpret_cast<const IndexEntry *>(this->index_file.data() + sizeof(IndexHeader));
+	size_t mapped_count = (this->index_file.size() - sizeof(IndexHeader)) / sizeof(IndexEntry);
+
+	MappedFile source;
+	if (!source.open(source_file))
+	{
+		this->index_file.close();
+		return -1;
+	}
+
+	// Entries written by store before their records reach binary file are left out.
+	size_t record_count = source.size() / item_length;
+	while (mapped_count > 0 && mapped[mapped_count - 1].item >= record_count)
+	{
+		--mapped_count;
+	}
+
+	bool matched = true;
+	for (size_t i = 0; i < mapped_count && matched; ++i)
+	{
+		matched = mapped[i].item == i * header.interval && (i == 0 || mapped[i - 1].key <= mapped[i].key);
+	}
+
+	// Sampled entries, including the first and the last, should hold keys of records.
+	for (size_t sample = 0; sample <= kINDEX_SAMPLES && mapped_count > 0 && matched; ++sample)
+	{
+		const IndexEntry &entry = mapped[sample * (mapped_count - 1) / kINDEX_SAMPLES];
+		matched = field.sortKey(source.data() + entry.item * item_length) == entry.key;
+	}
+
+	if (!matched)
+	{
+		this->index_file.close();
+		return -1;
+	}
+
+	entries = mapped;
+	entry_count = mapped_count;
+
+	return 0;
+}
+
+void StorageIndex::range(uint64_t begin_key, uint64_t end_key, size_t &begin_item, size_t &end_item)
+{
+	if (entry_count == 0)
+		return;
+
+	const IndexEntry *end = entries + entry_count;
+
+	// Records equal to begin_key may start inside the last block whose first
+	// key is less than begin_key.
+	const IndexEntry *first = std::lower_bound(entries, end, begin_key,
+		[](const IndexEntry &entry, uint64_t key) { return entry.key < key; });
+	if (first != entries)
+		--first;
+
+	// Blocks starting with a key greater than end_key hold no matched record.
+	const IndexEntry *last = std::upper_bound(entries, end, end_key,
+		[](uint64_t key, const IndexEntry &entry) { return key < entry.key; });
+
+	begin_item = std::max<size_t>(begin_item, static_cast<size_t>(first->item));
+	if (last != end)
+		end_item = std::min<size_t>(end_item, static_cast<size_t>(last->item));
+}
@@ -0,0 +1,145 @@
+#include "StoragePredicate.h"
+
+#include <algorithm>
+
+using namespace StorageNS;
+
+namespace {
+	std::string trim(const std::string &text)
+	{
+		const char *kSPACES = " \t\r\n";
+		size_t begin = text.find_first_not_of(kSPACES);
+
+		if (begin == std::string::npos)
+			return std::string();
+
+		return text.substr(begin, text.find_last_not_of(kSPACES) - begin + 1);
+	}
+
+	/**
+	* @brief  Compare with a value between values of field, whose nearest values
+	*         inside it from below and above are given if any.
+	*/
+	void adjustInexact(Predicate &predicate, bool has_low, uint64_t low, bool has_high, uint64_t high)
+	{
+		// A predicate which never matches, or always matches.
+		const Predicate::Operator kNEVER = Predicate::Operator::LESS;
+		const Predicate::Operator kALWAYS = Predicate::Operator::GREATER_EQUAL;
+
+		switch (predicate.op) {
+		case Predicate::Operator::GREATER:
+		case Predicate::Operator::GREATER_EQUAL:
+			predicate.op = has_low ? Predicate::Operator::GREATER_EQUAL : kNEVER;
+			predicate.key = has_low ? low : 0;
+			break;
+		case Predicate::Operator::LESS:
+		case Predicate::Operator::LESS_EQUAL:
+			predicate.op = has_high ? Predicate::Operator::LESS_EQUAL : kNEVER;
+			predicate.key = has_high ? high : 0;
+			break;
+		case Predicate::Operator::EQUAL:
+			predicate.op = kNEVER;
+			predicate.key = 0;
+			break;
+		default:
+			predicate.op = kALWAYS;
+			predicate.key = 0;
+			break;
+		}
+	}
+
+	/**
+	* @brief  Split expression into terms by "&&" or " and ".
+	*/
+	std::vector<std::string> splitTerms(const std::string &expression)
+	{
+		std::vector<std::string> terms;
+		size_t begin = 0;
+
+		while (true)
+		{
+			size_t ampersand = expression.find("&&", begin);
+			size_t word = expression.find(" and ", begin);
+			size_t end = std::min(ampersand, word);
+
+			if (end == std::string::npos) {
+				terms.push_back(expression.substr(begin));
+				break;
+			}
+
+			terms.push_back(expression.substr(begin, end - begin));
+			begin = end + (end == ampersand ? 2 : 5);
+		}
+
+		return terms;
+	}
+}
+
+int StorageNS::parsePredicates(const std::string &expression, SequencedParser &parsers, std::vector<Predicate> &predicates)
+{
+	// Two-character operators are matched before their one-character prefixes.
+	const struct {
+		const char *text;
+		Predicate::Operator op;
+	} kOPERATORS[] = {
+		{ "<=", Predicate::Operator::LESS_EQUAL },
+		{ ">=", Predicate::Operator::GREATER_EQUAL },
+		{ "==", Predicate::Operator::EQUAL },
+		{ "!=", Predicate::Operator::NOT_EQUAL },
+		{ "<", Predicate::Operator::LESS },
+		{ ">", Predicate::Operator::GREATER },
+		{ "=", Predicate::Operator::EQUAL },
+	};
+
+	auto terms = splitTerms(expression);
+	for (auto term = terms.begin(); term != terms.end(); ++term)
+	{
+		if (trim(*term).empty())
+			continue;
+
+		size_t position = std::string::npos;
+		size_t length = 0;
+		Predicate predicate;
+
+		for (size_t i = 0; i < sizeof(kOPERATORS) / sizeof(kOPERATORS[0]); ++i)
+		{
+			position = term->find(kOPERATORS[i].text);
+			if (position != std::string::npos) {
+				length = std::strlen(kOPERATORS[i].text);
+				predicate.op = kOPERATORS[i].op;
+				break;
+			}
+		}
+
+		if (position == std::string::npos)
+			return -1;
+
+		std::string name = trim(term->substr(0, position));
+		std::string value = trim(term->substr(position + length));
+		if (value.empty() || !parsers.findField(name, predicate.field))
+			return -1;
+
+		uint64_t low;
+		uint64_t high;
+		bool has_low;
+		bool has_high;
+		try {
+			has_low = predicate.field.boundKeyOf(value, false, low);
+			has_high = predicate.field.boundKeyOf(value, true, high);
+		}
+		catch (const std::exception &) {
+			return -1;
+		}
+
+		// A value which is not of the field, e.g. 90.5 of an integral field or
+		// -1 of an unsigned one, is compared with its nearest values instead.
+		if (!has_low || !has_high || low != high)
+			adjustInexact(predicate, has_low, low, has_high, high);
+		else
+			predicate.key = low;
+
+		predicates.push_back(predicate);
+	}
+
+	return 0;
+}
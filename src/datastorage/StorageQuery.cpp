@@ -0,0 +1,670 @@
+#include "StorageQuery.h"
+#include "StorageCatalog.h"
+#include "Directory.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+using namespace StorageNS;
+
+namespace {
+	// Count of records in a batch, small enough to keep a batch in cache.
+	const size_t kBATCH_RECORDS = 4096;
+
+	// Formatted result is written to sink in chunks of about this size.
+	const size_t kOUTPUT_FLUSH_SIZE = 64 * 1024;
+
+	const size_t kVALUE_BUFFER_SIZE = 64;
+
+	// Integers of at most this many bits are exact as double.
+	const unsigned kEXACT_DOUBLE_BITS = 53;
+
+	/**
+	* @brief   Check if values of a column are evaluated per batch, i.e. derived,
+	*          scaled and bitfield columns, see FieldInfo::values().
+	**/
+	inline bool isEvaluated(const QueryColumn &column)
+	{
+		return column.derived != -1 || column.field.isScaled()
+			|| (column.field.width != 0 && column.field.width <= kEXACT_DOUBLE_BITS);
+	}
+
+	inline void appendValue(std::string &output, char *buffer, const FieldInfo &field, const char *record)
+	{
+		int length = field.snprintf(buffer, kVALUE_BUFFER_SIZE, record);
+
+		if (length < 0)
+			return;
+
+		if (static_cast<size_t>(length) < kVALUE_BUFFER_SIZE)
+		{
+			output.append(buffer, length);
+		}
+		else
+		{
+			// Long values, e.g. "%f" of huge double, are formatted in place.
+			size_t size = output.size();
+			output.resize(size + length + 1);
+			field.snprintf(&output[size], length + 1, record);
+			output.resize(size + length);
+		}
+	}
+
+	inline void appendDerived(std::string &output, char *buffer, const DerivedField &field, double value)
+	{
+		int length = field.snprintf(buffer, kVALUE_BUFFER_SIZE, value);
+
+		if (length < 0)
+			return;
+
+		if (static_cast<size_t>(length) < kVALUE_BUFFER_SIZE)
+		{
+			output.append(buffer, length);
+		}
+		else
+		{
+			size_t size = output.size();
+			output.resize(size + length + 1);
+			field.snprintf(&output[size], length + 1, value);
+			output.resize(size + length);
+		}
+	}
+
+	inline void appendBits(std::string &output, char *buffer, double value)
+	{
+		int length = std::snprintf(buffer, kVALUE_BUFFER_SIZE, format_specifier<uint64_t>(), static_cast<uint64_t>(value));
+
+		if (length > 0)
+			output.append(buffer, length);
+	}
+
+	// JSON numbers are printed without custom format specifiers, which may
+	// print text other than a JSON number, e.g. "%x" or "%08.2f".
+	inline void appendJsonReal(std::string &output, char *buffer, double value, int digits)
+	{
+		int length = std::snprintf(buffer, kVALUE_BUFFER_SIZE, "%.*g", digits, value);
+
+		if (length > 0)
+			output.append(buffer, length);
+	}
+
+	inline void appendScaled(std::string &output, char *buffer, double value)
+	{
+		int length = std::snprintf(buffer, kVALUE_BUFFER_SIZE, format_specifier<double>(), value);
+
+		if (length < 0)
+			return;
+
+		if (static_cast<size_t>(length) < kVALUE_BUFFER_SIZE)
+		{
+			output.append(buffer, length);
+		}
+		else
+		{
+			size_t size = output.size();
+			output.resize(size + length + 1);
+			std::snprintf(&output[size], length + 1, format_specifier<double>(), value);
+			output.resize(size + length);
+		}
+	}
+}
+
+int QueryTable::open(const std::string &source_file, const std::string &template_file)
+{
+	std::string content = StorageNS::getTextFileContent(template_file.data());
+	configurator = std::unique_ptr<JsonConfigurator>(new JsonConfigurator(content));
+
+	if (!configurator->isValid()){
+		return -1;
+	}
+
+	parsers = configurator->generateParser();
+	item_length = parsers.length();
+	if (item_length == 0)
+	{
+		return -1;
+	}
+	derivation = configurator->derivedFields();
+
+	if (!this->source_file.open(source_file))
+	{
+		return -1;
+	}
+
+	zone_map.open(ZoneMap::sidecarPath(source_file), source_file, item_length);
+	bloom_filter.open(BlockBloomFilter::sidecarPath(source_file), source_file, item_length);
+
+	return 0;
+}
+
+void ScanOperator::setSkipping(const ZoneMap *zone_map, const BlockBloomFilter *bloom_filter,
+	const std::vector<Predicate> *predicates)
+{
+	this->zone_map = zone_map;
+	this->bloom_filter = bloom_filter;
+	this->predicates = predicates;
+}
+
+bool ScanOperator::skipped(size_t item) const
+{
+	if (predicates == nullptr || predicates->empty())
+		return false;
+
+	if (zone_map != nullptr && zone_map->isOpen()
+		&& !zone_map->mayMatch(item / zone_map->blockRecords(), *predicates))
+		return true;
+
+	if (bloom_filter != nullptr && bloom_filter->isOpen()
+		&& !bloom_filter->mayMatch(item / bloom_filter->blockRecords(), *predicates))
+		return true;
+
+	return false;
+}
+
+bool ScanOperator::next(RecordBatch &batch)
+{
+	while (current_item < record_count)
+	{
+		size_t end = std::min(record_count, current_item + batch_records);
+
+		// A batch never crosses a block of zone map or Bloom filter, so the
+		// whole batch is skipped with its block.
+		if (zone_map != nullptr && zone_map->isOpen())
+			end = std::min(end, (current_item / zone_map->blockRecords() + 1) * zone_map->blockRecords());
+		if (bloom_filter != nullptr && bloom_filter->isOpen())
+			end = std::min(end, (current_item / bloom_filter->blockRecords() + 1) * bloom_filter->blockRecords());
+
+		size_t begin = current_item;
+		current_item = end;
+		if (skipped(begin))
+			continue;
+
+		batch.records = data + begin * item_length;
+		batch.first_item = begin;
+		batch.selection.resize(end - begin);
+		for (size_t i = 0; i < batch.selection.size(); ++i)
+		{
+			batch.selection[i] = static_cast<uint32_t>(i);
+		}
+
+		return true;
+	}
+
+	return false;
+}
+
+bool FilterOperator::next(RecordBatch &batch)
+{
+	while (child.next(batch))
+	{
+		for (auto predicate = predicates.begin(); predicate != predicates.end() && !batch.selection.empty(); ++predicate)
+		{
+			size_t selected = 0;
+			for (size_t i = 0; i < batch.selection.size(); ++i)
+			{
+				uint32_t index = batch.selection[i];
+				batch.selection[selected] = index;
+				selected += predicate->match(batch.records + index * item_length) ? 1 : 0;
+			}
+			batch.selection.resize(selected);
+		}
+
+		if (!batch.selection.empty())
+			return true;
+	}
+
+	return false;
+}
+
+bool LimitOperator::next(RecordBatch &batch)
+{
+	if (remaining == 0 || !child.next(batch))
+		return false;
+
+	if (batch.selection.size() > remaining)
+		batch.selection.resize(remaining);
+	remaining -= batch.selection.size();
+
+	return true;
+}
+
+bool ProjectOperator::next(RecordBatch &batch)
+{
+	if (!child.next(batch))
+		return false;
+
+	for (size_t i = 0; i < columns_.size(); ++i)
+	{
+		const QueryColumn &column = columns_[i];
+
+		if (column.derived != -1)
+		{
+			values[i].resize(batch.selection.size());
+			derived[column.derived].expression.evaluate(batch.records, item_length, batch.selection.data(),
+				batch.selection.size(), values[i].data(), stack);
+		}
+		else if (isEvaluated(column))
+		{
+			values[i].resize(batch.selection.size());
+			column.field.values(batch.records, item_length, batch.selection.data(), batch.selection.size(), values[i].data());
+		}
+	}
+
+	return true;
+}
+
+void StorageQuery::setBinarySource(const std::string &source_file)
+{
+	source = source_file;
+}
+
+void StorageQuery::setTargetFile(const std::string &target_file)
+{
+	target = target_file;
+}
+
+void StorageQuery::setTemplate(const std::string &template_file)
+{
+	template_ = template_file;
+}
+
+void StorageQuery::setSelect(const std::vector<std::string> &fields)
+{
+	select_names = fields;
+}
+
+void StorageQuery::setFilter(const std::string &expression)
+{
+	filter = expression;
+}
+
+void StorageQuery::setDerivedFields(const std::string &declarations)
+{
+	derivation = declarations;
+}
+
+void StorageQuery::setLimit(size_t limit)
+{
+	this->limit = limit;
+}
+
+void StorageQuery::setFormat(Format format)
+{
+	this->format = format;
+}
+
+long long StorageQuery::run()
+{
+	bool dataset = isDirectory(source);
+	QueryTable table;
+	if (!dataset && table.open(source, template_) == -1)
+	{
+		return -1;
+	}
+
+	std::FILE *fp = target.empty() ? stdout : std::fopen(target.data(), "w+");
+	if (fp == nullptr)
+	{
+		return -1;
+	}
+
+	FileQuerySink sink(fp);
+	long long count = dataset ? runDataset(sink) : run(table, sink);
+
+	if (fp != stdout)
+		std::fclose(fp);
+	else
+		std::fflush(fp);
+
+	return count;
+}
+
+long long StorageQuery::run(QueryTable &table, QuerySink &sink)
+{
+	std::vector<QueryColumn> columns;
+	std::vector<DerivedField> derived;
+	std::vector<Predicate> predicates;
+	if (compile(table.parsers, table.derivation, columns, derived, predicates) == -1)
+	{
+		return -1;
+	}
+
+	bool first = true;
+	std::string output;
+
+	formatHeader(output, columns);
+	long long count = scan(table, columns, derived, predicates, limit == 0 ? static_cast<size_t>(-1) : limit,
+		output, &sink, first);
+	if (count == -1)
+	{
+		return -1;
+	}
+	formatFooter(output);
+
+	if (!output.empty() && !sink.write(output.data(), output.size()))
+		return -1;
+
+	return count;
+}
+
+long long StorageQuery::runDataset(QuerySink &sink)
+{
+	StorageCatalog catalog;
+	if (catalog.open(source, template_) == -1)
+	{
+		return -1;
+	}
+
+	std::vector<QueryColumn> columns;
+	std::vector<DerivedField> derived;
+	std::vector<Predicate> predicates;
+	if (compile(catalog.parsers(), catalog.derivedFields(), columns, derived, predicates) == -1)
+	{
+		return -1;
+	}
+
+	std::vector<std::string> files = catalog.select(0, ~0ULL, predicates);
+	size_t item_length = catalog.parsers().length();
+	size_t remaining = limit == 0 ? static_cast<size_t>(-1) : limit;
+	size_t window = std::max(1u, std::thread::hardware_concurrency());
+	long long count = 0;
+	std::string output;
+
+	// Files of a window are scanned in parallel into memory, and then written
+	// in order of time, so that at most a window of results is kept.
+	formatHeader(output, columns);
+	for (size_t begin = 0; begin < files.size() && remaining > 0; begin += window)
+	{
+		size_t end = std::min(files.size(), begin + window);
+		std::vector<std::string> outputs(end - begin);
+		std::vector<long long> counts(end - begin, -1);
+
+		auto worker = [&](size_t i) {
+			QueryTable table;
+			bool first = true;
+
+			if (table.open(files[begin + i], template_) == 0 && table.item_length == item_length)
+				counts[i] = scan(table, columns, derived, predicates, remaining, outputs[i], nullptr, first);
+		};
+
+		std::vector<std::thread> threads;
+		for (size_t i = 1; i < end - begin; ++i)
+		{
+			threads.emplace_back(worker, i);
+		}
+		worker(0);
+		for (auto thread = threads.begin(); thread != threads.end(); ++thread)
+		{
+			thread->join();
+		}
+
+		for (size_t i = 0; i < outputs.size() && remaining > 0; ++i)
+		{
+			if (counts[i] == -1)
+				return -1;
+
+			size_t kept = std::min(static_cast<size_t>(counts[i]), remaining);
+			keepRecords(outputs[i], kept);
+			if (format == Format::JSON && count > 0 && kept > 0)
+				output += ",";
+			output += outputs[i];
+			count += static_cast<long long>(kept);
+			remaining -= kept;
+
+			if (output.size() >= kOUTPUT_FLUSH_SIZE)
+			{
+				if (!sink.write(output.data(), output.size()))
+					return -1;
+				output.clear();
+			}
+		}
+	}
+	formatFooter(output);
+
+	if (!output.empty() && !sink.write(output.data(), output.size()))
+		return -1;
+
+	return count;
+}
+
+int StorageQuery::compile(SequencedParser &parsers, const std::string &schema_derivation, std::vector<QueryColumn> &columns,
+	std::vector<DerivedField> &derived, std::vector<Predicate> &predicates)
+{
+	derived.clear();
+	if (parseDerivedFields(schema_derivation + ";" + derivation, parsers, derived) == -1)
+	{
+		return -1;
+	}
+
+	columns.clear();
+	if (select_names.empty())
+	{
+		auto fields = parsers.fields();
+		for (auto field = fields.begin(); field != fields.end(); ++field)
+		{
+			QueryColumn column;
+			column.field = *field;
+			columns.push_back(column);
+		}
+		for (size_t i = 0; i < derived.size(); ++i)
+		{
+			QueryColumn column;
+			column.field.name = derived[i].name;
+			column.derived = static_cast<int>(i);
+			columns.push_back(column);
+		}
+	}
+	for (auto name = select_names.begin(); name != select_names.end(); ++name)
+	{
+		QueryColumn column;
+		for (size_t i = 0; i < derived.size() && column.derived == -1; ++i)
+		{
+			if (derived[i].name == *name)
+				column.derived = static_cast<int>(i);
+		}
+		if (column.derived == -1 && !parsers.findField(*name, column.field))
+		{
+			return -1;
+		}
+		column.field.name = *name;
+		columns.push_back(column);
+	}
+
+	predicates.clear();
+	return parsePredicates(filter, parsers, predicates);
+}
+
+long long StorageQuery::scan(QueryTable &table, const std::vector<QueryColumn> &columns, const std::vector<DerivedField> &derived,
+	const std::vector<Predicate> &predicates, size_t limit, std::string &output, QuerySink *sink, bool &first)
+{
+	size_t item_length = table.item_length;
+	ScanOperator scan(table.source_file.data(), table.source_file.size() / item_length, item_length, kBATCH_RECORDS);
+	scan.setSkipping(&table.zone_map, &table.bloom_filter, &predicates);
+	FilterOperator filter_operator(scan, item_length, predicates);
+	LimitOperator limit_operator(filter_operator, limit);
+	ProjectOperator project(limit_operator, item_length, columns, derived);
+
+	long long count = 0;
+	RecordBatch batch;
+
+	while (project.next(batch))
+	{
+		formatBatch(output, batch, item_length, project, derived, first);
+		count += static_cast<long long>(batch.selection.size());
+
+		if (sink != nullptr && output.size() >= kOUTPUT_FLUSH_SIZE)
+		{
+			if (!sink->write(output.data(), output.size()))
+				return -1;
+			output.clear();
+		}
+	}
+
+	return count;
+}
+
+void StorageQuery::keepRecords(std::string &output, size_t count)
+{
+	// Every record takes one line, a JSON record line starts with line break
+	// and is preceded by a comma except the first one.
+	if (count == 0)
+	{
+		output.clear();
+		return;
+	}
+
+	size_t position = 0;
+	for (size_t i = 0; i < count + (format == Format::JSON ? 1 : 0); ++i)
+	{
+		position = output.find('\n', i == 0 ? 0 : position + 1);
+		if (position == std::string::npos)
+			return;
+	}
+
+	if (format == Format::JSON)
+		output.resize(position - 1);
+	else
+		output.resize(position + 1);
+}
+
+void StorageQuery::formatHeader(std::string &output, const std::vector<QueryColumn> &columns)
+{
+	if (format == Format::JSON)
+	{
+		output += "[";
+		return;
+	}
+
+	FormatSpecifier& specifier = FormatSpecifier::instance();
+	for (size_t i = 0; i < columns.size(); ++i)
+	{
+		output += columns[i].field.name;
+		if (specifier.get_header_units() && !columns[i].field.unit.empty())
+		{
+			output += " [" + columns[i].field.unit + "]";
+		}
+		if (i != columns.size() - 1)
+		{
+			output += specifier.get_delimiter();
+		}
+	}
+	output += "\n";
+}
+
+void StorageQuery::formatBatch(std::string &output, const RecordBatch &batch, size_t item_length,
+	const ProjectOperator &project, const std::vector<DerivedField> &derived, bool &first)
+{
+	FormatSpecifier& specifier = FormatSpecifier::instance();
+	const char *delimiter = specifier.get_delimiter();
+	const std::vector<QueryColumn> &columns = project.columns();
+	char buffer[kVALUE_BUFFER_SIZE];
+
+	for (size_t row = 0; row < batch.selection.size(); ++row)
+	{
+		const char *record = batch.records + batch.selection[row] * item_length;
+
+		if (format == Format::JSON)
+		{
+			output += first ? "\n{" : ",\n{";
+			first = false;
+		}
+
+		for (size_t i = 0; i < columns.size(); ++i)
+		{
+			const QueryColumn &column = columns[i];
+			bool evaluated = isEvaluated(column);
+			double value = evaluated ? project.columnValues(i)[row] : 0;
+
+			if (format == Format::CSV)
+			{
+				if (i != 0)
+					output += delimiter;
+			}
+			else
+			{
+				if (i != 0)
+					output += ", ";
+				appendJsonString(output, column.field.name.data(), column.field.name.size());
+				output += ": ";
+			}
+
+			// Labels are copied as rendered, JSON strings are quoted.
+			if (column.field.labels)
+			{
+				const EnumTable::Entry *entry = column.field.label(record);
+				if (entry != nullptr)
+				{
+					output += format == Format::JSON ? entry->quoted : entry->label;
+					continue;
+				}
+			}
+
+			// Timestamps are formatted as ISO-8601, JSON strings are quoted.
+			if (column.field.ticks != 0)
+			{
+				if (format == Format::JSON)
+					output += '"';
+				appendValue(output, buffer, column.field, record);
+				if (format == Format::JSON)
+					output += '"';
+				continue;
+			}
+
+			// Characters are copied up to their '\0'.
+			if (!column.field.isNumeric())
+			{
+				const char *text = record + column.field.offset;
+				if (format == Format::JSON)
+					appendJsonString(output, text, column.field.textLength(record));
+				else
+					output.append(text, column.field.textLength(record));
+				continue;
+			}
+
+			if (format == Format::JSON)
+			{
+				// JSON has no literal of NaN or infinity.
+				bool finite = evaluated
+					? std::isfinite(value)
+					: column.field.isIntegral() || std::isfinite(column.field.value(record));
+				if (!finite)
+				{
+					output += "null";
+					continue;
+				}
+
+				if (column.derived != -1)
+				{
+					char stored[sizeof(uint64_t)];
+					derived[column.derived].store(value, stored);
+					derived[column.derived].format.appendJson(output, stored);
+				}
+				else if (evaluated)
+					appendJsonReal(output, buffer, value, 17);
+				else
+					column.field.appendJson(output, record);
+				continue;
+			}
+
+			if (column.derived != -1)
+				appendDerived(output, buffer, derived[column.derived], value);
+			else if (evaluated && column.field.isIntegral())
+				appendBits(output, buffer, value);
+			else if (evaluated)
+				appendScaled(output, buffer, value);
+			else
+				appendValue(output, buffer, column.field, record);
+		}
+
+		output += format == Format::JSON ? "}" : "\n";
+	}
+}
+
+void StorageQuery::formatFooter(std::string &output)
+{
+	if (format == Format::JSON)
+	{
+		output += "\n]\n";
+	}
+}
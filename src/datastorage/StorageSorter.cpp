@@ -0,0 +1,321 @@
+#include "StorageSorter.h"
+#include "Directory.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+
+using namespace StorageNS;
+
+namespace {
+	// Size of output buffer gathering sorted records before writing.
+	const size_t kWRITE_BUFFER_SIZE = 4 * 1024 * 1024;
+
+	/**
+	* Buffered sequential reader of one sorted run file.
+	*/
+	struct RunReader {
+		RunReader(const std::string &file, size_t item_length, size_t buffer_records)
+			:item_length(item_length), count(0), position(0),
+			buffer(item_length * buffer_records)
+		{
+			stream.open(file, std::ios::binary | std::ios::in);
+		}
+
+		/**
+		* @brief  Read next block of records, returns false if no more record.
+		*/
+		bool fill()
+		{
+			stream.read(buffer.data(), buffer.size());
+			count = static_cast<size_t>(stream.gcount()) / item_length;
+			position = 0;
+			return count > 0;
+		}
+
+		/**
+		* @brief  Move to next record, returns false if no more record.
+		*/
+		bool next()
+		{
+			if (++position < count)
+				return true;
+			return fill();
+		}
+
+		const char *current() const
+		{
+			return buffer.data() + position * item_length;
+		}
+
+		std::ifstream stream;
+		size_t item_length;
+		size_t count;
+		size_t position;
+		std::vector<char> buffer;
+	};
+
+	/**
+	* Buffered sequential writer of records.
+	*/
+	struct RecordWriter {
+		RecordWriter(const std::string &file)
+		{
+			stream.open(file, std::ios::binary | std::ios::out | std::ios::trunc);
+			buffer.reserve(kWRITE_BUFFER_SIZE);
+		}
+
+		~RecordWriter()
+		{
+			flush();
+		}
+
+		void write(const char *record, size_t length)
+		{
+			if (buffer.size() + length > kWRITE_BUFFER_SIZE)
+				flush();
+			buffer.insert(buffer.end(), record, record + length);
+		}
+
+		void flush()
+		{
+			stream.write(buffer.data(), buffer.size());
+			buffer.clear();
+		}
+
+		std::ofstream stream;
+		std::vector<char> buffer;
+	};
+}
+
+void StorageSorter::setBinarySource(const std::string &source_file)
+{
+	source = source_file;
+}
+
+void StorageSorter::setTargetFile(const std::string &target_file)
+{
+	target = target_file;
+}
+
+void StorageSorter::setTemplate(const std::string &template_file)
+{
+	template_ = template_file;
+}
+
+void StorageSorter::setKeyField(const std::string &field)
+{
+	key_name = field;
+}
+
+void StorageSorter::setMemoryLimit(size_t bytes)
+{
+	memory_limit = bytes;
+}
+
+void StorageSorter::setRunPrefix(const std::string &prefix)
+{
+	run_prefix = prefix;
+}
+
+int StorageSorter::sort()
+{
+	std::string content = StorageNS::getTextFileContent(template_.data());
+	configurator = std::unique_ptr<JsonConfigurator>(new JsonConfigurator(content));
+
+	if (!configurator->isValid()){
+		return -1;
+	}
+
+	parsers = configurator->generateParser();
+	item_length = parsers.length();
+	if (item_length == 0 || !parsers.findField(key_name, key_field) || !key_field.isNumeric())
+	{
+		return -1;
+	}
+
+	if (isSameFile(source, target) || !source_file.open(source))
+	{
+		return -1;
+	}
+
+	size_t record_count = source_file.size() / item_length;
+
+	// Every record in a run costs its bytes in output buffer plus double
+	// buffered key and record number.
+	size_t record_cost = item_length + 2 * (sizeof(uint64_t) + sizeof(uint32_t));
+	size_t run_records = std::max<size_t>(1, memory_limit / record_cost);
+	run_records = std::min<size_t>(run_records, std::numeric_limits<uint32_t>::max());
+
+	if (record_count <= run_records)
+	{
+		return sortRun(0, record_count, target);
+	}
+
+	std::string prefix = run_prefix.empty() ? target : run_prefix;
+	std::vector<std::string> runs;
+	int result = 0;
+
+	for (size_t begin = 0; begin < record_count && result == 0; begin += run_records)
+	{
+		runs.push_back(prefix + ".run" + to_string(runs.size()));
+		result = sortRun(begin, std::min(record_count, begin + run_records), runs.back());
+	}
+
+	if (result == 0)
+	{
+		result = mergeRuns(runs);
+	}
+
+	for (auto run = runs.begin(); run != runs.end(); ++run)
+	{
+		std::remove(run->data());
+	}
+
+	return result;
+}
+
+int StorageSorter::sortRun(size_t begin, size_t end, const std::string &file)
+{
+	const size_t kRADIX_BITS = 8;
+	const size_t kRADIX_SIZE = 1 << kRADIX_BITS;
+	const size_t kPASSES = sizeof(uint64_t) * 8 / kRADIX_BITS;
+
+	const char *base = source_file.data() + begin * item_length;
+	size_t count = end - begin;
+
+	std::vector<uint64_t> keys(count), sorted_keys(count);
+	std::vector<uint32_t> items(count), sorted_items(count);
+	std::vector<size_t> histograms(kPASSES * kRADIX_SIZE, 0);
+
+	// Extract keys and build histograms of all digits in one pass.
+	for (size_t i = 0; i < count; ++i)
+	{
+		uint64_t key = key_field.sortKey(base + i * item_length);
+		keys[i] = key;
+		items[i] = static_cast<uint32_t>(i);
+		for (size_t pass = 0; pass < kPASSES; ++pass)
+		{
+			++histograms[pass * kRADIX_SIZE + ((key >> (pass * kRADIX_BITS)) & (kRADIX_SIZE - 1))];
+		}
+	}
+
+	// Least significant digit first, every pass is stable so equal keys keep
+	// their source order. A pass where all keys share one digit is skipped.
+	for (size_t pass = 0; pass < kPASSES && count > 0; ++pass)
+	{
+		size_t *histogram = &histograms[pass * kRADIX_SIZE];
+		size_t shift = pass * kRADIX_BITS;
+
+		if (histogram[(keys[0] >> shift) & (kRADIX_SIZE - 1)] == count)
+			continue;
+
+		size_t offset = 0;
+		for (size_t digit = 0; digit < kRADIX_SIZE; ++digit)
+		{
+			size_t digit_count = histogram[digit];
+			histogram[digit] = offset;
+			offset += digit_count;
+		}
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			size_t position = histogram[(keys[i] >> shift) & (kRADIX_SIZE - 1)]++;
+			sorted_keys[position] = keys[i];
+			sorted_items[position] = items[i];
+		}
+
+		keys.swap(sorted_keys);
+		items.swap(sorted_items);
+	}
+
+	RecordWriter writer(file);
+	if (!writer.stream.is_open())
+	{
+		return -1;
+	}
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		writer.write(base + items[i] * item_length, item_length);
+	}
+	writer.flush();
+
+	return writer.stream.good() ? 0 : -1;
+}
+
+int StorageSorter::mergeRuns(const std::vector<std::string> &runs)
+{
+	size_t k = runs.size();
+	size_t buffer_records = std::max<size_t>(1, memory_limit / (k + 1) / item_length);
+
+	std::vector<std::unique_ptr<RunReader>> readers;
+	std::vector<uint64_t> keys(k);
+	std::vector<bool> exhausted(k);
+
+	for (size_t i = 0; i < k; ++i)
+	{
+		readers.emplace_back(new RunReader(runs[i], item_length, buffer_records));
+		if (!readers[i]->stream.is_open())
+		{
+			return -1;
+		}
+		exhausted[i] = !readers[i]->fill();
+		if (!exhausted[i])
+			keys[i] = key_field.sortKey(readers[i]->current());
+	}
+
+	// Index k is a sentinel beating every run, used only while building tree.
+	// Exhausted runs lose to every other run, and ties are won by the earlier
+	// run to keep the merge stable.
+	auto beats = [&](size_t a, size_t b) {
+		if (a == k)
+			return true;
+		if (b == k)
+			return false;
+		if (exhausted[a] || exhausted[b])
+			return !exhausted[a];
+		return keys[a] < keys[b] || (keys[a] == keys[b] && a < b);
+	};
+
+	// tree[0] holds the winner, and tree[1, k) hold losers of inner matches.
+	std::vector<size_t> tree(k, k);
+	auto adjust = [&](size_t run) {
+		for (size_t node = (run + k) / 2; node > 0; node /= 2)
+		{
+			if (beats(tree[node], run))
+				std::swap(run, tree[node]);
+		}
+		tree[0] = run;
+	};
+
+	for (size_t run = k; run > 0; --run)
+	{
+		adjust(run - 1);
+	}
+
+	RecordWriter writer(target);
+	if (!writer.stream.is_open())
+	{
+		return -1;
+	}
+
+	while (!exhausted[tree[0]])
+	{
+		size_t winner = tree[0];
+		RunReader &reader = *readers[winner];
+
+		writer.write(reader.current(), item_length);
+		if (reader.next()) {
+			keys[winner] = key_field.sortKey(reader.current());
+		}
+		else {
+			exhausted[winner] = true;
+		}
+		adjust(winner);
+	}
+	writer.flush();
+
+	return writer.stream.good() ? 0 : -1;
+}
@@ -1,9 +1,21 @@
 #include "StorageTask.h"
 
+#include <algorithm>
 #include <iostream>
 
 using namespace StorageNS;
 
+void StorageTask::setIndex(const std::string &field, size_t interval)
+{
+	index_name = field;
+	index_interval = interval;
+}
+
+void StorageTask::setBTree(const std::string &field)
+{
+	btree_name = field;
+}
+
 int StorageTask::config(const char *config_file, const char *binary_file)
 {
 	std::string content = StorageNS::getTextFileContent("type.json");
@@ -13,19 +25,146 @@ int StorageTask::config(const char *config_file, const char *binary_file)
 	if (!configurator->isValid()){
 		return -1;
 	}
+
+	has_messages = configurator->hasMessages();
+	if (has_messages)
+	{
+		if (configurator->generateMessages(dispatcher) == -1 || !dispatcher.isFixedLength())
+		{
+			return -1;
+		}
+		if (!index_name.empty() || !btree_name.empty())
+		{
+			return -1;
+		}
+		valid_data_length = static_cast<int>(dispatcher.tagField().size());
+		max_message_length = 0;
+		for (size_t i = 0; i < dispatcher.messageCount(); ++i)
+		{
+			max_message_length = std::max(max_message_length, static_cast<int>(dispatcher.message(i).parsers.length()));
+		}
+		pending_message = -1;
+		stream_failed = false;
+		binary_stream.open(binary_file, std::ios::binary|std::ios::out|std::ios::trunc);
+		stored_item = 0;
+
+		return 0;
+	}
+
+	// Records are received by length, members present_if or sized by a field are not supported.
 	parsers = configurator->generateParser();
+	if (!parsers.isFixedLength())
+	{
+		return -1;
+	}
 	valid_data_length = static_cast<int>(parsers.length());
 
 	binary_stream.open(binary_file, std::ios::binary|std::ios::out|std::ios::trunc);
 
+	if (!index_name.empty())
+	{
+		FieldInfo field;
+		if (!parsers.findField(index_name, field) || !field.isNumeric())
+		{
+			return -1;
+		}
+		if (index_writer.open(StorageIndex::sidecarPath(binary_file), field, index_interval, parsers.length()) == -1)
+		{
+			return -1;
+		}
+	}
+
+	if (!btree_name.empty())
+	{
+		if (!parsers.findField(btree_name, btree_field) || !btree_field.isNumeric())
+		{
+			return -1;
+		}
+		if (btree_writer.create(BTreeWriter::sidecarPath(binary_file, btree_name), btree_field, parsers.length()) == -1)
+		{
+			return -1;
+		}
+	}
+	stored_item = 0;
+
 	return 0;
 }
 
 void StorageTask::run()
 {
+	if (has_messages)
+	{
+		runMessage();
+		return ;
+	}
+
 	buffer_t buffer = receiver.receive(valid_data_length);
 	if (buffer.length == valid_data_length)
 	{
 		binary_stream.write(buffer.data.get(), buffer.length);
+		if (index_writer.isOpen())
+		{
+			index_writer.append(buffer.data.get());
+		}
+		if (btree_writer.isOpen())
+		{
+			btree_writer.insert(btree_field.sortKey(buffer.data.get()), stored_item);
+		}
+		++stored_item;
+	}
+}
+
+void StorageTask::runMessage()
+{
+	if (!receiver.isMessageOriented())
+	{
+		runStreamMessage();
+		return ;
+	}
+
+	// A datagram is received whole, so a bad one is dropped alone.
+	buffer_t buffer = receiver.receiveMessage(max_message_length);
+	if (buffer.length < static_cast<size_t>(valid_data_length))
+		return ;
+
+	int message = dispatcher.find(buffer.data.get());
+	if (message == -1 || buffer.length != dispatcher.message(message).parsers.length())
+		return ;
+
+	binary_stream.write(buffer.data.get(), buffer.length);
+	++stored_item;
+}
+
+void StorageTask::runStreamMessage()
+{
+	if (stream_failed)
+		return ;
+
+	if (pending_message == -1)
+	{
+		pending_tag = receiver.receive(valid_data_length);
+		if (pending_tag.length != static_cast<size_t>(valid_data_length))
+			return ;
+
+		pending_message = dispatcher.find(pending_tag.data.get());
+		if (pending_message == -1)
+		{
+			// Length of a message of unknown tag is unknown, so are the
+			// boundaries of all messages following it.
+			std::cerr << "Unknown message tag " << dispatcher.tagField().integer(pending_tag.data.get())
+				<< " after " << stored_item << " messages, storing stopped." << std::endl;
+			stream_failed = true;
+			return ;
+		}
+	}
+
+	int remaining = static_cast<int>(dispatcher.message(pending_message).parsers.length()) - valid_data_length;
+	buffer_t buffer = receiver.receive(remaining);
+	if (buffer.length == static_cast<size_t>(remaining))
+	{
+		binary_stream.write(pending_tag.data.get(), pending_tag.length);
+		binary_stream.write(buffer.data.get(), buffer.length);
+		pending_message = -1;
+		++stored_item;
 	}
 }
\ No newline at end of file
@@ -0,0 +1,160 @@
+#include "StorageZoneMap.h"
+#include "Directory.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <thread>
+
+using namespace StorageNS;
+
+namespace {
+	const char kZONE_MAP_MAGIC[4] = { 'D', 'S', 'Z', 'M' };
+	const uint32_t kZONE_MAP_VERSION = 2;
+}
+
+int ZoneMap::build(const std::string &source_file, const std::vector<FieldInfo> &fields,
+	size_t item_length, size_t block_records, const std::string &zone_map_file)
+{
+	MappedFile source;
+	FileStatus status;
+
+	// Status is taken before mapping, a file appended meanwhile is not matched later.
+	if (item_length == 0 || block_records == 0 || fields.empty()
+		|| !statFile(source_file, status) || !source.open(source_file))
+		return -1;
+
+	size_t record_count = source.size() / item_length;
+	size_t block_count = (record_count + block_records - 1) / block_records;
+	size_t field_count = fields.size();
+	std::vector<Zone> zones(block_count * field_count);
+	std::atomic<size_t> next_block(0);
+
+	auto worker = [&]() {
+		for (size_t block = next_block++; block < block_count; block = next_block++)
+		{
+			size_t begin = block * block_records;
+			size_t end = std::min(record_count, begin + block_records);
+			Zone *block_zones = &zones[block * field_count];
+
+			for (size_t i = 0; i < field_count; ++i)
+			{
+				block_zones[i].min = ~0ULL;
+				block_zones[i].max = 0;
+			}
+
+			for (size_t item = begin; item < end; ++item)
+			{
+				const char *record = source.data() + item * item_length;
+				for (size_t i = 0; i < field_count; ++i)
+				{
+					uint64_t key = fields[i].sortKey(record);
+					block_zones[i].min = std::min(block_zones[i].min, key);
+					block_zones[i].max = std::max(block_zones[i].max, key);
+				}
+			}
+		}
+	};
+
+	size_t thread_count = std::min<size_t>(std::max<size_t>(block_count, 1),
+		std::max(1u, std::thread::hardware_concurrency()));
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < thread_count; ++i)
+	{
+		threads.emplace_back(worker);
+	}
+	worker();
+	for (auto thread = threads.begin(); thread != threads.end(); ++thread)
+	{
+		thread->join();
+	}
+
+	std::ofstream stream(zone_map_file, std::ios::binary | std::ios::out | std::ios::trunc);
+	if (!stream.is_open())
+		return -1;
+
+	ZoneMapHeader header;
+	std::memcpy(header.magic, kZONE_MAP_MAGIC, sizeof(header.magic));
+	header.version = kZONE_MAP_VERSION;
+	header.block_records = block_records;
+	header.item_length = item_length;
+	header.block_count = block_count;
+	header.field_count = static_cast<uint32_t>(field_count);
+	header.reserved = 0;
+	header.source_size = status.size;
+	header.source_modified = status.modified;
+	stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+	for (auto field = fields.begin(); field != fields.end(); ++field)
+	{
+		ZoneMapField zone_field;
+		zone_field.offset = static_cast<uint32_t>(field->offset);
+		zone_field.type = field->layoutCode();
+		stream.write(reinterpret_cast<const char *>(&zone_field), sizeof(zone_field));
+	}
+
+	stream.write(reinterpret_cast<const char *>(zones.data()), zones.size() * sizeof(Zone));
+
+	return stream.good() ? 0 : -1;
+}
+
+int ZoneMap::open(const std::string &zone_map_file, const std::string &source_file, size_t item_length)
+{
+	FileStatus status;
+
+	header = nullptr;
+
+	if (!statFile(source_file, status) || !this->zone_map_file.open(zone_map_file)
+		|| this->zone_map_file.size() < sizeof(ZoneMapHeader))
+		return -1;
+
+	const ZoneMapHeader *mapped = reinterpret_cast<const ZoneMapHeader *>(this->zone_map_file.data());
+	size_t expected_size = sizeof(ZoneMapHeader) + mapped->field_count * sizeof(ZoneMapField)
+		+ mapped->block_count * mapped->field_count * sizeof(Zone);
+
+	if (std::memcmp(mapped->magic, kZONE_MAP_MAGIC, sizeof(mapped->magic)) != 0
+		|| mapped->version != kZONE_MAP_VERSION
+		|| mapped->item_length != item_length
+		|| mapped->block_records == 0
+		|| mapped->source_size != status.size
+		|| mapped->source_modified != status.modified
+		|| this->zone_map_file.size() != expected_size)
+	{
+		this->zone_map_file.close();
+		return -1;
+	}
+
+	header = mapped;
+	fields = reinterpret_cast<const ZoneMapField *>(this->zone_map_file.data() + sizeof(ZoneMapHeader));
+	zones = reinterpret_cast<const Zone *>(fields + header->field_count);
+
+	return 0;
+}
+
+int ZoneMap::fieldIndex(const FieldInfo &field) const
+{
+	for (uint32_t i = 0; i < header->field_count; ++i)
+	{
+		if (fields[i].offset == field.offset && fields[i].type == field.layoutCode())
+			return static_cast<int>(i);
+	}
+
+	return -1;
+}
+
+bool ZoneMap::mayMatch(size_t block, const std::vector<Predicate> &predicates) const
+{
+	if (block >= header->block_count)
+		return true;
+
+	const Zone *block_zones = zones + block * header->field_count;
+
+	for (auto predicate = predicates.begin(); predicate != predicates.end(); ++predicate)
+	{
+		int index = fieldIndex(predicate->field);
+		if (index != -1 && !predicate->mayMatch(block_zones[index].min, block_zones[index].max))
+			return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,274 @@
+#include "TopKConverter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <thread>
+#include <unordered_map>
+
+using namespace StorageNS;
+
+namespace {
+	// Count of records scanned by a worker at a time.
+	const size_t kBLOCK_RECORDS = 64 * 1024;
+
+	// Key is of FieldInfo::sortKey(), so 64-bit integers rank exactly.
+	struct Candidate {
+		uint64_t key;
+		size_t item;
+	};
+
+	// Larger key ranks first, and earlier record ranks first on ties.
+	inline bool ranksBefore(const Candidate &a, const Candidate &b)
+	{
+		return a.key > b.key || (a.key == b.key && a.item < b.item);
+	}
+
+	// Bounded heap keeping the best K candidates, its front is the worst kept.
+	inline void offer(std::vector<Candidate> &heap, size_t k, const Candidate &candidate)
+	{
+		if (heap.size() < k) {
+			heap.push_back(candidate);
+			std::push_heap(heap.begin(), heap.end(), ranksBefore);
+		}
+		else if (ranksBefore(candidate, heap.front())) {
+			std::pop_heap(heap.begin(), heap.end(), ranksBefore);
+			heap.back() = candidate;
+			std::push_heap(heap.begin(), heap.end(), ranksBefore);
+		}
+	}
+
+	// Heaps of key field values, keyed by FieldInfo::sortKey(), so scaled and
+	// floating point values are kept apart.
+	typedef std::unordered_map<uint64_t, std::vector<Candidate>> KeyedHeaps;
+}
+
+TopKStorageConverter::~TopKStorageConverter()
+{
+	if (csv_file != nullptr)
+		std::fclose(csv_file);
+}
+
+void TopKStorageConverter::setField(const std::string &field)
+{
+	field_name = field;
+}
+
+void TopKStorageConverter::setCount(size_t count)
+{
+	this->count = count;
+}
+
+void TopKStorageConverter::setKeyField(const std::string &field)
+{
+	key_name = field;
+}
+
+void TopKStorageConverter::setSelect(const std::vector<std::string> &fields)
+{
+	select_names = fields;
+}
+
+void TopKStorageConverter::setAscending(bool ascending)
+{
+	this->ascending = ascending;
+}
+
+int TopKStorageConverter::prepare()
+{
+	std::string content = StorageNS::getTextFileContent(template_.data());
+	configurator = std::unique_ptr<JsonConfigurator>(new JsonConfigurator(content));
+
+	if (!configurator->isValid()){
+		return -1;
+	}
+
+	parsers = configurator->generateParser();
+	item_length = parsers.length();
+	// Selected source fields are printed, derived fields do not apply.
+	if (item_length == 0 || count == 0 || !derivation.empty())
+	{
+		return -1;
+	}
+
+	if (!parsers.findField(field_name, field) || !field.isNumeric())
+	{
+		return -1;
+	}
+
+	bool keyed = !key_name.empty();
+	if (keyed && (!parsers.findField(key_name, key_field) || !key_field.isNumeric()))
+	{
+		return -1;
+	}
+
+	select_fields.clear();
+	for (auto name = select_names.begin(); name != select_names.end(); ++name)
+	{
+		FieldInfo selected;
+		if (!parsers.findField(*name, selected))
+		{
+			return -1;
+		}
+		select_fields.push_back(selected);
+	}
+
+	if (!source_file.open(source))
+	{
+		return -1;
+	}
+
+	csv_file = std::fopen(target.data(), "w+");
+	if (csv_file == nullptr)
+	{
+		return -1;
+	}
+
+	current_item = 0;
+	total_item = source_file.size() / item_length;
+	if (locateRecords(parsers) == -1)
+	{
+		return -1;
+	}
+
+	// Records located by range, in blocks of kBLOCK_RECORDS from the first.
+	size_t first_item = current_item;
+	size_t record_count = total_item - current_item;
+	size_t block_count = (record_count + kBLOCK_RECORDS - 1) / kBLOCK_RECORDS;
+	size_t thread_count = std::min<size_t>(std::max<size_t>(block_count, 1),
+		std::max(1u, std::thread::hardware_concurrency()));
+
+	std::vector<KeyedHeaps> thread_heaps(thread_count);
+	std::atomic<size_t> next_block(0);
+	const char *base = source_file.data();
+
+	auto worker = [&](size_t index) {
+		KeyedHeaps &heaps = thread_heaps[index];
+
+		for (size_t block = next_block++; block < block_count; block = next_block++)
+		{
+			size_t end = first_item + std::min(record_count, (block + 1) * kBLOCK_RECORDS);
+
+			for (size_t item = first_item + block * kBLOCK_RECORDS; item < end; ++item)
+			{
+				const char *record = base + item * item_length;
+				Candidate candidate;
+
+				if (!accepts(record))
+					continue;
+
+				if (!field.isIntegral())
+				{
+					double value = field.value(record);
+					if (value != value)
+						continue;
+				}
+				candidate.key = ascending ? ~field.sortKey(record) : field.sortKey(record);
+				candidate.item = item;
+
+				offer(heaps[keyed ? key_field.sortKey(record) : 0], count, candidate);
+			}
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < thread_count; ++i)
+	{
+		threads.emplace_back(worker, i);
+	}
+	worker(0);
+	for (auto thread = threads.begin(); thread != threads.end(); ++thread)
+	{
+		thread->join();
+	}
+
+	// Merge heaps of all workers, ordered by key, as sort keys keep the order of values.
+	std::map<uint64_t, std::vector<Candidate>> merged;
+	for (auto heaps = thread_heaps.begin(); heaps != thread_heaps.end(); ++heaps)
+	{
+		for (auto heap = heaps->begin(); heap != heaps->end(); ++heap)
+		{
+			std::vector<Candidate> &target_heap = merged[heap->first];
+			for (auto candidate = heap->second.begin(); candidate != heap->second.end(); ++candidate)
+			{
+				offer(target_heap, count, *candidate);
+			}
+		}
+	}
+
+	results.clear();
+	for (auto heap = merged.begin(); heap != merged.end(); ++heap)
+	{
+		std::sort(heap->second.begin(), heap->second.end(), ranksBefore);
+		for (auto candidate = heap->second.begin(); candidate != heap->second.end(); ++candidate)
+		{
+			results.push_back(candidate->item);
+		}
+	}
+
+	total_item = results.size();
+	current_item = 0;
+
+	return 0;
+}
+
+int TopKStorageConverter::convertAndStore()
+{
+	if (!hasNext())
+		return -1;
+
+	const char *record = source_file.data() + results[current_item] * item_length;
+
+	if (select_fields.empty())
+	{
+		parsers.fprintf(csv_file, record);
+	}
+	else
+	{
+		FormatSpecifier &specifier = FormatSpecifier::instance();
+		for (size_t i = 0; i < select_fields.size(); ++i)
+		{
+			select_fields[i].fprintf(csv_file, record);
+			if (i != select_fields.size() - 1)
+			{
+				std::fprintf(csv_file, "%s", specifier.get_delimiter());
+			}
+		}
+	}
+	std::fprintf(csv_file, "\n");
+
+	++current_item;
+
+	return 0;
+}
+
+int TopKStorageConverter::storeHeaders()
+{
+	FormatSpecifier& specifier = FormatSpecifier::instance();
+	std::vector<std::string> names;
+
+	// Names are taken from schema, so an empty file still gets its headers.
+	if (select_fields.empty())
+	{
+		std::vector<char> record(item_length, 0);
+		auto member_infos = parsers.expr(record.data());
+		for (auto member = member_infos.begin(); member != member_infos.end(); ++member)
+			names.push_back(member->first);
+	}
+	else
+	{
+		names = select_names;
+	}
+
+	for (size_t i = 0; i < names.size(); ++i)
+	{
+		std::fprintf(csv_file, "%s", names[i].data());
+		if (i != names.size() - 1)
+		{
+			std::fprintf(csv_file, "%s", specifier.get_delimiter());
+		}
+	}
+	std::fprintf(csv_file, "\n");
+
+	return 0;
+}
@@ -0,0 +1,206 @@
+#include "VariableConverter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+using namespace StorageNS;
+
+namespace {
+	const size_t kCOPY_BUFFER_SIZE = 64 * 1024;
+
+	// Records are converted in ranges of this many records per part file.
+	const size_t kPART_RECORDS = 256 * 1024;
+}
+
+VariableStorageConverter::~VariableStorageConverter()
+{
+	if (csv_file != nullptr)
+		std::fclose(csv_file);
+
+	// Parts left by a failed or stopped conversion.
+	for (size_t i = current_item; i < parts.size(); ++i)
+	{
+		std::remove(parts[i].data());
+	}
+}
+
+int VariableStorageConverter::prepare()
+{
+	std::string content = StorageNS::getTextFileContent(template_.data());
+	configurator = std::unique_ptr<JsonConfigurator>(new JsonConfigurator(content));
+
+	if (!configurator->isValid()){
+		return -1;
+	}
+
+	parsers = configurator->generateParser();
+	if (compileFilter(parsers) == -1)
+	{
+		return -1;
+	}
+
+	derived.clear();
+	if (parseDerivedFields(configurator->derivedFields() + derivation, parsers, derived) == -1)
+	{
+		return -1;
+	}
+
+	if (!source_file.open(source))
+	{
+		return -1;
+	}
+
+	indexRecords();
+
+	parts.clear();
+	current_item = 0;
+	for (size_t begin = 0; begin < recordCount(); begin += kPART_RECORDS)
+	{
+		std::string part = createPartFile(parts.size());
+		if (part.empty())
+		{
+			return -1;
+		}
+		parts.push_back(part);
+	}
+
+	std::atomic<size_t> next_part(0);
+	std::atomic<bool> failed(false);
+	auto worker = [&]() {
+		for (size_t i = next_part++; i < parts.size() && !failed; i = next_part++)
+		{
+			size_t begin = i * kPART_RECORDS;
+			if (convertPart(begin, std::min(begin + kPART_RECORDS, recordCount()), parts[i]) == -1)
+			{
+				failed = true;
+				return;
+			}
+		}
+	};
+
+	size_t thread_count = std::min<size_t>(std::max<size_t>(parts.size(), 1),
+		std::max(1u, std::thread::hardware_concurrency()));
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < thread_count; ++i)
+	{
+		threads.emplace_back(worker);
+	}
+	worker();
+	for (auto thread = threads.begin(); thread != threads.end(); ++thread)
+	{
+		thread->join();
+	}
+
+	if (failed)
+	{
+		return -1;
+	}
+
+	csv_file = std::fopen(target.data(), "w+");
+	if (csv_file == nullptr)
+	{
+		return -1;
+	}
+
+	total_item = parts.size();
+
+	return 0;
+}
+
+void VariableStorageConverter::indexRecords()
+{
+	const char *data = source_file.data();
+	size_t size = source_file.size();
+	size_t offset = 0;
+
+	offsets.clear();
+	offsets.push_back(0);
+	while (offset < size)
+	{
+		size_t length = parsers.lengthAt(data + offset, size - offset);
+		if (length == 0)
+			break;
+
+		offset += length;
+		offsets.push_back(offset);
+	}
+}
+
+int VariableStorageConverter::convertPart(size_t begin, size_t end, const std::string &part)
+{
+	std::FILE *part_file = std::fopen(part.data(), "wb");
+	if (part_file == nullptr)
+		return -1;
+
+	FormatSpecifier& specifier = FormatSpecifier::instance();
+	std::vector<double> stack;
+
+	for (size_t i = begin; i < end; ++i)
+	{
+		const char *record = source_file.data() + offsets[i];
+
+		if (!accepts(record))
+			continue;
+
+		parsers.fprintf(part_file, record);
+		for (auto field = derived.begin(); field != derived.end(); ++field)
+		{
+			std::fprintf(part_file, "%s", specifier.get_delimiter());
+			field->fprintf(part_file, field->expression.evaluate(record, stack));
+		}
+		std::fprintf(part_file, "\n");
+	}
+
+	std::fclose(part_file);
+
+	return 0;
+}
+
+int VariableStorageConverter::convertAndStore()
+{
+	if (!hasNext())
+		return -1;
+
+	std::FILE *part = std::fopen(parts[current_item].data(), "rb");
+	if (part == nullptr)
+		return -1;
+
+	std::vector<char> buffer(kCOPY_BUFFER_SIZE);
+	size_t read_size;
+	while ((read_size = std::fread(buffer.data(), 1, buffer.size(), part)) > 0)
+	{
+		std::fwrite(buffer.data(), 1, read_size, csv_file);
+	}
+	std::fclose(part);
+	std::remove(parts[current_item].data());
+
+	++current_item;
+
+	return 0;
+}
+
+int VariableStorageConverter::storeHeaders()
+{
+	// Names are taken from a zeroed record of schema, so an empty file still
+	// gets its headers.
+	FormatSpecifier& specifier = FormatSpecifier::instance();
+	std::vector<char> record(std::max<size_t>(parsers.emptyLength(), 1), 0);
+	auto member_infos = parsers.expr(record.data());
+
+	for (size_t i = 0; i < member_infos.size(); ++i)
+	{
+		std::fprintf(csv_file, "%s", member_infos[i].first.data());
+		if (i != member_infos.size() - 1)
+		{
+			std::fprintf(csv_file, "%s", specifier.get_delimiter());
+		}
+	}
+	for (auto field = derived.begin(); field != derived.end(); ++field)
+	{
+		std::fprintf(csv_file, "%s%s", specifier.get_delimiter(), field->name.data());
+	}
+	std::fprintf(csv_file, "\n");
+
+	return 0;
+}